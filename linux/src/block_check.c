@@ -12,6 +12,7 @@
 #endif
 
 #include "libpar3.h"
+#include "hash.h"
 
 
 // Data Packets substitute for lost input blocks.
@@ -84,7 +85,8 @@ int find_identical_block(PAR3_CTX *par3_ctx)
 	int flag_show = 0;
 	int64_t slice_index, find_index;
 	int64_t slice_index_i, slice_index_j;
-	uint64_t i, j, count;
+	int64_t i, j, count;
+	uint64_t mask;
 	uint64_t block_index_i, block_index_j;
 	PAR3_CMP_CTX *cmp_list;
 	PAR3_BLOCK_CTX *block_list;
@@ -105,69 +107,72 @@ int find_identical_block(PAR3_CTX *par3_ctx)
 	block_list = par3_ctx->block_list;
 	slice_list = par3_ctx->slice_list;
 	cmp_list = par3_ctx->crc_list;
-	count = par3_ctx->crc_count;
+	mask = par3_ctx->crc_mask;
+	count = (par3_ctx->crc_count > 0) ? (int64_t)mask + 1 : 0;	// number of slots
 	for (i = 0; i < count; i++){
-		for (j = i + 1; j < count; j++){
-			if (cmp_list[i].crc == cmp_list[j].crc){
-				// When CRC-64 of these blocks are same, compare hash values next.
-				block_index_i = cmp_list[i].index;
-				block_index_j = cmp_list[j].index;
-				if (memcmp(block_list[block_index_i].hash, block_list[block_index_j].hash, 16) == 0){
-					//printf("block[%"PRIu64"] and [%"PRIu64"] are same.\n", block_index_i, block_index_j);
-					if (block_list[block_index_i].state & 4){	// block[i] is found.
-						if ((block_list[block_index_j].state & 4) == 0){	// block[j] isn't found.
-							if (par3_ctx->noise_level >= 2){
-								if (flag_show == 0){
-									flag_show++;
-									printf("\nComparing lost slices to found slices:\n\n");
-								}
-								printf("Map block[%2"PRIu64"] to identical block[%2"PRIu64"].\n", block_index_j, block_index_i);
-							}
-							slice_index = block_list[block_index_j].slice;
-							find_index = block_list[block_index_i].slice;
-							// Search valid slice for this found block.
-							while ( (find_index != -1) && (slice_list[find_index].find_name == NULL) ){
-								find_index = slice_list[find_index].next;
-							}
-							if (find_index == -1){
-								// When there is no valid slice.
-								printf("Mapping information for block[%"PRIu64"] is wrong.\n", block_index_i);
-								return RET_LOGIC_ERROR;
-							}
-							// Copy reading source to another.
-							slice_list[slice_index].find_name = slice_list[find_index].find_name;
-							slice_list[slice_index].find_offset = slice_list[find_index].find_offset;
-							block_list[block_index_j].state |= 4;
-						}
-					} else if (block_list[block_index_j].state & 4){	// block[i] isn't found, and block[j] is found.
+		if (cmp_list[i].index == CMP_LIST_EMPTY)
+			continue;
+
+		// Compare with following items of same CRC-64 in hash index.
+		j = cmp_list_next(cmp_list, mask, cmp_list[i].crc, i + 1);
+		while (j >= 0){
+			// When CRC-64 of these blocks are same, compare hash values next.
+			block_index_i = cmp_list[i].index;
+			block_index_j = cmp_list[j].index;
+			if (memcmp(block_list[block_index_i].hash, block_list[block_index_j].hash, 16) == 0){
+				//printf("block[%"PRIu64"] and [%"PRIu64"] are same.\n", block_index_i, block_index_j);
+				if (block_list[block_index_i].state & 4){	// block[i] is found.
+					if ((block_list[block_index_j].state & 4) == 0){	// block[j] isn't found.
 						if (par3_ctx->noise_level >= 2){
 							if (flag_show == 0){
 								flag_show++;
 								printf("\nComparing lost slices to found slices:\n\n");
 							}
-							printf("Map block[%2"PRIu64"] to identical block[%2"PRIu64"].\n", block_index_i, block_index_j);
+							printf("Map block[%2"PRIu64"] to identical block[%2"PRIu64"].\n", block_index_j, block_index_i);
 						}
-						slice_index = block_list[block_index_i].slice;
-						find_index = block_list[block_index_j].slice;
+						slice_index = block_list[block_index_j].slice;
+						find_index = block_list[block_index_i].slice;
 						// Search valid slice for this found block.
 						while ( (find_index != -1) && (slice_list[find_index].find_name == NULL) ){
 							find_index = slice_list[find_index].next;
 						}
 						if (find_index == -1){
 							// When there is no valid slice.
-							printf("Mapping information for block[%"PRIu64"] is wrong.\n", block_index_j);
+							printf("Mapping information for block[%"PRIu64"] is wrong.\n", block_index_i);
 							return RET_LOGIC_ERROR;
 						}
 						// Copy reading source to another.
 						slice_list[slice_index].find_name = slice_list[find_index].find_name;
 						slice_list[slice_index].find_offset = slice_list[find_index].find_offset;
-						block_list[block_index_i].state |= 4;
+						block_list[block_index_j].state |= 4;
+					}
+				} else if (block_list[block_index_j].state & 4){	// block[i] isn't found, and block[j] is found.
+					if (par3_ctx->noise_level >= 2){
+						if (flag_show == 0){
+							flag_show++;
+							printf("\nComparing lost slices to found slices:\n\n");
+						}
+						printf("Map block[%2"PRIu64"] to identical block[%2"PRIu64"].\n", block_index_i, block_index_j);
+					}
+					slice_index = block_list[block_index_i].slice;
+					find_index = block_list[block_index_j].slice;
+					// Search valid slice for this found block.
+					while ( (find_index != -1) && (slice_list[find_index].find_name == NULL) ){
+						find_index = slice_list[find_index].next;
+					}
+					if (find_index == -1){
+						// When there is no valid slice.
+						printf("Mapping information for block[%"PRIu64"] is wrong.\n", block_index_j);
+						return RET_LOGIC_ERROR;
 					}
+					// Copy reading source to another.
+					slice_list[slice_index].find_name = slice_list[find_index].find_name;
+					slice_list[slice_index].find_offset = slice_list[find_index].find_offset;
+					block_list[block_index_i].state |= 4;
 				}
-
-			} else {	// Because CRC list was sorted, no need to compare after different CRC.
-				break;
 			}
+
+			j = cmp_list_next(cmp_list, mask, cmp_list[i].crc, j + 1);
 		}
 
 		// When there are multiple slices for a block, map all slices.
@@ -206,51 +211,54 @@ int find_identical_block(PAR3_CTX *par3_ctx)
 	// Compare chunk tail slices.
 	chunk_list = par3_ctx->chunk_list;
 	cmp_list = par3_ctx->tail_list;
-	count = par3_ctx->tail_count;
+	mask = par3_ctx->tail_mask;
+	count = (par3_ctx->tail_count > 0) ? (int64_t)mask + 1 : 0;	// number of slots
 	for (i = 0; i < count; i++){
-		for (j = i + 1; j < count; j++){
-			if (cmp_list[i].crc == cmp_list[j].crc){
-				// When CRC-64 of these slices are same, compare size and hash values next.
-				slice_index_i = cmp_list[i].index;
-				slice_index_j = cmp_list[j].index;
-				if (slice_list[slice_index_i].size == slice_list[slice_index_j].size){
-					if (memcmp(chunk_list[slice_list[slice_index_i].chunk].tail_hash, chunk_list[slice_list[slice_index_j].chunk].tail_hash, 16) == 0){
-						//printf("slice[%"PRIu64"] and [%"PRIu64"] are same.\n", slice_index_i, slice_index_j);
-						if (slice_list[slice_index_i].find_name != NULL){	// slice[i] is found.
-							if (slice_list[slice_index_j].find_name == NULL){	// slice[j] isn't found.
-								if (par3_ctx->noise_level >= 2){
-									if (flag_show == 0){
-										flag_show++;
-										printf("\nComparing lost slices to found slices:\n\n");
-									}
-									printf("Map slice[%2"PRIu64"] to identical slice[%2"PRIu64"].\n", slice_index_j, slice_index_i);
-								}
-								// Copy reading source to another.
-								block_index_j = slice_list[slice_index_j].block;
-								slice_list[slice_index_j].find_name = slice_list[slice_index_i].find_name;
-								slice_list[slice_index_j].find_offset = slice_list[slice_index_i].find_offset;
-								block_list[block_index_j].state |= 8;
-							}
-						} else if (slice_list[slice_index_j].find_name != NULL){	// slice[i] isn't found, and slice[j] is found.
+		if (cmp_list[i].index == CMP_LIST_EMPTY)
+			continue;
+
+		// Compare with following items of same CRC-64 in hash index.
+		j = cmp_list_next(cmp_list, mask, cmp_list[i].crc, i + 1);
+		while (j >= 0){
+			// When CRC-64 of these slices are same, compare size and hash values next.
+			slice_index_i = cmp_list[i].index;
+			slice_index_j = cmp_list[j].index;
+			if (slice_list[slice_index_i].size == slice_list[slice_index_j].size){
+				if (memcmp(chunk_list[slice_list[slice_index_i].chunk].tail_hash, chunk_list[slice_list[slice_index_j].chunk].tail_hash, 16) == 0){
+					//printf("slice[%"PRIu64"] and [%"PRIu64"] are same.\n", slice_index_i, slice_index_j);
+					if (slice_list[slice_index_i].find_name != NULL){	// slice[i] is found.
+						if (slice_list[slice_index_j].find_name == NULL){	// slice[j] isn't found.
 							if (par3_ctx->noise_level >= 2){
 								if (flag_show == 0){
 									flag_show++;
 									printf("\nComparing lost slices to found slices:\n\n");
 								}
-								printf("Map slice[%2"PRId64"] to identical slice[%2"PRId64"].\n", slice_index_i, slice_index_j);
+								printf("Map slice[%2"PRIu64"] to identical slice[%2"PRIu64"].\n", slice_index_j, slice_index_i);
 							}
 							// Copy reading source to another.
-							block_index_i = slice_list[slice_index_i].block;
-							slice_list[slice_index_i].find_name = slice_list[slice_index_j].find_name;
-							slice_list[slice_index_i].find_offset = slice_list[slice_index_j].find_offset;
-							block_list[block_index_i].state |= 8;
+							block_index_j = slice_list[slice_index_j].block;
+							slice_list[slice_index_j].find_name = slice_list[slice_index_i].find_name;
+							slice_list[slice_index_j].find_offset = slice_list[slice_index_i].find_offset;
+							block_list[block_index_j].state |= 8;
 						}
+					} else if (slice_list[slice_index_j].find_name != NULL){	// slice[i] isn't found, and slice[j] is found.
+						if (par3_ctx->noise_level >= 2){
+							if (flag_show == 0){
+								flag_show++;
+								printf("\nComparing lost slices to found slices:\n\n");
+							}
+							printf("Map slice[%2"PRId64"] to identical slice[%2"PRId64"].\n", slice_index_i, slice_index_j);
+						}
+						// Copy reading source to another.
+						block_index_i = slice_list[slice_index_i].block;
+						slice_list[slice_index_i].find_name = slice_list[slice_index_j].find_name;
+						slice_list[slice_index_i].find_offset = slice_list[slice_index_j].find_offset;
+						block_list[block_index_i].state |= 8;
 					}
 				}
-
-			} else {	// Because CRC list was sorted, no need to compare after different CRC.
-				break;
 			}
+
+			j = cmp_list_next(cmp_list, mask, cmp_list[i].crc, j + 1);
 		}
 	}
 
@@ -14,11 +14,14 @@
 #include <string.h>
 #include <time.h>
 
+#include "blake3/blake3.h"
 #include "libpar3.h"
 #include "common.h"
 #include "galois.h"
 #include "hash.h"
+#include "packet.h"
 #include "reedsolomon.h"
+#include "thread.h"
 #include "leopard/leopard.h"
 
 
@@ -66,16 +69,26 @@ int allocate_recovery_block(PAR3_CTX *par3_ctx)
 	return 0;
 }
 
-// This supports Reed-Solomon Erasure Codes on 8-bit or 16-bit Galois Field.
-// GF tables and recovery blocks were allocated already.
-int create_recovery_block(PAR3_CTX *par3_ctx)
+// Number of input blocks in a ring buffer, while reading next blocks during calculation.
+#define READ_RING_COUNT	4
+
+// Arguments for background reading
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	uint8_t *buf;		// ring buffer of input blocks
+	size_t region_size;
+	FILE *fp;			// current input file
+	uint32_t file_prev;
+	double read_time;	// time of reading and checksum
+} READ_RING_CTX;
+
+// Read one input block and calculate parity bytes in a slot of ring buffer.
+static int read_input_block(void *arg, int block_index, int slot)
 {
-	uint8_t *work_buf;
-	uint8_t gf_size;
-	int galois_poly;
-	int block_count, block_index;
-	int progress_old, progress_now;
-	uint32_t file_index, file_prev;
+	READ_RING_CTX *ctx = arg;
+	PAR3_CTX *par3_ctx = ctx->par3_ctx;
+	uint8_t *buf_p;
+	uint32_t file_index;
 	size_t block_size, region_size;
 	size_t data_size, read_size;
 	size_t tail_offset, tail_gap;
@@ -83,9 +96,237 @@ int create_recovery_block(PAR3_CTX *par3_ctx)
 	PAR3_FILE_CTX *file_list;
 	PAR3_SLICE_CTX *slice_list;
 	PAR3_BLOCK_CTX *block_list;
-	FILE *fp;
-	time_t time_old, time_now;
-	clock_t clock_now;
+	double time_start;
+
+	time_start = thread_time();
+	block_size = par3_ctx->block_size;
+	file_list = par3_ctx->input_file_list;
+	slice_list = par3_ctx->slice_list;
+	block_list = par3_ctx->block_list;
+	region_size = ctx->region_size;
+	buf_p = ctx->buf + region_size * slot;
+
+	// Read each input block from input files.
+	data_size = block_list[block_index].size;
+	if (block_list[block_index].state & 1){	// including full size data
+		slice_index = block_list[block_index].slice;
+		while (slice_index != -1){
+			if (slice_list[slice_index].size == block_size)
+				break;
+			slice_index = slice_list[slice_index].next;
+		}
+		if (slice_index == -1){	// When there is no valid slice.
+			printf("Mapping information for block[%d] is wrong.\n", block_index);
+			return RET_LOGIC_ERROR;
+		}
+
+		// Read one slice from a file.
+		file_index = slice_list[slice_index].file;
+		file_offset = slice_list[slice_index].offset;
+		read_size = data_size;
+		if (par3_ctx->noise_level >= 3){
+			printf("Reading %zu bytes of slice[%"PRId64"] for input block[%d]\n", read_size, slice_index, block_index);
+		}
+		if ( (ctx->fp == NULL) || (file_index != ctx->file_prev) ){
+			if (ctx->fp != NULL){	// Close previous input file.
+				fclose(ctx->fp);
+				ctx->fp = NULL;
+			}
+			ctx->fp = fopen(file_list[file_index].name, "rb");
+			if (ctx->fp == NULL){
+				perror("Failed to open Input File");
+				return RET_FILE_IO_ERROR;
+			}
+			ctx->file_prev = file_index;
+		}
+		if (_fseeki64(ctx->fp, file_offset, SEEK_SET) != 0){
+			perror("Failed to seek Input File");
+			return RET_FILE_IO_ERROR;
+		}
+		if (fread(buf_p, 1, read_size, ctx->fp) != read_size){
+			perror("Failed to read slice on Input File");
+			return RET_FILE_IO_ERROR;
+		}
+
+	} else {	// tail data only (one tail or packed tails)
+		if (par3_ctx->noise_level >= 3){
+			printf("Reading %"PRIu64" bytes for input block[%d]\n", data_size, block_index);
+		}
+		tail_offset = 0;
+		while (tail_offset < data_size){	// Read tails until data end.
+			slice_index = block_list[block_index].slice;
+			while (slice_index != -1){
+				//printf("block = %"PRIu64", size = %zu, offset = %zu, slice = %"PRId64"\n", block_index, data_size, tail_offset, slice_index);
+				// Even when chunk tails are overlaped, it will find tail slice of next position.
+				if ( (slice_list[slice_index].tail_offset + slice_list[slice_index].size > tail_offset)
+						&& (slice_list[slice_index].tail_offset <= tail_offset) ){
+					break;
+				}
+				slice_index = slice_list[slice_index].next;
+			}
+			if (slice_index == -1){	// When there is no valid slice.
+				printf("Mapping information for block[%d] is wrong.\n", block_index);
+				return RET_LOGIC_ERROR;
+			}
+
+			// Read one slice from a file.
+			tail_gap = tail_offset - slice_list[slice_index].tail_offset;	// This tail slice may start before tail_offset.
+			//printf("tail_gap for slice[%"PRId64"] = %zu.\n", slice_index, tail_gap);
+			file_index = slice_list[slice_index].file;
+			file_offset = slice_list[slice_index].offset + tail_gap;
+			read_size = slice_list[slice_index].size - tail_gap;
+			if ( (ctx->fp == NULL) || (file_index != ctx->file_prev) ){
+				if (ctx->fp != NULL){	// Close previous input file.
+					fclose(ctx->fp);
+					ctx->fp = NULL;
+				}
+				ctx->fp = fopen(file_list[file_index].name, "rb");
+				if (ctx->fp == NULL){
+					perror("Failed to open Input File");
+					return RET_FILE_IO_ERROR;
+				}
+				ctx->file_prev = file_index;
+			}
+			if (_fseeki64(ctx->fp, file_offset, SEEK_SET) != 0){
+				perror("Failed to seek Input File");
+				return RET_FILE_IO_ERROR;
+			}
+			if (fread(buf_p + tail_offset, 1, read_size, ctx->fp) != read_size){
+				perror("Failed to read tail slice on Input File");
+				return RET_FILE_IO_ERROR;
+			}
+			tail_offset += read_size;
+		}
+	}
+	// Zero fill rest bytes
+	memset(buf_p + data_size, 0, region_size - data_size);
+
+	// At creating time, CRC of a block was set, even when the block includes multiple chunk tails.
+	// It appends chunk tails as tail packing, and calculates their total CRC for the block.
+	// But, after verification, a block without full size data doesn't have valid CRC value.
+	// Calculate parity bytes in the region, while calculating checksum of block.
+	if (block_list[block_index].state & 64){
+		// Calculate checksum of block to confirm that input file was not changed.
+		if (region_create_parity_crc(par3_ctx, buf_p, region_size, data_size, 0) != block_list[block_index].crc){
+			printf("Checksum of block[%d] is different.\n", block_index);
+			return RET_LOGIC_ERROR;
+		}
+	} else {
+		region_create_parity_crc(par3_ctx, buf_p, region_size, 0, 0);
+	}
+
+	ctx->read_time += thread_time() - time_start;
+	return 0;
+}
+
+// Read all input blocks on a background thread, and multiply them to some recovery blocks.
+// Recovery blocks from y_first to y_first + y_count - 1 are stored in block_data.
+static int create_recovery_rows(PAR3_CTX *par3_ctx, int y_first, int y_count, int ring_count,
+				uint64_t progress_total, uint64_t progress_step)
+{
+	uint8_t *work_buf;
+	int ret, block_count, block_index;
+	int progress_old, progress_now;
+	size_t region_size;
+	READ_RING_CTX read_ctx;
+	THREAD_RING *ring;
+	double time_start, time_wait, time_calc;
+	time_t time_old = 0, time_now;
+
+	block_count = (int)(par3_ctx->block_count);
+
+	// Allocate memory to read some input blocks and parity.
+	region_size = (par3_ctx->block_size + 4 + 3) & ~3;
+	if (ring_count > block_count)
+		ring_count = block_count;
+	work_buf = malloc(region_size * ring_count);
+	if ( (work_buf == NULL) && (ring_count > 2) ){
+		ring_count = 2;
+		work_buf = malloc(region_size * ring_count);
+	}
+	if (work_buf == NULL){
+		perror("Failed to allocate memory for input data");
+		return RET_MEMORY_ERROR;
+	}
+	par3_ctx->work_buf = work_buf;
+
+	if (par3_ctx->noise_level >= 0){
+		progress_old = 0;
+		time_old = time(NULL);
+	}
+
+	// Reed-Solomon Erasure Codes
+	read_ctx.par3_ctx = par3_ctx;
+	read_ctx.buf = work_buf;
+	read_ctx.region_size = region_size;
+	read_ctx.fp = NULL;
+	read_ctx.file_prev = 0xFFFFFFFF;
+	read_ctx.read_time = 0;
+	ring = thread_ring_start(read_input_block, &read_ctx, block_count, ring_count);
+	if (ring == NULL){
+		perror("Failed to allocate memory for reading thread");
+		return RET_MEMORY_ERROR;
+	}
+	time_wait = 0;
+	time_calc = 0;
+	ret = 0;
+	for (block_index = 0; block_index < block_count; block_index++){
+		// Wait until the input block is read.
+		time_start = thread_time();
+		ret = thread_ring_wait(ring, block_index);
+		if (ret != 0)
+			break;
+		time_wait += thread_time() - time_start;
+
+		// Multipy one input block for the recovery blocks.
+		time_start = thread_time();
+		rs_create_one_all(par3_ctx, work_buf + region_size * (block_index % ring_count), block_index, y_first, y_count);
+		time_calc += thread_time() - time_start;
+		thread_ring_release(ring, block_index);
+
+		// Print progress percent
+		if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
+			progress_step++;
+			time_now = time(NULL);
+			if (time_now != time_old){
+				time_old = time_now;
+				progress_now = (int)((progress_step * 1000) / progress_total);
+				if (progress_now != progress_old){
+					progress_old = progress_now;
+					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+				}
+			}
+		}
+	}
+	thread_ring_stop(ring);
+	if (read_ctx.fp != NULL){
+		if ( (fclose(read_ctx.fp) != 0) && (ret == 0) ){
+			perror("Failed to close Input File");
+			ret = RET_FILE_IO_ERROR;
+		}
+	}
+	if (ret != 0)
+		return ret;
+
+	// Release allocated memory
+	free(work_buf);
+	par3_ctx->work_buf = NULL;
+
+	if (par3_ctx->noise_level >= 1){
+		// When waiting time is long, reading is slower than calculation.
+		printf("Read = %.3f sec, Wait = %.3f sec, Calculation = %.3f sec\n", read_ctx.read_time, time_wait, time_calc);
+	}
+
+	return 0;
+}
+
+// This supports Reed-Solomon Erasure Codes on 8-bit or 16-bit Galois Field.
+// GF tables and recovery blocks were allocated already.
+// While calculating one input block, a background thread reads next input blocks.
+int create_recovery_block(PAR3_CTX *par3_ctx)
+{
+	int ret;
+	clock_t clock_now = 0;
 
 	if (par3_ctx->recovery_block_count == 0)
 		return -1;
@@ -98,192 +339,275 @@ int create_recovery_block(PAR3_CTX *par3_ctx)
 	if ((par3_ctx->ecc_method & 1) == 0)
 		return -1;
 
+	if (par3_ctx->noise_level >= 0){
+		printf("\nComputing recovery blocks:\n");
+		clock_now = clock();
+	}
+
+	ret = create_recovery_rows(par3_ctx, 0, (int)(par3_ctx->recovery_block_count), READ_RING_COUNT, par3_ctx->block_count, 0);
+	if (ret != 0)
+		return ret;
+
+	if (par3_ctx->noise_level >= 0){
+		clock_now = clock() - clock_now;
+		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
+		printf("\n");
+	}
+
+	return 0;
+}
+
+// Cost of one random access in bytes, which is used to compare I/O cost.
+// It's about 10 ms seek of HDD, or overhead of many small requests on SSD.
+#define IO_ACCESS_COST	(1 << 20)
+
+// When recovery blocks don't fit in memory, there are some ways to create them.
+// 1) Split every block to small pieces, and read all input files per each piece.
+//    Reading size is same as input files, but there are many small accesses.
+// 2) Create some recovery blocks per pass, and read whole input files per each pass.
+//    Reading size is multiplied by number of passes, but each access is large.
+// It returns number of recovery blocks per pass, when 2) is cheaper than 1).
+static int plan_recovery_pass(PAR3_CTX *par3_ctx, uint32_t split_count)
+{
+	int ring_count, pass_count;
+	uint64_t block_index, block_count, recovery_block_count, region_size, row_count;
+	uint64_t input_size, input_count, split_cost, pass_cost;
+
+	// Partitioning recovery blocks is possible only for Cauchy Reed-Solomon Codes.
+	if ((par3_ctx->ecc_method & 1) == 0)
+		return 0;
+	if ( (par3_ctx->galois_table == NULL) || (par3_ctx->memory_limit == 0) )
+		return 0;
+
+	block_count = par3_ctx->block_count;
+	recovery_block_count = par3_ctx->recovery_block_count;
+	region_size = (par3_ctx->block_size + 4 + 3) & ~3;
+
+	// Some input blocks are read on a ring buffer.
+	ring_count = 2;
+	row_count = par3_ctx->memory_limit / region_size;
+	if (row_count <= (uint64_t)ring_count)
+		return 0;
+	row_count -= ring_count;
+	if (row_count > recovery_block_count)
+		row_count = recovery_block_count;
+	pass_count = (int)((recovery_block_count + row_count - 1) / row_count);
+
+	// Total size of input blocks
+	input_size = 0;
+	input_count = 0;
+	for (block_index = 0; block_index < block_count; block_index++){
+		input_size += par3_ctx->block_list[block_index].size;
+		input_count++;
+	}
+
+	// Reading and writing of each piece are counted as accesses.
+	split_cost = input_size + (input_count + recovery_block_count) * split_count * IO_ACCESS_COST;
+	pass_cost = input_size * pass_count + (input_count * pass_count + recovery_block_count) * IO_ACCESS_COST;
+	if (par3_ctx->noise_level >= 1){
+		printf("\nEstimated I/O cost to create recovery blocks:\n");
+		printf("Split block to %u pieces : read %"PRIu64" bytes, cost = %"PRIu64"\n", split_count, input_size, split_cost);
+		printf("Recovery blocks in %d passes : read %"PRIu64" bytes, cost = %"PRIu64"\n", pass_count, input_size * pass_count, pass_cost);
+	}
+	if (pass_cost >= split_cost)
+		return 0;
+
+	if (par3_ctx->noise_level >= 0){
+		printf("\nCreate %"PRIu64" recovery blocks per pass (%d passes), reading %"PRIu64" bytes of input files.\n",
+				row_count, pass_count, input_size * pass_count);
+	}
+	return (int)row_count;
+}
+
+// This keeps some recovery blocks on memory, and reads all input blocks per each pass.
+// GF tables were allocated already.
+static int create_recovery_block_pass(PAR3_CTX *par3_ctx, int row_count)
+{
+	char *name_prev, *file_name;
+	uint8_t *block_data, *buf_p, packet_header[80];
+	int ret, y_first, y_count, y_index;
+	int progress_old, progress_now;
+	int64_t file_offset;
+	uint64_t block_size, block_count, recovery_block_count;
+	uint64_t region_size, pass_count;
+	uint64_t progress_total = 0, progress_step = 0;
+	PAR3_POS_CTX *position_list;
+	blake3_hasher hasher;
+	FILE *fp;
+	time_t time_old = 0, time_now;
+	clock_t clock_now = 0;
+
 	block_size = par3_ctx->block_size;
-	block_count = (int)(par3_ctx->block_count);
-	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
-	file_list = par3_ctx->input_file_list;
-	slice_list = par3_ctx->slice_list;
-	block_list = par3_ctx->block_list;
+	block_count = par3_ctx->block_count;
+	recovery_block_count = par3_ctx->recovery_block_count;
+	position_list = par3_ctx->position_list;
 
-	// Allocate memory to read one input block and parity.
+	// Allocate memory to keep some recovery blocks.
 	region_size = (block_size + 4 + 3) & ~3;
-	work_buf = malloc(region_size);
-	if (work_buf == NULL){
-		perror("Failed to allocate memory for input data");
+	block_data = malloc(region_size * row_count);
+	if (block_data == NULL){
+		perror("Failed to allocate memory for block data");
 		return RET_MEMORY_ERROR;
 	}
-	par3_ctx->work_buf = work_buf;
+	par3_ctx->block_data = block_data;
+	if (par3_ctx->noise_level >= 2){
+		printf("\nAligned size of block data = %"PRIu64"\n", region_size);
+		printf("Allocated memory size = %"PRIu64" * %d = %"PRIu64"\n", region_size, row_count, region_size * row_count);
+	}
 
+	pass_count = (recovery_block_count + row_count - 1) / row_count;
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing recovery blocks:\n");
+		progress_total = block_count * pass_count + recovery_block_count;
+		progress_step = 0;
 		progress_old = 0;
-		time_old = time(NULL);
 		clock_now = clock();
 	}
 
-	// Reed-Solomon Erasure Codes
-	file_prev = 0xFFFFFFFF;
+	name_prev = NULL;
 	fp = NULL;
-	for (block_index = 0; block_index < block_count; block_index++){
-		// Read each input block from input files.
-		data_size = block_list[block_index].size;
-		if (block_list[block_index].state & 1){	// including full size data
-			slice_index = block_list[block_index].slice;
-			while (slice_index != -1){
-				if (slice_list[slice_index].size == block_size)
-					break;
-				slice_index = slice_list[slice_index].next;
-			}
-			if (slice_index == -1){	// When there is no valid slice.
-				printf("Mapping information for block[%d] is wrong.\n", block_index);
-				if (fp != NULL)
-					fclose(fp);
-				return RET_LOGIC_ERROR;
-			}
+	for (y_first = 0; y_first < (int)recovery_block_count; y_first += row_count){
+		y_count = (int)recovery_block_count - y_first;
+		if (y_count > row_count)
+			y_count = row_count;
 
-			// Read one slice from a file.
-			file_index = slice_list[slice_index].file;
-			file_offset = slice_list[slice_index].offset;
-			read_size = data_size;
-			if (par3_ctx->noise_level >= 3){
-				printf("Reading %zu bytes of slice[%"PRId64"] for input block[%d]\n", read_size, slice_index, block_index);
-			}
-			if ( (fp == NULL) || (file_index != file_prev) ){
-				if (fp != NULL){	// Close previous input file.
+		// Read all input blocks, and create recovery blocks of this pass.
+		ret = create_recovery_rows(par3_ctx, y_first, y_count, 2, progress_total, progress_step);
+		if (ret != 0){
+			if (fp != NULL)
+				fclose(fp);
+			return ret;
+		}
+		if (par3_ctx->noise_level >= 0){
+			progress_step += block_count;
+			time_old = time(NULL);
+		}
+
+		// Write recovery blocks of this pass on recovery files
+		buf_p = block_data;
+		for (y_index = y_first; y_index < y_first + y_count; y_index++){
+			// Position of Recovery Data Packet in recovery file
+			file_name = position_list[y_index].name;
+			file_offset = position_list[y_index].offset;
+			if ( (fp == NULL) || (file_name != name_prev) ){
+				if (fp != NULL){	// Close previous recovery file.
 					fclose(fp);
 					fp = NULL;
 				}
-				fp = fopen(file_list[file_index].name, "rb");
+				fp = fopen(file_name, "r+b");	// Over-write on existing file
 				if (fp == NULL){
-					perror("Failed to open Input File");
+					perror("Failed to open Recovery File");
 					return RET_FILE_IO_ERROR;
 				}
-				file_prev = file_index;
+				name_prev = file_name;
 			}
-			if (_fseeki64(fp, file_offset, SEEK_SET) != 0){
-				perror("Failed to seek Input File");
+
+			// Read packet header after checksum, which was written already.
+			if (_fseeki64(fp, file_offset + 24, SEEK_SET) != 0){
+				perror("Failed to seek Recovery File");
 				fclose(fp);
 				return RET_FILE_IO_ERROR;
 			}
-			if (fread(work_buf, 1, read_size, fp) != read_size){
-				perror("Failed to read slice on Input File");
+			if (fread(packet_header + 16, 1, 64, fp) != 64){
+				perror("Failed to read Recovery Data Packet");
 				fclose(fp);
 				return RET_FILE_IO_ERROR;
 			}
-
-		} else {	// tail data only (one tail or packed tails)
-			if (par3_ctx->noise_level >= 3){
-				printf("Reading %"PRIu64" bytes for input block[%d]\n", data_size, block_index);
-			}
-			tail_offset = 0;
-			while (tail_offset < data_size){	// Read tails until data end.
-				slice_index = block_list[block_index].slice;
-				while (slice_index != -1){
-					//printf("block = %"PRIu64", size = %zu, offset = %zu, slice = %"PRId64"\n", block_index, data_size, tail_offset, slice_index);
-					// Even when chunk tails are overlaped, it will find tail slice of next position.
-					if ( (slice_list[slice_index].tail_offset + slice_list[slice_index].size > tail_offset)
-							&& (slice_list[slice_index].tail_offset <= tail_offset) ){
-						break;
-					}
-					slice_index = slice_list[slice_index].next;
-				}
-				if (slice_index == -1){	// When there is no valid slice.
-					printf("Mapping information for block[%d] is wrong.\n", block_index);
-					if (fp != NULL)
-						fclose(fp);
-					return RET_LOGIC_ERROR;
-				}
-
-				// Read one slice from a file.
-				tail_gap = tail_offset - slice_list[slice_index].tail_offset;	// This tail slice may start before tail_offset.
-				//printf("tail_gap for slice[%"PRId64"] = %zu.\n", slice_index, tail_gap);
-				file_index = slice_list[slice_index].file;
-				file_offset = slice_list[slice_index].offset + tail_gap;
-				read_size = slice_list[slice_index].size - tail_gap;
-				if ( (fp == NULL) || (file_index != file_prev) ){
-					if (fp != NULL){	// Close previous input file.
-						fclose(fp);
-						fp = NULL;
-					}
-					fp = fopen(file_list[file_index].name, "rb");
-					if (fp == NULL){
-						perror("Failed to open Input File");
-						return RET_FILE_IO_ERROR;
-					}
-					file_prev = file_index;
-				}
-				if (_fseeki64(fp, file_offset, SEEK_SET) != 0){
-					perror("Failed to seek Input File");
-					fclose(fp);
-					return RET_FILE_IO_ERROR;
-				}
-				if (fread(work_buf + tail_offset, 1, read_size, fp) != read_size){
-					perror("Failed to read tail slice on Input File");
-					fclose(fp);
-					return RET_FILE_IO_ERROR;
-				}
-				tail_offset += read_size;
+			if (crc64(packet_header + 16, 64, 0) != position_list[y_index].crc){
+				printf("Packet data of recovery block[%d] is different.\n", y_index);
+				fclose(fp);
+				return RET_LOGIC_ERROR;
 			}
-		}
-		// Zero fill rest bytes
-		memset(work_buf + data_size, 0, region_size - data_size);
 
-		// At creating time, CRC of a block was set, even when the block includes multiple chunk tails.
-		// It appends chunk tails as tail packing, and calculates their total CRC for the block.
-		// But, after verification, a block without full size data doesn't have valid CRC value.
-		if (block_list[block_index].state & 64){
-			// Calculate checksum of block to confirm that input file was not changed.
-			if (crc64(work_buf, data_size, 0) != block_list[block_index].crc){
-				printf("Checksum of block[%d] is different.\n", block_index);
+			// Check parity of recovery block to confirm that calculation was correct.
+			// Calculate checksum of this packet at the same time.
+			blake3_hasher_init(&hasher);
+			blake3_hasher_update(&hasher, packet_header + 16, 64);
+			ret = region_check_parity_hash(par3_ctx, buf_p, region_size, block_size, NULL, &hasher);
+			if (ret != 0){
+				printf("Parity of recovery block[%d] is different.\n", y_index);
 				fclose(fp);
 				return RET_LOGIC_ERROR;
 			}
-		}
-
-		// Calculate parity bytes in the region
-		if (gf_size == 2){
-			gf16_region_create_parity(galois_poly, work_buf, region_size);
-		} else if (gf_size == 1){
-			gf8_region_create_parity(galois_poly, work_buf, region_size);
-		} else {
-			region_create_parity(work_buf, region_size);
-		}
+			blake3_hasher_finalize(&hasher, packet_header, 16);
 
-		// Multipy one input block for all recovery blocks.
-		rs_create_one_all(par3_ctx, block_index);
+			// Write recovery block and checksum
+			if (fwrite(buf_p, 1, block_size, fp) != block_size){
+				perror("Failed to write Recovery Block on Recovery File");
+				fclose(fp);
+				return RET_FILE_IO_ERROR;
+			}
+			if (_fseeki64(fp, file_offset + 8, SEEK_SET) != 0){
+				perror("Failed to seek Recovery File");
+				fclose(fp);
+				return RET_FILE_IO_ERROR;
+			}
+			if (fwrite(packet_header, 1, 16, fp) != 16){
+				perror("Failed to write checksum of Recovery Data Packet");
+				fclose(fp);
+				return RET_FILE_IO_ERROR;
+			}
 
-		// Print progress percent
-		if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
-			time_now = time(NULL);
-			if (time_now != time_old){
-				time_old = time_now;
-				// Because block_count is 16-bit value, "int" (32-bit signed integer) is enough.
-				progress_now = (block_index * 1000) / block_count;
-				if (progress_now != progress_old){
-					progress_old = progress_now;
-					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+			// Print progress percent
+			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
+				progress_step++;
+				time_now = time(NULL);
+				if (time_now != time_old){
+					time_old = time_now;
+					progress_now = (int)((progress_step * 1000) / progress_total);
+					if (progress_now != progress_old){
+						progress_old = progress_now;
+						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+					}
 				}
 			}
+
+			buf_p += region_size;
 		}
 	}
 	if (fp != NULL){
 		if (fclose(fp) != 0){
-			perror("Failed to close Input File");
+			perror("Failed to close Recovery File");
 			return RET_FILE_IO_ERROR;
 		}
 	}
 
-	// Release allocated memory
-	free(work_buf);
-	par3_ctx->work_buf = NULL;
-
 	if (par3_ctx->noise_level >= 0){
 		clock_now = clock() - clock_now;
 		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
 		printf("\n");
 	}
 
+	// Release some allocated memory
+	free(block_data);
+	par3_ctx->block_data = NULL;
+	free(position_list);
+	par3_ctx->position_list = NULL;
+	if (par3_ctx->matrix){
+		free(par3_ctx->matrix);
+		par3_ctx->matrix = NULL;
+	}
+
+	return 0;
+}
+
+// Start checksum of a Recovery Data Packet from its packet header.
+// The header is made again on memory, and it's compared to CRC of the written one.
+static int recovery_hash_start(PAR3_CTX *par3_ctx, uint64_t index, blake3_hasher *hasher)
+{
+	uint8_t packet_header[88];
+	uint64_t block_index;
+
+	make_packet_header(packet_header, 88 + par3_ctx->block_size, par3_ctx->set_id, (uint8_t *)"PAR REC\0", 0);
+	memcpy(packet_header + 48, par3_ctx->root_packet + 8, 16);	// The checksum from the Root packet
+	memcpy(packet_header + 64, par3_ctx->matrix_packet + 8, 16);
+	block_index = par3_ctx->first_recovery_block + index;
+	memcpy(packet_header + 80, &block_index, 8);
+	if (crc64(packet_header + 24, 64, 0) != par3_ctx->position_list[index].crc)
+		return RET_LOGIC_ERROR;
+
+	blake3_hasher_init(hasher);
+	blake3_hasher_update(hasher, packet_header + 24, 64);
 	return 0;
 }
 
@@ -292,9 +616,9 @@ int create_recovery_block(PAR3_CTX *par3_ctx)
 int create_recovery_block_split(PAR3_CTX *par3_ctx)
 {
 	char *name_prev, *file_name;
-	uint8_t *block_data, *buf_p;
+	uint8_t *block_data, *buf_p, *hash_state, *state_p, checksum[16];
 	uint8_t gf_size;
-	int ret, galois_poly;
+	int ret;
 	int progress_old, progress_now;
 	uint32_t split_count;
 	uint32_t file_index, file_prev;
@@ -303,20 +627,21 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 	uint64_t crc, block_index;
 	uint64_t block_size, block_count;
 	uint64_t recovery_block_count, first_recovery_block, max_recovery_block;
-	uint64_t alloc_size, region_size, split_size;
+	uint64_t alloc_size, region_size, split_size, state_size;
 	uint64_t data_size, part_size, split_offset;
 	uint64_t tail_offset, tail_gap;
-	uint64_t progress_total, progress_step;
+	uint64_t progress_total = 0, progress_step = 0;
 	PAR3_FILE_CTX *file_list;
 	PAR3_SLICE_CTX *slice_list;
 	PAR3_BLOCK_CTX *block_list;
 	PAR3_POS_CTX *position_list;
+	blake3_hasher hasher;
 	FILE *fp;
-	time_t time_old, time_now;
-	clock_t clock_now;
+	time_t time_old = 0, time_now;
+	clock_t clock_now = 0;
 
 	// For Leopard-RS library
-	uint32_t work_count;
+	uint32_t work_count = 0;
 	uint8_t **original_data = NULL, **work_data = NULL;
 
 	block_size = par3_ctx->block_size;
@@ -325,7 +650,6 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 	first_recovery_block = par3_ctx->first_recovery_block;
 	max_recovery_block = par3_ctx->max_recovery_block;
 	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	file_list = par3_ctx->input_file_list;
 	slice_list = par3_ctx->slice_list;
 	block_list = par3_ctx->block_list;
@@ -369,6 +693,12 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 		if (split_size > block_size)
 			split_size = block_size;
 		split_count = (uint32_t)((block_size + split_size - 1) / split_size);
+
+		// When reading input files per each pass is cheaper, it doesn't split blocks.
+		ret = plan_recovery_pass(par3_ctx, split_count);
+		if (ret > 0)
+			return create_recovery_block_pass(par3_ctx, ret);
+
 		if (par3_ctx->noise_level >= 1){
 			printf("\nSplit block to %u pieces of %"PRIu64" bytes.\n", split_count, split_size);
 		}
@@ -431,6 +761,15 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 		par3_ctx->matrix = original_data;	// Release this later
 	}
 
+	// Allocate memory to keep checksum state of every Recovery Data Packet.
+	state_size = blake3_state_size(64 + block_size);
+	hash_state = malloc(state_size * recovery_block_count);
+	if (hash_state == NULL){
+		perror("Failed to allocate memory for checksum state");
+		return RET_MEMORY_ERROR;
+	}
+	par3_ctx->work_buf = hash_state;
+
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing recovery blocks:\n");
 		progress_total = (block_count * recovery_block_count + block_count + recovery_block_count) * split_count;
@@ -567,24 +906,9 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 			}
 			if (data_size > split_offset){	// When there is slice data to process.
 				memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
-				crc = crc64(buf_p, part_size, crc);
 
-				// Calculate parity bytes in the region
-				if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
-					if (gf_size == 2){
-						leo_region_create_parity(buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
-				} else {
-					if (gf_size == 2){
-						gf16_region_create_parity(galois_poly, buf_p, region_size);
-					} else if (gf_size == 1){
-						gf8_region_create_parity(galois_poly, buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
-				}
+				// Calculate parity bytes in the region, while calculating CRC.
+				crc = region_create_parity_crc(par3_ctx, buf_p, region_size, part_size, crc);
 			}
 			// Intermediate CRC value is stored in "block_list[block_index].hash".
 			if (block_list[block_index].state & 64){
@@ -628,7 +952,7 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 			rs_create_all(par3_ctx, region_size, progress_total, progress_step);
 
 		} else if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
-			ret = leo_encode(region_size, (uint32_t)block_count, (uint32_t)max_recovery_block, work_count, original_data, work_data);
+			ret = rs_leo_encode(par3_ctx, region_size, (uint32_t)block_count, (uint32_t)max_recovery_block, work_count, original_data, work_data);
 			if (ret != 0){
 				printf("Failed to call Leopard-RS library (%d)\n", ret);
 				return RET_LOGIC_ERROR;
@@ -647,22 +971,23 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 		io_size = part_size;
 		buf_p = block_data + region_size * block_count;	// Starting position of recovery blocks
 		for (block_index = 0; block_index < recovery_block_count; block_index++){
-			// Check parity of recovery block to confirm that calculation was correct.
-			if (par3_ctx->ecc_method & 8){
-				if (gf_size == 2){
-					ret = leo_region_check_parity(buf_p, region_size);
-				} else {
-					ret = region_check_parity(buf_p, region_size);
+			// Restore checksum state of this packet, or start at the first piece.
+			state_p = hash_state + state_size * block_index;
+			if (split_offset == 0){
+				ret = recovery_hash_start(par3_ctx, block_index, &hasher);
+				if (ret != 0){
+					printf("Packet data of recovery block[%"PRIu64"] is different.\n", block_index);
+					if (fp != NULL)
+						fclose(fp);
+					return ret;
 				}
 			} else {
-				if (gf_size == 2){
-					ret = gf16_region_check_parity(galois_poly, buf_p, region_size);
-				} else if (gf_size == 1){
-					ret = gf8_region_check_parity(galois_poly, buf_p, region_size);
-				} else {
-					ret = region_check_parity(buf_p, region_size);
-				}
+				blake3_state_load(&hasher, state_p);
 			}
+
+			// Check parity of recovery block to confirm that calculation was correct.
+			// Calculate checksum of packet data at the same time.
+			ret = region_check_parity_hash(par3_ctx, buf_p, region_size, part_size, NULL, &hasher);
 			if (ret != 0){
 				printf("Parity of recovery block[%"PRIu64"] is different.\n", block_index);
 				if (fp != NULL)
@@ -674,9 +999,6 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 			file_name = position_list[block_index].name;
 			file_offset = position_list[block_index].offset + 88 + split_offset;
 
-			// Calculate CRC of packet data to check error later.
-			position_list[block_index].crc = crc64(buf_p, part_size, position_list[block_index].crc);
-
 			// Write partial recovery block
 			if ( (fp == NULL) || (file_name != name_prev) ){
 				if (fp != NULL){	// Close previous recovery file.
@@ -701,6 +1023,23 @@ int create_recovery_block_split(PAR3_CTX *par3_ctx)
 				return RET_FILE_IO_ERROR;
 			}
 
+			// Save checksum state until the last piece, and write checksum of this packet at the last.
+			if (split_offset + part_size < block_size){
+				blake3_state_save(state_p, &hasher);
+			} else {
+				blake3_hasher_finalize(&hasher, checksum, 16);
+				if (_fseeki64(fp, position_list[block_index].offset + 8, SEEK_SET) != 0){
+					perror("Failed to seek Recovery File");
+					fclose(fp);
+					return RET_FILE_IO_ERROR;
+				}
+				if (fwrite(checksum, 1, 16, fp) != 16){
+					perror("Failed to write checksum of Recovery Data Packet");
+					fclose(fp);
+					return RET_FILE_IO_ERROR;
+				}
+			}
+
 			// Print progress percent
 			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
 				progress_step++;
@@ -732,74 +1071,12 @@ fclose(fp2);
 
 	free(block_data);
 	par3_ctx->block_data = NULL;
-
-	// Allocate memory to read one Recovery Data Packet.
-	alloc_size = 80 + block_size;
-	buf_p = malloc(alloc_size);
-	if (buf_p == NULL){
-		perror("Failed to allocate memory for Recovery Data Packet");
-		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->work_buf = buf_p;
-
-	// Calculate checksum of every Recovery Data Packet
-	io_size = 64 + block_size;	// packet header after checksum and packet body
-	for (block_index = 0; block_index < recovery_block_count; block_index++){
-		// Position of Recovery Data Packet in recovery file
-		file_name = position_list[block_index].name;
-		file_offset = position_list[block_index].offset + 8;	// Offset of checksum
-
-		// Read packet data and write checksum
-		if ( (fp == NULL) || (file_name != name_prev) ){
-			if (fp != NULL){	// Close previous recovery file.
-				fclose(fp);
-				fp = NULL;
-			}
-			fp = fopen(file_name, "r+b");	// Over-write on existing file
-			if (fp == NULL){
-				perror("Failed to open Recovery File");
-				return RET_FILE_IO_ERROR;
-			}
-			name_prev = file_name;
-		}
-		if (_fseeki64(fp, file_offset + 16, SEEK_SET) != 0){
-			perror("Failed to seek Recovery File");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-		if (fread(buf_p + 16, 1, io_size, fp) != io_size){
-			perror("Failed to read Recovery Data Packet");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-
-		// Compare CRC of written packet data to confirm integrity.
-		crc = crc64(buf_p + 16, io_size, 0);
-		if (crc != position_list[block_index].crc){
-			printf("Packet data of recovery block[%"PRIu64"] is different.\n", block_index);
-			fclose(fp);
-			return RET_LOGIC_ERROR;
-		}
-
-		// Calculate checksum of this packet
-		blake3(buf_p + 16, io_size, buf_p);
-
-		// Write checksum
-		if (_fseeki64(fp, file_offset, SEEK_SET) != 0){
-			perror("Failed to seek Recovery File");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-		if (fwrite(buf_p, 1, 16, fp) != 16){
-			perror("Failed to write checksum of Recovery Data Packet");
-			fclose(fp);
+	if (fp != NULL){
+		if (fclose(fp) != 0){
+			perror("Failed to close Recovery File");
 			return RET_FILE_IO_ERROR;
 		}
 	}
-	if (fclose(fp) != 0){
-		perror("Failed to close Recovery File");
-		return RET_FILE_IO_ERROR;
-	}
 
 	if (par3_ctx->noise_level >= 0){
 		if (par3_ctx->noise_level <= 2){
@@ -812,7 +1089,7 @@ fclose(fp2);
 	}
 
 	// Release some allocated memory
-	free(buf_p);
+	free(hash_state);
 	par3_ctx->work_buf = NULL;
 	free(position_list);
 	par3_ctx->position_list = NULL;
@@ -831,9 +1108,9 @@ fclose(fp2);
 int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 {
 	char *name_prev, *file_name;
-	uint8_t *block_data, *buf_p;
+	uint8_t *block_data, *buf_p, *hash_state, *state_p, checksum[16];
 	uint8_t gf_size;
-	int ret, galois_poly;
+	int ret;
 	int progress_old, progress_now;
 	uint32_t split_count;
 	uint32_t file_index, file_prev;
@@ -843,27 +1120,27 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 	uint64_t crc, block_index;
 	uint64_t block_size, block_count, recovery_block_count;
 	uint64_t block_count2, recovery_block_count2, first_recovery_block2, max_recovery_block2;
-	uint64_t alloc_size, region_size, split_size;
+	uint64_t alloc_size, region_size, split_size, state_size;
 	uint64_t data_size, part_size, split_offset;
 	uint64_t tail_offset, tail_gap;
-	uint64_t progress_total, progress_step;
+	uint64_t progress_total = 0, progress_step = 0;
 	PAR3_FILE_CTX *file_list;
 	PAR3_SLICE_CTX *slice_list;
 	PAR3_BLOCK_CTX *block_list;
 	PAR3_POS_CTX *position_list;
+	blake3_hasher hasher;
 	FILE *fp;
-	time_t time_old, time_now;
-	clock_t clock_now;
+	time_t time_old = 0, time_now;
+	clock_t clock_now = 0;
 
 	// For Leopard-RS library
-	uint32_t work_count;
+	uint32_t work_count = 0;
 	uint8_t **original_data = NULL, **work_data = NULL;
 
 	block_size = par3_ctx->block_size;
 	block_count = par3_ctx->block_count;
 	recovery_block_count = par3_ctx->recovery_block_count;
 	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	file_list = par3_ctx->input_file_list;
 	slice_list = par3_ctx->slice_list;
 	block_list = par3_ctx->block_list;
@@ -961,6 +1238,15 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 	}
 	par3_ctx->matrix = original_data;	// Release this later
 
+	// Allocate memory to keep checksum state of every Recovery Data Packet.
+	state_size = blake3_state_size(64 + block_size);
+	hash_state = malloc(state_size * recovery_block_count);
+	if (hash_state == NULL){
+		perror("Failed to allocate memory for checksum state");
+		return RET_MEMORY_ERROR;
+	}
+	par3_ctx->work_buf = hash_state;
+
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing recovery blocks:\n");
 		progress_total = (block_count2 * recovery_block_count + block_count + recovery_block_count) * split_count;
@@ -1106,14 +1392,9 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 				}
 				if (data_size > split_offset){	// When there is slice data to process.
 					memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
-					crc = crc64(buf_p, part_size, crc);
 
-					// Calculate parity bytes in the region
-					if (gf_size == 2){
-						leo_region_create_parity(buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
+					// Calculate parity bytes in the region, while calculating CRC.
+					crc = region_create_parity_crc(par3_ctx, buf_p, region_size, part_size, crc);
 				}
 				if (block_list[block_index].state & 64){
 					if (split_offset + split_size >= block_size){	// At the last
@@ -1158,7 +1439,7 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 			}
 
 			// Create all recovery blocks on memory
-			ret = leo_encode(region_size, (uint32_t)block_count2, (uint32_t)max_recovery_block2, work_count, original_data, work_data);
+			ret = rs_leo_encode(par3_ctx, region_size, (uint32_t)block_count2, (uint32_t)max_recovery_block2, work_count, original_data, work_data);
 			if (ret != 0){
 				printf("Failed to call Leopard-RS library (%d)\n", ret);
 				return RET_LOGIC_ERROR;
@@ -1176,12 +1457,23 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 			io_size = part_size;
 			buf_p = block_data + region_size * block_count2;	// Starting position of recovery blocks
 			for (block_index = cohort_index; block_index < recovery_block_count; block_index += cohort_count){
-				// Check parity of recovery block to confirm that calculation was correct.
-				if (gf_size == 2){
-					ret = leo_region_check_parity(buf_p, region_size);
+				// Restore checksum state of this packet, or start at the first piece.
+				state_p = hash_state + state_size * block_index;
+				if (split_offset == 0){
+					ret = recovery_hash_start(par3_ctx, block_index, &hasher);
+					if (ret != 0){
+						printf("Packet data of recovery block[%"PRIu64"] is different.\n", block_index);
+						if (fp != NULL)
+							fclose(fp);
+						return ret;
+					}
 				} else {
-					ret = region_check_parity(buf_p, region_size);
+					blake3_state_load(&hasher, state_p);
 				}
+
+				// Check parity of recovery block to confirm that calculation was correct.
+				// Calculate checksum of packet data at the same time.
+				ret = region_check_parity_hash(par3_ctx, buf_p, region_size, part_size, NULL, &hasher);
 				if (ret != 0){
 					printf("Parity of recovery block[%"PRIu64"] is different.\n", block_index);
 					if (fp != NULL)
@@ -1193,9 +1485,6 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 				file_name = position_list[block_index].name;
 				file_offset = position_list[block_index].offset + 88 + split_offset;
 
-				// Calculate CRC of packet data to check error later.
-				position_list[block_index].crc = crc64(buf_p, part_size, position_list[block_index].crc);
-
 				// Write partial recovery block
 				if ( (fp == NULL) || (file_name != name_prev) ){
 					if (fp != NULL){	// Close previous recovery file.
@@ -1220,6 +1509,23 @@ int create_recovery_block_cohort(PAR3_CTX *par3_ctx)
 					return RET_FILE_IO_ERROR;
 				}
 
+				// Save checksum state until the last piece, and write checksum of this packet at the last.
+				if (split_offset + part_size < block_size){
+					blake3_state_save(state_p, &hasher);
+				} else {
+					blake3_hasher_finalize(&hasher, checksum, 16);
+					if (_fseeki64(fp, position_list[block_index].offset + 8, SEEK_SET) != 0){
+						perror("Failed to seek Recovery File");
+						fclose(fp);
+						return RET_FILE_IO_ERROR;
+					}
+					if (fwrite(checksum, 1, 16, fp) != 16){
+						perror("Failed to write checksum of Recovery Data Packet");
+						fclose(fp);
+						return RET_FILE_IO_ERROR;
+					}
+				}
+
 				// Print progress percent
 				if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
 					progress_step++;
@@ -1251,74 +1557,12 @@ fclose(fp2);
 
 	free(block_data);
 	par3_ctx->block_data = NULL;
-
-	// Allocate memory to read one Recovery Data Packet.
-	alloc_size = 80 + block_size;
-	buf_p = malloc(alloc_size);
-	if (buf_p == NULL){
-		perror("Failed to allocate memory for Recovery Data Packet");
-		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->work_buf = buf_p;
-
-	// Calculate checksum of every Recovery Data Packet
-	io_size = 64 + block_size;	// packet header after checksum and packet body
-	for (block_index = 0; block_index < recovery_block_count; block_index++){
-		// Position of Recovery Data Packet in recovery file
-		file_name = position_list[block_index].name;
-		file_offset = position_list[block_index].offset + 8;	// Offset of checksum
-
-		// Read packet data and write checksum
-		if ( (fp == NULL) || (file_name != name_prev) ){
-			if (fp != NULL){	// Close previous recovery file.
-				fclose(fp);
-				fp = NULL;
-			}
-			fp = fopen(file_name, "r+b");	// Over-write on existing file
-			if (fp == NULL){
-				perror("Failed to open Recovery File");
-				return RET_FILE_IO_ERROR;
-			}
-			name_prev = file_name;
-		}
-		if (_fseeki64(fp, file_offset + 16, SEEK_SET) != 0){
-			perror("Failed to seek Recovery File");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-		if (fread(buf_p + 16, 1, io_size, fp) != io_size){
-			perror("Failed to read Recovery Data Packet");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-
-		// Compare CRC of written packet data to confirm integrity.
-		crc = crc64(buf_p + 16, io_size, 0);
-		if (crc != position_list[block_index].crc){
-			printf("Packet data of recovery block[%"PRIu64"] is different.\n", block_index);
-			fclose(fp);
-			return RET_LOGIC_ERROR;
-		}
-
-		// Calculate checksum of this packet
-		blake3(buf_p + 16, io_size, buf_p);
-
-		// Write checksum
-		if (_fseeki64(fp, file_offset, SEEK_SET) != 0){
-			perror("Failed to seek Recovery File");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-		if (fwrite(buf_p, 1, 16, fp) != 16){
-			perror("Failed to write checksum of Recovery Data Packet");
-			fclose(fp);
+	if (fp != NULL){
+		if (fclose(fp) != 0){
+			perror("Failed to close Recovery File");
 			return RET_FILE_IO_ERROR;
 		}
 	}
-	if (fclose(fp) != 0){
-		perror("Failed to close Recovery File");
-		return RET_FILE_IO_ERROR;
-	}
 
 	if (par3_ctx->noise_level >= 0){
 		if (par3_ctx->noise_level <= 2){
@@ -1331,7 +1575,7 @@ fclose(fp2);
 	}
 
 	// Release some allocated memory
-	free(buf_p);
+	free(hash_state);
 	par3_ctx->work_buf = NULL;
 	free(position_list);
 	par3_ctx->position_list = NULL;
@@ -0,0 +1,457 @@
+/* Redefinition of _FILE_OFFSET_BITS must happen BEFORE including stdio.h */
+#ifdef __linux__
+#define _FILE_OFFSET_BITS 64
+#define _stat64 stat
+#elif _WIN32
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#include "libpar3.h"
+#include "hash.h"
+#include "map.h"
+#include "cache.h"
+
+
+/*
+Format of cache file
+
+ 8 bytes: "PAR3HASH"
+ 8 bytes: version (1)
+ 8 bytes: number of records
+ 8 bytes: CRC-64 of all records
+ records: CACHE_ENTRY and checksums of full size blocks (MAP_HASH_CTX)
+
+Values are stored in native byte order, because the cache is used on the same PC.
+Records are used on the loaded buffer directly.
+
+A file has one record, which is replaced when the file is changed.
+Records of files, which weren't used while running, are removed at saving.
+*/
+
+#define CACHE_MAGIC		"PAR3HASH"
+#define CACHE_VERSION	1
+#define CACHE_HEADER_SIZE	32
+
+typedef struct {
+	uint8_t *buf;			// loaded cache file
+	size_t buf_size;
+	CACHE_ENTRY **entry_list;	// pointers to records on buf or added ones
+	uint8_t *used_list;		// 1 = record was used while running
+	uint64_t entry_count;
+	uint64_t entry_max;
+	PAR3_CMP_CTX *cmp_list;	// hash index of identity
+	uint64_t cmp_mask;
+	int modified;
+} HASH_CACHE;
+
+// Number of full size blocks, which follow the record.
+static uint64_t entry_block_count(CACHE_ENTRY *entry)
+{
+	if ( ((entry->flag & 2) == 0) || (entry->block_size == 0) )
+		return 0;
+	return entry->key.size / entry->block_size;
+}
+
+// Records are indexed by device and inode, so that a changed file is found.
+static uint64_t key_crc(CACHE_KEY *key)
+{
+	return crc64((uint8_t *)key, 16, 0);
+}
+
+// Make hash index for all records.
+static int cache_make_index(HASH_CACHE *cache)
+{
+	uint64_t size, index;
+
+	size = cmp_list_size(cache->entry_max);
+	free(cache->cmp_list);
+	cache->cmp_list = malloc(sizeof(PAR3_CMP_CTX) * size);
+	if (cache->cmp_list == NULL){
+		perror("Failed to allocate memory for hash cache");
+		return RET_MEMORY_ERROR;
+	}
+	cmp_list_clear(cache->cmp_list, size);
+	cache->cmp_mask = size - 1;
+	for (index = 0; index < cache->entry_count; index++)
+		cmp_list_add(cache->cmp_list, cache->cmp_mask, key_crc(&(cache->entry_list[index]->key)), index);
+
+	return 0;
+}
+
+// Return index of record of the same file, or -1.
+// Size or modification time may be different.
+static int64_t cache_search(HASH_CACHE *cache, CACHE_KEY *key)
+{
+	int64_t position;
+	uint64_t crc;
+	CACHE_ENTRY *entry;
+
+	if (cache->entry_count == 0)
+		return -1;
+
+	crc = key_crc(key);
+	position = cmp_list_search(cache->cmp_list, cache->cmp_mask, crc);
+	while (position >= 0){
+		entry = cache->entry_list[cache->cmp_list[position].index];
+		if ( (entry->key.device == key->device) && (entry->key.inode == key->inode) )
+			return (int64_t)(cache->cmp_list[position].index);
+		position = cmp_list_next(cache->cmp_list, cache->cmp_mask, crc, position + 1);
+	}
+
+	return -1;
+}
+
+// Read cache file. When it doesn't exist, cache becomes empty.
+int cache_load(PAR3_CTX *par3_ctx)
+{
+	uint8_t *buf;
+	uint64_t count, offset, index, crc, record_size;
+	size_t buf_size;
+	HASH_CACHE *cache;
+	CACHE_ENTRY *entry;
+	FILE *fp;
+	struct _stat64 stat_buf;
+
+	cache = calloc(1, sizeof(HASH_CACHE));
+	if (cache == NULL){
+		perror("Failed to allocate memory for hash cache");
+		return RET_MEMORY_ERROR;
+	}
+	par3_ctx->hash_cache = cache;
+
+	count = 0;
+	buf_size = 0;
+	if (_stat64(par3_ctx->hash_cache_name, &stat_buf) == 0)
+		buf_size = (size_t)(stat_buf.st_size);
+	if (buf_size >= CACHE_HEADER_SIZE){
+		buf = malloc(buf_size);
+		if (buf == NULL){
+			perror("Failed to allocate memory for hash cache");
+			return RET_MEMORY_ERROR;
+		}
+		cache->buf = buf;
+		cache->buf_size = buf_size;
+
+		fp = fopen(par3_ctx->hash_cache_name, "rb");
+		if (fp == NULL){
+			perror("Failed to open hash cache");
+			return RET_FILE_IO_ERROR;
+		}
+		if (fread(buf, 1, buf_size, fp) != buf_size){
+			perror("Failed to read hash cache");
+			fclose(fp);
+			return RET_FILE_IO_ERROR;
+		}
+		fclose(fp);
+
+		// Broken or old cache is ignored, and it will be overwritten.
+		memcpy(&index, buf + 8, 8);
+		memcpy(&count, buf + 16, 8);
+		memcpy(&crc, buf + 24, 8);
+		if ( (memcmp(buf, CACHE_MAGIC, 8) != 0) || (index != CACHE_VERSION) ||
+				(crc != crc64(buf + CACHE_HEADER_SIZE, buf_size - CACHE_HEADER_SIZE, 0)) ){
+			if (par3_ctx->noise_level >= 0){
+				printf("Hash cache is invalid, and will be made again.\n");
+			}
+			count = 0;
+			cache->modified = 1;
+		}
+	}
+
+	cache->entry_max = count + 16;
+	cache->entry_list = malloc(sizeof(CACHE_ENTRY *) * cache->entry_max);
+	cache->used_list = calloc((size_t)(cache->entry_max), 1);
+	if ( (cache->entry_list == NULL) || (cache->used_list == NULL) ){
+		perror("Failed to allocate memory for hash cache");
+		return RET_MEMORY_ERROR;
+	}
+
+	// Check range of each record
+	offset = CACHE_HEADER_SIZE;
+	for (index = 0; index < count; index++){
+		if (offset + sizeof(CACHE_ENTRY) > buf_size)
+			break;
+		entry = (CACHE_ENTRY *)(cache->buf + offset);
+		record_size = sizeof(CACHE_ENTRY) + sizeof(MAP_HASH_CTX) * entry_block_count(entry);
+		if (offset + record_size > buf_size)
+			break;
+		cache->entry_list[index] = entry;
+		offset += record_size;
+	}
+	cache->entry_count = index;
+	if (index < count){
+		if (par3_ctx->noise_level >= 0){
+			printf("Hash cache is broken at record %"PRIu64".\n", index);
+		}
+		cache->modified = 1;
+	}
+	if (par3_ctx->noise_level >= 1){
+		printf("Number of records in hash cache = %"PRIu64"\n", cache->entry_count);
+	}
+
+	return cache_make_index(cache);
+}
+
+// Write cache file, only when a record was added or unused.
+int cache_save(PAR3_CTX *par3_ctx)
+{
+	char temp_name[_MAX_PATH + 8];
+	uint8_t header[CACHE_HEADER_SIZE];
+	uint64_t index, crc, value, count;
+	size_t record_size;
+	HASH_CACHE *cache;
+	CACHE_ENTRY *entry;
+	FILE *fp;
+
+	cache = par3_ctx->hash_cache;
+	if (cache == NULL)
+		return 0;
+	count = 0;
+	for (index = 0; index < cache->entry_count; index++){
+		if (cache->used_list[index] != 0)
+			count++;
+	}
+	if ( (cache->modified == 0) && (count == cache->entry_count) )
+		return 0;
+
+	// Write to temporary file, and replace old one at the end.
+	sprintf(temp_name, "%s.tmp", par3_ctx->hash_cache_name);
+	fp = fopen(temp_name, "wb");
+	if (fp == NULL){
+		perror("Failed to create hash cache");
+		return RET_FILE_IO_ERROR;
+	}
+
+	// Header is written again after CRC-64 is calculated.
+	memset(header, 0, CACHE_HEADER_SIZE);
+	if (fwrite(header, 1, CACHE_HEADER_SIZE, fp) != CACHE_HEADER_SIZE){
+		perror("Failed to write hash cache");
+		fclose(fp);
+		return RET_FILE_IO_ERROR;
+	}
+	crc = 0;
+	for (index = 0; index < cache->entry_count; index++){
+		if (cache->used_list[index] == 0)
+			continue;	// Remove record of deleted or unused file.
+		entry = cache->entry_list[index];
+		record_size = sizeof(CACHE_ENTRY) + sizeof(MAP_HASH_CTX) * (size_t)entry_block_count(entry);
+		crc = crc64((uint8_t *)entry, record_size, crc);
+		if (fwrite(entry, 1, record_size, fp) != record_size){
+			perror("Failed to write hash cache");
+			fclose(fp);
+			return RET_FILE_IO_ERROR;
+		}
+	}
+
+	memcpy(header, CACHE_MAGIC, 8);
+	value = CACHE_VERSION;
+	memcpy(header + 8, &value, 8);
+	memcpy(header + 16, &count, 8);
+	memcpy(header + 24, &crc, 8);
+	if ( (fseek(fp, 0, SEEK_SET) != 0) || (fwrite(header, 1, CACHE_HEADER_SIZE, fp) != CACHE_HEADER_SIZE) ){
+		perror("Failed to write hash cache");
+		fclose(fp);
+		return RET_FILE_IO_ERROR;
+	}
+	if (fclose(fp) != 0){
+		perror("Failed to close hash cache");
+		return RET_FILE_IO_ERROR;
+	}
+
+	remove(par3_ctx->hash_cache_name);
+	if (rename(temp_name, par3_ctx->hash_cache_name) != 0){
+		perror("Failed to rename hash cache");
+		return RET_FILE_IO_ERROR;
+	}
+	cache->modified = 0;
+	if (par3_ctx->noise_level >= 1){
+		printf("Saved %"PRIu64" records in hash cache (removed %"PRIu64" records)\n", count, cache->entry_count - count);
+	}
+
+	return 0;
+}
+
+void cache_release(PAR3_CTX *par3_ctx)
+{
+	uint64_t index;
+	HASH_CACHE *cache;
+	CACHE_ENTRY *entry;
+
+	cache = par3_ctx->hash_cache;
+	if (cache == NULL)
+		return;
+
+	// Added records were allocated one by one.
+	for (index = 0; index < cache->entry_count; index++){
+		entry = cache->entry_list[index];
+		if ( ((uint8_t *)entry < cache->buf) || ((uint8_t *)entry >= cache->buf + cache->buf_size) )
+			free(entry);
+	}
+	free(cache->entry_list);
+	free(cache->used_list);
+	free(cache->cmp_list);
+	free(cache->buf);
+	free(cache);
+	par3_ctx->hash_cache = NULL;
+}
+
+// On Windows OS, inode isn't available, and time resolution is a second.
+// CRC-64 of full path is used instead of inode.
+int cache_key(char *file_name, CACHE_KEY *key)
+{
+	struct _stat64 stat_buf;
+
+	if (_stat64(file_name, &stat_buf) != 0)
+		return 1;
+
+	memset(key, 0, sizeof(CACHE_KEY));
+	key->device = stat_buf.st_dev;
+	key->size = stat_buf.st_size;
+#ifdef __linux__
+	key->inode = stat_buf.st_ino;
+	key->mtime = (int64_t)(stat_buf.st_mtim.tv_sec) * 1000000000 + stat_buf.st_mtim.tv_nsec;
+#else
+	{
+		char full_path[_MAX_PATH];
+
+		if (_fullpath(full_path, file_name, _MAX_PATH) == NULL)
+			return 1;
+		key->inode = crc64((uint8_t *)full_path, strlen(full_path), 0);
+	}
+	key->mtime = (int64_t)(stat_buf.st_mtime) * 1000000000;
+#endif
+
+	return 0;
+}
+
+CACHE_ENTRY * cache_find(PAR3_CTX *par3_ctx, CACHE_KEY *key, uint64_t flag, uint64_t block_size)
+{
+	int64_t index;
+	HASH_CACHE *cache;
+	CACHE_ENTRY *entry;
+
+	cache = par3_ctx->hash_cache;
+	if ( (cache == NULL) || (par3_ctx->hash_cache_force != 0) )
+		return NULL;
+
+	index = cache_search(cache, key);
+	if (index < 0)
+		return NULL;
+	entry = cache->entry_list[index];
+	if ( (entry->key.size != key->size) || (entry->key.mtime != key->mtime) )
+		return NULL;
+	if ((entry->flag & flag) != flag)
+		return NULL;
+	if ( (flag & 2) && (entry->block_size != block_size) )
+		return NULL;
+
+	return entry;
+}
+
+void cache_keep(PAR3_CTX *par3_ctx, CACHE_KEY *key)
+{
+	int64_t index;
+	HASH_CACHE *cache;
+
+	cache = par3_ctx->hash_cache;
+	if (cache == NULL)
+		return;
+
+	index = cache_search(cache, key);
+	if ( (index >= 0) && (memcmp(&(cache->entry_list[index]->key), key, sizeof(CACHE_KEY)) == 0) )
+		cache->used_list[index] = 1;
+}
+
+int cache_add(PAR3_CTX *par3_ctx, CACHE_KEY *key, PAR3_FILE_CTX *file_p,
+		uint64_t block_size, MAP_FILE_HASH *hash_p, MAP_HASH_CTX *block_hash)
+{
+	int64_t index;
+	uint64_t block_count;
+	HASH_CACHE *cache;
+	CACHE_ENTRY *entry, *old_entry;
+
+	cache = par3_ctx->hash_cache;
+	if (cache == NULL)
+		return 0;
+
+	block_count = 0;
+	if ( (hash_p != NULL) && (block_size > 0) )
+		block_count = key->size / block_size;
+
+	// Don't replace checksums of blocks by checksums of file only.
+	old_entry = NULL;
+	index = cache_search(cache, key);
+	if (index >= 0){
+		old_entry = cache->entry_list[index];
+		cache->used_list[index] = 1;
+		if ( (hash_p == NULL) && (old_entry->flag & 2) && (memcmp(&(old_entry->key), key, sizeof(CACHE_KEY)) == 0)
+				&& (memcmp(old_entry->hash, file_p->hash, 16) == 0) )
+			return 0;
+	}
+
+	entry = calloc(1, sizeof(CACHE_ENTRY) + sizeof(MAP_HASH_CTX) * block_count);
+	if (entry == NULL){
+		perror("Failed to allocate memory for hash cache");
+		return RET_MEMORY_ERROR;
+	}
+	memcpy(&(entry->key), key, sizeof(CACHE_KEY));
+	entry->flag = 1;
+	entry->block_size = block_size;
+	entry->crc = file_p->crc;
+	memcpy(entry->hash, file_p->hash, 16);
+	if (hash_p != NULL){
+		entry->flag |= 2;
+		entry->tail_crc = hash_p->tail_crc;
+		memcpy(&(entry->tail), &(hash_p->tail), sizeof(MAP_HASH_CTX));
+		memcpy(entry->tail_data, hash_p->tail_data, 40);
+		if (block_count > 0)
+			memcpy(entry + 1, block_hash + hash_p->block, sizeof(MAP_HASH_CTX) * block_count);
+	}
+	cache->modified = 1;
+
+	if (old_entry != NULL){
+		if ( ((uint8_t *)old_entry < cache->buf) || ((uint8_t *)old_entry >= cache->buf + cache->buf_size) )
+			free(old_entry);
+		cache->entry_list[index] = entry;
+		return 0;
+	}
+
+	if (cache->entry_count >= cache->entry_max){
+		CACHE_ENTRY **new_list;
+
+		uint8_t *new_used;
+
+		new_list = realloc(cache->entry_list, sizeof(CACHE_ENTRY *) * cache->entry_max * 2);
+		if (new_list == NULL){
+			perror("Failed to re-allocate memory for hash cache");
+			free(entry);
+			return RET_MEMORY_ERROR;
+		}
+		cache->entry_list = new_list;
+		new_used = realloc(cache->used_list, (size_t)(cache->entry_max * 2));
+		if (new_used == NULL){
+			perror("Failed to re-allocate memory for hash cache");
+			free(entry);
+			return RET_MEMORY_ERROR;
+		}
+		cache->used_list = new_used;
+		cache->entry_max *= 2;
+		cache->entry_list[cache->entry_count] = entry;
+		cache->used_list[cache->entry_count] = 1;
+		cache->entry_count++;
+		return cache_make_index(cache);
+	}
+	cmp_list_add(cache->cmp_list, cache->cmp_mask, key_crc(key), cache->entry_count);
+	cache->entry_list[cache->entry_count] = entry;
+	cache->used_list[cache->entry_count] = 1;
+	cache->entry_count++;
+
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+// Persistent cache of checksums of input files.
+// A file is identified by device and inode, and checked by size and modification time.
+// Include map.h before this.
+
+// identity of a file
+typedef struct {
+	uint64_t device;
+	uint64_t inode;
+	uint64_t size;
+	int64_t mtime;		// modification time in nanoseconds
+} CACHE_KEY;
+
+// A record in cache file. Checksums of full size blocks follow it.
+typedef struct {
+	CACHE_KEY key;
+	uint64_t flag;		// 1 = checksums of file, 2 = checksums of blocks and chunk tail, too
+	uint64_t block_size;	// block size of stored checksums
+	uint64_t crc;		// CRC-64 of the first 16 KB
+	uint8_t hash[16];	// BLAKE3 of whole file
+	uint64_t tail_crc;	// CRC-64 of the first 40 bytes in chunk tail
+	MAP_HASH_CTX tail;	// checksums of whole chunk tail
+	uint8_t tail_data[40];	// chunk tail of 1 ~ 39 bytes
+} CACHE_ENTRY;
+
+int cache_load(PAR3_CTX *par3_ctx);
+int cache_save(PAR3_CTX *par3_ctx);
+void cache_release(PAR3_CTX *par3_ctx);
+
+// Get identity of a file. Return 0 on success.
+int cache_key(char *file_name, CACHE_KEY *key);
+
+// Return a record of the same file, or NULL.
+// It's safe to call from threads, while no record is added.
+CACHE_ENTRY * cache_find(PAR3_CTX *par3_ctx, CACHE_KEY *key, uint64_t flag, uint64_t block_size);
+
+// Mark a found record as used, so that it's kept in cache file.
+// Call this after using cached checksums, while threads are idle.
+void cache_keep(PAR3_CTX *par3_ctx, CACHE_KEY *key);
+
+// Add or replace a record. When hash_p is NULL, only checksums of file are stored.
+int cache_add(PAR3_CTX *par3_ctx, CACHE_KEY *key, PAR3_FILE_CTX *file_p,
+		uint64_t block_size, MAP_FILE_HASH *hash_p, MAP_HASH_CTX *block_hash);
+
+#endif // __CACHE_H__
@@ -0,0 +1,32 @@
+#ifndef __CPU_H__
+#define __CPU_H__
+
+// CPU features, which are checked at runtime.
+#define CPU_SSSE3		0x01
+#define CPU_AVX2		0x02
+#define CPU_AVX512BW	0x04
+#define CPU_PCLMUL		0x08
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86
+#endif
+
+// Enable instruction set for each function, instead of global compiler flags.
+// MSVC doesn't need them, because it allows any intrinsics.
+#if defined(CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSSE3	__attribute__((target("ssse3")))
+#define TARGET_AVX2		__attribute__((target("avx2")))
+#define TARGET_AVX512BW	__attribute__((target("avx512f,avx512bw")))
+#define TARGET_PCLMUL	__attribute__((target("sse4.1,pclmul")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#define TARGET_AVX512BW
+#define TARGET_PCLMUL
+#endif
+
+int cpu_feature(void);
+void cpu_feature_disable(int flag);
+const char * cpu_feature_name(void);
+
+#endif // __CPU_H__
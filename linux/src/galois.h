@@ -13,6 +13,7 @@ void gf8_region_multiply(uint8_t *galois_log_table,
 						uint8_t *r2,		/* If r2 != NULL, products go here */
 						int add);
 
+uint32_t gf8_region_parity(int prim_poly, uint32_t sum, uint8_t *buf, size_t size);
 void gf8_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size);
 int gf8_region_check_parity(int galois_poly, uint8_t *buf, size_t region_size);
 
@@ -31,6 +32,7 @@ void gf16_region_multiply(uint16_t *galois_log_table,
 						uint8_t *r2,		/* If r2 != NULL, products go here */
 						int add);
 
+uint32_t gf16_region_parity(int prim_poly, uint32_t sum, uint8_t *buf, size_t size);
 void gf16_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size);
 int gf16_region_check_parity(int galois_poly, uint8_t *buf, size_t region_size);
 
@@ -33,7 +33,39 @@ plank@cs.utk.edu
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "cpu.h"
+
+
+// Create 4-bit split tables for the multiplier.
+// table[32 * k + n] is low byte of (multby * (n << 4k)),
+// table[32 * k + 16 + n] is high byte of it.
+static void gf16_create_nibble_table(int prim_poly, int multby, uint8_t *table)
+{
+	int j, k, n, v;
+	uint16_t part[16];
+
+	v = multby;
+	for (k = 0; k < 4; k++){
+		part[0] = 0;
+		for (j = 1; j < 16; j <<= 1) {
+			for (n = 0; n < j; n++)
+				part[n ^ j] = (uint16_t)(v ^ part[n]);
+
+			// v = v * 2
+			v = (v & (1 << 15)) ? ((v << 1) ^ prim_poly) : (v << 1);
+		}
+		for (n = 0; n < 16; n++){
+			table[32 * k + n] = (uint8_t)(part[n]);
+			table[32 * k + 16 + n] = (uint8_t)(part[n] >> 8);
+		}
+	}
+}
+
+// 4-bit split tables of 64 multipliers (n << 4k) are made at first.
+// Because tables are linear, table of any multiplier is XOR of 4 tables.
+#define GF16_NIBBLE_SIZE	(128 * 64)
 
 // Create tables for 16-bit Galois Field
 // Return main pointer of tables.
@@ -41,10 +73,12 @@ uint16_t * gf16_create_table(int prim_poly)
 {
 	int j, b;
 	uint16_t *galois_log_table, *galois_ilog_table;
+	uint8_t *nibble_table;
 
 	// Allocate tables on memory
 	// To fit CPU cache memory, table uses 16-bit integer.
-	galois_log_table = malloc(sizeof(uint16_t) * 65536 * 2);
+	// 4-bit split tables for SIMD (8 KB) follow log tables.
+	galois_log_table = malloc(sizeof(uint16_t) * 65536 * 2 + GF16_NIBBLE_SIZE);
 	if (galois_log_table == NULL)
 		return NULL;
 	galois_ilog_table = galois_log_table + 65536;
@@ -62,6 +96,11 @@ uint16_t * gf16_create_table(int prim_poly)
 			b = (b ^ prim_poly) & 65535;
 	}
 
+	// Table of (n << 4k) is at nibble_table + 128 * (16 * k + n).
+	nibble_table = (uint8_t *)(galois_log_table + 65536 * 2);
+	for (j = 0; j < 64; j++)
+		gf16_create_nibble_table(prim_poly, (j & 15) << ((j >> 4) * 4), nibble_table + 128 * j);
+
 	return galois_log_table;
 }
 
@@ -115,6 +154,235 @@ int gf16_reciprocal(uint16_t *galois_log_table, int y)
 }
 
 
+// SIMD version of region multiply, which uses 4-bit split tables (PSHUFB).
+// Low bytes and high bytes of 16-bit integers are separated at loading,
+// and each 4-bit piece looks up a pair of tables for low and high bytes.
+// Kernels are selected at runtime by CPU features.
+#ifdef CPU_X86
+#define GF16_SIMD
+#include <immintrin.h>
+
+// Return number of processed bytes. It processes 128 bytes per loop.
+static TARGET_AVX512BW size_t gf16_region_multiply_avx512(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m512i t0l, t0h, t1l, t1h, t2l, t2h, t3l, t3h;
+	__m512i mask, deint, a, b, lo, hi, n0, n1, n2, n3, rl, rh;
+	size_t i;
+
+	t0l = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table      )));
+	t0h = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  16)));
+	t1l = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  32)));
+	t1h = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  48)));
+	t2l = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  64)));
+	t2h = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  80)));
+	t3l = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table +  96)));
+	t3h = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table + 112)));
+	mask = _mm512_set1_epi8(0x0F);
+	deint = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15));
+
+	for (i = 0; i + 128 <= nbytes; i += 128){
+		// Separate low bytes and high bytes in each 128-bit lane.
+		a = _mm512_shuffle_epi8(_mm512_loadu_si512((void *)(src + i)), deint);
+		b = _mm512_shuffle_epi8(_mm512_loadu_si512((void *)(src + i + 64)), deint);
+		lo = _mm512_unpacklo_epi64(a, b);
+		hi = _mm512_unpackhi_epi64(a, b);
+
+		n0 = _mm512_and_si512(lo, mask);
+		n1 = _mm512_and_si512(_mm512_srli_epi16(lo, 4), mask);
+		n2 = _mm512_and_si512(hi, mask);
+		n3 = _mm512_and_si512(_mm512_srli_epi16(hi, 4), mask);
+
+		// XOR of 3 values at once (0x96 = A ^ B ^ C)
+		rl = _mm512_ternarylogic_epi32(_mm512_shuffle_epi8(t0l, n0), _mm512_shuffle_epi8(t1l, n1), _mm512_shuffle_epi8(t2l, n2), 0x96);
+		rl = _mm512_xor_si512(rl, _mm512_shuffle_epi8(t3l, n3));
+		rh = _mm512_ternarylogic_epi32(_mm512_shuffle_epi8(t0h, n0), _mm512_shuffle_epi8(t1h, n1), _mm512_shuffle_epi8(t2h, n2), 0x96);
+		rh = _mm512_xor_si512(rh, _mm512_shuffle_epi8(t3h, n3));
+
+		// Interleave low bytes and high bytes again.
+		a = _mm512_unpacklo_epi8(rl, rh);
+		b = _mm512_unpackhi_epi8(rl, rh);
+		if (add){
+			a = _mm512_xor_si512(a, _mm512_loadu_si512((void *)(dst + i)));
+			b = _mm512_xor_si512(b, _mm512_loadu_si512((void *)(dst + i + 64)));
+		}
+		_mm512_storeu_si512((void *)(dst + i), a);
+		_mm512_storeu_si512((void *)(dst + i + 64), b);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes. It processes 64 bytes per loop.
+static TARGET_AVX2 size_t gf16_region_multiply_avx2(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m256i t0l, t0h, t1l, t1h, t2l, t2h, t3l, t3h;
+	__m256i mask, deint, a, b, lo, hi, n0, n1, n2, n3, rl, rh;
+	size_t i;
+
+	t0l = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table      )));
+	t0h = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  16)));
+	t1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  32)));
+	t1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  48)));
+	t2l = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  64)));
+	t2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  80)));
+	t3l = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table +  96)));
+	t3h = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table + 112)));
+	mask = _mm256_set1_epi8(0x0F);
+	deint = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15));
+
+	for (i = 0; i + 64 <= nbytes; i += 64){
+		// Separate low bytes and high bytes in each 128-bit lane.
+		a = _mm256_shuffle_epi8(_mm256_loadu_si256((__m256i *)(src + i)), deint);
+		b = _mm256_shuffle_epi8(_mm256_loadu_si256((__m256i *)(src + i + 32)), deint);
+		lo = _mm256_unpacklo_epi64(a, b);
+		hi = _mm256_unpackhi_epi64(a, b);
+
+		n0 = _mm256_and_si256(lo, mask);
+		n1 = _mm256_and_si256(_mm256_srli_epi16(lo, 4), mask);
+		n2 = _mm256_and_si256(hi, mask);
+		n3 = _mm256_and_si256(_mm256_srli_epi16(hi, 4), mask);
+
+		rl = _mm256_xor_si256(_mm256_shuffle_epi8(t0l, n0), _mm256_shuffle_epi8(t1l, n1));
+		rl = _mm256_xor_si256(rl, _mm256_shuffle_epi8(t2l, n2));
+		rl = _mm256_xor_si256(rl, _mm256_shuffle_epi8(t3l, n3));
+		rh = _mm256_xor_si256(_mm256_shuffle_epi8(t0h, n0), _mm256_shuffle_epi8(t1h, n1));
+		rh = _mm256_xor_si256(rh, _mm256_shuffle_epi8(t2h, n2));
+		rh = _mm256_xor_si256(rh, _mm256_shuffle_epi8(t3h, n3));
+
+		// Interleave low bytes and high bytes again.
+		a = _mm256_unpacklo_epi8(rl, rh);
+		b = _mm256_unpackhi_epi8(rl, rh);
+		if (add){
+			a = _mm256_xor_si256(a, _mm256_loadu_si256((__m256i *)(dst + i)));
+			b = _mm256_xor_si256(b, _mm256_loadu_si256((__m256i *)(dst + i + 32)));
+		}
+		_mm256_storeu_si256((__m256i *)(dst + i), a);
+		_mm256_storeu_si256((__m256i *)(dst + i + 32), b);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes. It processes 32 bytes per loop.
+static TARGET_SSSE3 size_t gf16_region_multiply_ssse3(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m128i t0l, t0h, t1l, t1h, t2l, t2h, t3l, t3h;
+	__m128i mask, deint, a, b, lo, hi, n0, n1, n2, n3, rl, rh;
+	size_t i;
+
+	t0l = _mm_loadu_si128((__m128i *)(table      ));
+	t0h = _mm_loadu_si128((__m128i *)(table +  16));
+	t1l = _mm_loadu_si128((__m128i *)(table +  32));
+	t1h = _mm_loadu_si128((__m128i *)(table +  48));
+	t2l = _mm_loadu_si128((__m128i *)(table +  64));
+	t2h = _mm_loadu_si128((__m128i *)(table +  80));
+	t3l = _mm_loadu_si128((__m128i *)(table +  96));
+	t3h = _mm_loadu_si128((__m128i *)(table + 112));
+	mask = _mm_set1_epi8(0x0F);
+	deint = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+	for (i = 0; i + 32 <= nbytes; i += 32){
+		// Separate low bytes and high bytes.
+		a = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(src + i)), deint);
+		b = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)(src + i + 16)), deint);
+		lo = _mm_unpacklo_epi64(a, b);
+		hi = _mm_unpackhi_epi64(a, b);
+
+		n0 = _mm_and_si128(lo, mask);
+		n1 = _mm_and_si128(_mm_srli_epi16(lo, 4), mask);
+		n2 = _mm_and_si128(hi, mask);
+		n3 = _mm_and_si128(_mm_srli_epi16(hi, 4), mask);
+
+		rl = _mm_xor_si128(_mm_shuffle_epi8(t0l, n0), _mm_shuffle_epi8(t1l, n1));
+		rl = _mm_xor_si128(rl, _mm_shuffle_epi8(t2l, n2));
+		rl = _mm_xor_si128(rl, _mm_shuffle_epi8(t3l, n3));
+		rh = _mm_xor_si128(_mm_shuffle_epi8(t0h, n0), _mm_shuffle_epi8(t1h, n1));
+		rh = _mm_xor_si128(rh, _mm_shuffle_epi8(t2h, n2));
+		rh = _mm_xor_si128(rh, _mm_shuffle_epi8(t3h, n3));
+
+		// Interleave low bytes and high bytes again.
+		a = _mm_unpacklo_epi8(rl, rh);
+		b = _mm_unpackhi_epi8(rl, rh);
+		if (add){
+			a = _mm_xor_si128(a, _mm_loadu_si128((__m128i *)(dst + i)));
+			b = _mm_xor_si128(b, _mm_loadu_si128((__m128i *)(dst + i + 16)));
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), a);
+		_mm_storeu_si128((__m128i *)(dst + i + 16), b);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes.
+static size_t gf16_region_multiply_simd(uint8_t *nibble_table, int multby, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	uint64_t table[16], *t0, *t1, *t2, *t3;
+	size_t i;
+	int flag;
+
+	// Make table of multby from precomputed tables of each 4-bit.
+	t0 = (uint64_t *)(nibble_table + 128 * (multby & 15));
+	t1 = (uint64_t *)(nibble_table + 128 * (16 + ((multby >> 4) & 15)));
+	t2 = (uint64_t *)(nibble_table + 128 * (32 + ((multby >> 8) & 15)));
+	t3 = (uint64_t *)(nibble_table + 128 * (48 + ((multby >> 12) & 15)));
+	for (i = 0; i < 16; i++)
+		table[i] = t0[i] ^ t1[i] ^ t2[i] ^ t3[i];
+
+	i = 0;
+	flag = cpu_feature();
+	if (flag & CPU_AVX512BW)
+		i += gf16_region_multiply_avx512((uint8_t *)table, src + i, dst + i, nbytes - i, add);
+	if (flag & CPU_AVX2)
+		i += gf16_region_multiply_avx2((uint8_t *)table, src + i, dst + i, nbytes - i, add);
+	if (flag & CPU_SSSE3)
+		i += gf16_region_multiply_ssse3((uint8_t *)table, src + i, dst + i, nbytes - i, add);
+
+	return i;
+}
+
+// XOR region, and return number of processed bytes.
+static TARGET_AVX2 size_t gf16_region_xor_avx2(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i + 32 <= nbytes; i += 32){
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(
+				_mm256_loadu_si256((__m256i *)(dst + i)), _mm256_loadu_si256((__m256i *)(src + i)) ));
+	}
+
+	return i;
+}
+
+static TARGET_SSSE3 size_t gf16_region_xor_ssse3(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= nbytes; i += 16){
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(
+				_mm_loadu_si128((__m128i *)(dst + i)), _mm_loadu_si128((__m128i *)(src + i)) ));
+	}
+
+	return i;
+}
+
+static size_t gf16_region_xor_simd(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+	int flag;
+
+	i = 0;
+	flag = cpu_feature();
+	if (flag & CPU_AVX2)
+		i += gf16_region_xor_avx2(src + i, dst + i, nbytes - i);
+	if (flag & CPU_SSSE3)
+		i += gf16_region_xor_ssse3(src + i, dst + i, nbytes - i);
+
+	return i;
+}
+#endif
+
+
 // This is based on GF-Complete, Revision 1.03.
 // gf_w16_split_8_16_lazy_multiply_region
 
@@ -163,7 +431,7 @@ void gf16_region_multiply(uint16_t *galois_log_table,
 {
 	uint16_t *ur1, *ur2;
 	int prod, v;
-	size_t i;
+	size_t i, done;
 
 	ur1 = (uint16_t *) region;
 	ur2 = (r2 == NULL) ? ur1 : (uint16_t *) r2;
@@ -171,102 +439,111 @@ void gf16_region_multiply(uint16_t *galois_log_table,
 
 	if (multby == 0) {
 		if (add == 0){
-			for (i = 0; i < nbytes; i++) {
-				ur2[i] = 0;
-			}
+			memset(ur2, 0, nbytes * 2);
 		}
 
 	} else if (multby == 1) {
 		if (add == 0){
 			if (r2 != NULL){
-				for (i = 0; i < nbytes; i++) {
-					ur2[i] = ur1[i];
-				}
+				memcpy(ur2, ur1, nbytes * 2);
 			}
 		} else {
 			if (r2 != NULL){
-				for (i = 0; i < nbytes; i++) {
+				done = 0;
+#ifdef GF16_SIMD
+				done = gf16_region_xor_simd(region, r2, nbytes * 2) / 2;
+#endif
+				for (i = done; i < nbytes; i++) {
 					ur2[i] ^= ur1[i];
 				}
 			} else {
-				for (i = 0; i < nbytes; i++) {
-					ur2[i] = 0;
-				}
+				memset(ur2, 0, nbytes * 2);
 			}
 		}
 
-	// Use 8-bit split tables, only when nbytes is enough long.
-	} else if (nbytes >= 1000){
-		int j, k, prim_poly;
-		uint16_t htable[256], ltable[256];
-
-		// This table setup requires a bit time.
-		prim_poly = galois_log_table[0] | 0x10000;
-		v = multby;
-		ltable[0] = 0;
-		for (j = 1; j < 256; j <<= 1) {
-			for (k = 0; k < j; k++)
-				ltable[k^j] = (v ^ ltable[k]);
-
-			// v = v * 2
-			v = (v & (1 << 15)) ? ((v << 1) ^ prim_poly) : (v << 1);
-		}
-		htable[0] = 0;
-		for (j = 1; j < 256; j <<= 1) {
-			for (k = 0; k < j; k++)
-				htable[k^j] = (v ^ htable[k]);
+	} else {
+		// Multiply most bytes by SIMD, and calculate remaining bytes later.
+		done = 0;
+#ifdef GF16_SIMD
+		done = gf16_region_multiply_simd((uint8_t *)(galois_log_table + 65536 * 2), multby,
+					region, (uint8_t *)ur2, nbytes * 2, (r2 != NULL) && (add != 0)) / 2;
+		if (done == nbytes)
+			return;
+#endif
+
+		// Use 8-bit split tables, only when nbytes is enough long.
+		if (nbytes - done >= 1000){
+			int j, k, prim_poly;
+			uint16_t htable[256], ltable[256];
+
+			// This table setup requires a bit time.
+			prim_poly = galois_log_table[0] | 0x10000;
+			v = multby;
+			ltable[0] = 0;
+			for (j = 1; j < 256; j <<= 1) {
+				for (k = 0; k < j; k++)
+					ltable[k^j] = (v ^ ltable[k]);
+
+				// v = v * 2
+				v = (v & (1 << 15)) ? ((v << 1) ^ prim_poly) : (v << 1);
+			}
+			htable[0] = 0;
+			for (j = 1; j < 256; j <<= 1) {
+				for (k = 0; k < j; k++)
+					htable[k^j] = (v ^ htable[k]);
 
-			// v = v * 2
-			v = (v & (1 << 15)) ? ((v << 1) ^ prim_poly) : (v << 1);
-		}
+				// v = v * 2
+				v = (v & (1 << 15)) ? ((v << 1) ^ prim_poly) : (v << 1);
+			}
 
-		if ( (r2 == NULL) || (add == 0) ) {
-			for (i = 0; i < nbytes; i++) {
-				v = ur1[i];
-				if (v == 0) {
-					ur2[i] = 0;
-				} else {
-				    prod = htable[v >> 8];
-				    prod ^= ltable[v & 0xFF];
-					ur2[i] = prod;
+			if ( (r2 == NULL) || (add == 0) ) {
+				for (i = done; i < nbytes; i++) {
+					v = ur1[i];
+					if (v == 0) {
+						ur2[i] = 0;
+					} else {
+					    prod = htable[v >> 8];
+					    prod ^= ltable[v & 0xFF];
+						ur2[i] = prod;
+					}
 				}
-			}
-		} else {
-			for (i = 0; i < nbytes; i++) {
-				v = ur1[i];
-				if (v != 0) {
-				    prod = htable[v >> 8];
-				    prod ^= ltable[v & 0xFF];
-					ur2[i] ^= prod;
+			} else {
+				for (i = done; i < nbytes; i++) {
+					v = ur1[i];
+					if (v != 0) {
+					    prod = htable[v >> 8];
+					    prod ^= ltable[v & 0xFF];
+						ur2[i] ^= prod;
+					}
 				}
 			}
-		}
 
-	// Use Log & iLog tables
-	} else {
-		uint16_t *galois_ilog_table;
-
-		galois_ilog_table = galois_log_table + 65536;
-		v = galois_log_table[multby];
-
-		if ( (r2 == NULL) || (add == 0) ) {
-			for (i = 0; i < nbytes; i++) {
-				if (ur1[i] == 0) {
-					ur2[i] = 0;
-				} else {
-					prod = galois_log_table[ur1[i]] + v;
-					if (prod >= 65535)
-						prod -= 65535;
-					ur2[i] = galois_ilog_table[prod];
-				}
-			}
+		// Use Log & iLog tables
 		} else {
-			for (i = 0; i < nbytes; i++) {
-				if (ur1[i] != 0) {
-					prod = galois_log_table[ur1[i]] + v;
-					if (prod >= 65535)
-						prod -= 65535;
-					ur2[i] ^= galois_ilog_table[prod];
+			uint16_t *galois_ilog_table;
+
+			galois_ilog_table = galois_log_table + 65536;
+			v = galois_log_table[multby];
+
+			if ( (r2 == NULL) || (add == 0) ) {
+				for (i = done; i < nbytes; i++) {
+					if (ur1[i] == 0) {
+						ur2[i] = 0;
+					} else {
+						prod = galois_log_table[ur1[i]] + v;
+						if (prod >= 65535)
+							prod -= 65535;
+						ur2[i] = galois_ilog_table[prod];
+					}
+				}
+			} else {
+				for (i = done; i < nbytes; i++) {
+					if (ur1[i] != 0) {
+						prod = galois_log_table[ur1[i]] + v;
+						if (prod >= 65535)
+							prod -= 65535;
+						ur2[i] ^= galois_ilog_table[prod];
+					}
 				}
 			}
 		}
@@ -274,16 +551,15 @@ void gf16_region_multiply(uint16_t *galois_log_table,
 }
 
 
-// Create parity bytes in the region
-void gf16_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
+// Update parity with 4-byte words in the region
+uint32_t gf16_region_parity(int prim_poly, uint32_t sum, uint8_t *buf, size_t size)
 {
-	uint32_t sum, temp, mask;
+	uint32_t temp, mask;
 
 	prim_poly &= 0xFFFF;	// reduce to 16-bit value
 
 	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
+	while (size >= 4){
 		temp = *((uint32_t *)buf);
 
 		// store highest bits of each 16-bit integer
@@ -303,46 +579,25 @@ void gf16_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
 	 	// add new 4 bytes
 		sum ^= temp;
 
-		region_size -= 4;
+		size -= 4;
 		buf += 4;
 	}
 
-	((uint32_t *)buf)[0] = sum;
+	return sum;
+}
+
+// Create parity bytes in the region
+void gf16_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
+{
+	// Parity is saved at the last 4-bytes.
+	((uint32_t *)(buf + region_size - 4))[0] = gf16_region_parity(prim_poly, 0, buf, region_size - 4);
 }
 
 // Check parity bytes in the region
 int gf16_region_check_parity(int galois_poly, uint8_t *buf, size_t region_size)
 {
-	uint32_t sum, temp, mask;
-
-	galois_poly &= 0xFFFF;	// reduce to 16-bit value
-
-	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
-		temp = *((uint32_t *)buf);
-
-		// store highest bits of each 8-bit integer
-		mask = (sum & 0x80008000) >> 15;	// 0x00010001 or 0x00000000
-
-		// previous value multiply by 2
-		//sum = (sum & 0x7FFF7FFF) << 1;
-
-		// previous value multiply by 3
-		sum ^= (sum & 0x7FFF7FFF) << 1;
-
-		// galois_poly may be 0x100B
-		sum ^= mask * galois_poly;	// 0x100B100B or 0x00000000
-
-	 	// add new 4 bytes
-		sum ^= temp;
-
-		region_size -= 4;
-		buf += 4;
-	}
-
 	// Parity is 4 bytes.
-	if (((uint32_t *)buf)[0] != sum)
+	if (((uint32_t *)(buf + region_size - 4))[0] != gf16_region_parity(galois_poly, 0, buf, region_size - 4))
 		return 1;
 
 	return 0;
@@ -33,6 +33,9 @@ plank@cs.utk.edu
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
 
 
 // Create tables for 8-bit Galois Field
@@ -41,11 +44,12 @@ uint8_t * gf8_create_table(int prim_poly)
 {
 	int j, b;
 	int x, y, logx, sum_j;
-	uint8_t *galois_log_table, *galois_ilog_table, *galois_mult_table;
+	uint8_t *galois_log_table, *galois_ilog_table, *galois_mult_table, *nibble_table;
 
 	// Allocate tables on memory
 	// To fit CPU cache memory, table uses 8-bit integer.
-	galois_log_table = malloc(sizeof(uint8_t) * 256 * (1 + 1 + 256));
+	// 4-bit split tables for SIMD (8 KB) follow multiply tables.
+	galois_log_table = malloc(sizeof(uint8_t) * 256 * (1 + 1 + 256 + 32));
 	if (galois_log_table == NULL)
 		return NULL;
 	galois_ilog_table = galois_log_table + 256;
@@ -86,6 +90,16 @@ uint8_t * gf8_create_table(int prim_poly)
 		}
 	}
 
+	// Set 4-bit split tables for each multiplier
+	// nibble_table[32 * x + n] is (x * n), nibble_table[32 * x + 16 + n] is (x * (n << 4)).
+	nibble_table = galois_mult_table + 256 * 256;
+	for (x = 0; x < 256; x++){
+		for (y = 0; y < 16; y++){
+			nibble_table[32 * x + y] = galois_mult_table[(x << 8) | y];
+			nibble_table[32 * x + 16 + y] = galois_mult_table[(x << 8) | (y << 4)];
+		}
+	}
+
 	return galois_log_table;
 }
 
@@ -152,6 +166,139 @@ int gf8_reciprocal(uint8_t *galois_log_table, int y)
 }
 
 
+// SIMD version of region multiply, which uses 4-bit split tables (PSHUFB).
+// Kernels are selected at runtime by CPU features.
+#ifdef CPU_X86
+#define GF8_SIMD
+#include <immintrin.h>
+
+// Return number of processed bytes. It processes 64 bytes per loop.
+static TARGET_AVX512BW size_t gf8_region_multiply_avx512(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m512i tl, th, mask, a;
+	size_t i;
+
+	tl = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table     )));
+	th = _mm512_broadcast_i32x4(_mm_loadu_si128((__m128i *)(table + 16)));
+	mask = _mm512_set1_epi8(0x0F);
+
+	for (i = 0; i + 64 <= nbytes; i += 64){
+		a = _mm512_loadu_si512((void *)(src + i));
+		a = _mm512_xor_si512(_mm512_shuffle_epi8(tl, _mm512_and_si512(a, mask)),
+				_mm512_shuffle_epi8(th, _mm512_and_si512(_mm512_srli_epi16(a, 4), mask)));
+		if (add)
+			a = _mm512_xor_si512(a, _mm512_loadu_si512((void *)(dst + i)));
+		_mm512_storeu_si512((void *)(dst + i), a);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes. It processes 32 bytes per loop.
+static TARGET_AVX2 size_t gf8_region_multiply_avx2(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m256i tl, th, mask, a;
+	size_t i;
+
+	tl = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table     )));
+	th = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table + 16)));
+	mask = _mm256_set1_epi8(0x0F);
+
+	for (i = 0; i + 32 <= nbytes; i += 32){
+		a = _mm256_loadu_si256((__m256i *)(src + i));
+		a = _mm256_xor_si256(_mm256_shuffle_epi8(tl, _mm256_and_si256(a, mask)),
+				_mm256_shuffle_epi8(th, _mm256_and_si256(_mm256_srli_epi16(a, 4), mask)));
+		if (add)
+			a = _mm256_xor_si256(a, _mm256_loadu_si256((__m256i *)(dst + i)));
+		_mm256_storeu_si256((__m256i *)(dst + i), a);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes. It processes 16 bytes per loop.
+static TARGET_SSSE3 size_t gf8_region_multiply_ssse3(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	__m128i tl, th, mask, a;
+	size_t i;
+
+	tl = _mm_loadu_si128((__m128i *)(table     ));
+	th = _mm_loadu_si128((__m128i *)(table + 16));
+	mask = _mm_set1_epi8(0x0F);
+
+	for (i = 0; i + 16 <= nbytes; i += 16){
+		a = _mm_loadu_si128((__m128i *)(src + i));
+		a = _mm_xor_si128(_mm_shuffle_epi8(tl, _mm_and_si128(a, mask)),
+				_mm_shuffle_epi8(th, _mm_and_si128(_mm_srli_epi16(a, 4), mask)));
+		if (add)
+			a = _mm_xor_si128(a, _mm_loadu_si128((__m128i *)(dst + i)));
+		_mm_storeu_si128((__m128i *)(dst + i), a);
+	}
+
+	return i;
+}
+
+// Return number of processed bytes.
+// table is precomputed 4-bit split tables of multby.
+static size_t gf8_region_multiply_simd(uint8_t *table, uint8_t *src, uint8_t *dst, size_t nbytes, int add)
+{
+	size_t i;
+	int flag;
+
+	i = 0;
+	flag = cpu_feature();
+	if (flag & CPU_AVX512BW)
+		i += gf8_region_multiply_avx512(table, src + i, dst + i, nbytes - i, add);
+	if (flag & CPU_AVX2)
+		i += gf8_region_multiply_avx2(table, src + i, dst + i, nbytes - i, add);
+	if (flag & CPU_SSSE3)
+		i += gf8_region_multiply_ssse3(table, src + i, dst + i, nbytes - i, add);
+
+	return i;
+}
+
+// XOR region, and return number of processed bytes.
+static TARGET_AVX2 size_t gf8_region_xor_avx2(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i + 32 <= nbytes; i += 32){
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(
+				_mm256_loadu_si256((__m256i *)(dst + i)), _mm256_loadu_si256((__m256i *)(src + i)) ));
+	}
+
+	return i;
+}
+
+static TARGET_SSSE3 size_t gf8_region_xor_ssse3(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+
+	for (i = 0; i + 16 <= nbytes; i += 16){
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(
+				_mm_loadu_si128((__m128i *)(dst + i)), _mm_loadu_si128((__m128i *)(src + i)) ));
+	}
+
+	return i;
+}
+
+static size_t gf8_region_xor_simd(uint8_t *src, uint8_t *dst, size_t nbytes)
+{
+	size_t i;
+	int flag;
+
+	i = 0;
+	flag = cpu_feature();
+	if (flag & CPU_AVX2)
+		i += gf8_region_xor_avx2(src + i, dst + i, nbytes - i);
+	if (flag & CPU_SSSE3)
+		i += gf8_region_xor_ssse3(src + i, dst + i, nbytes - i);
+
+	return i;
+}
+#endif
+
+
 // Simplify and support size_t for 64-bit build
 void gf8_region_multiply(uint8_t *galois_log_table,
 						uint8_t *region,	/* Region to multiply */
@@ -160,34 +307,32 @@ void gf8_region_multiply(uint8_t *galois_log_table,
 						uint8_t *r2,		/* If r2 != NULL, products go here */
 						int add)
 {
-	size_t i;
+	size_t i, done;
 
 	if (multby == 0) {
 		if (add == 0){
 			if (r2 == NULL)
 				r2 = region;
 
-			for (i = 0; i < nbytes; i++) {
-				r2[i] = 0;
-			}
+			memset(r2, 0, nbytes);
 		}
 
 	} else if (multby == 1) {
 		if (add == 0){
 			if (r2 != NULL){
-				for (i = 0; i < nbytes; i++) {
-					r2[i] = region[i];
-				}
+				memcpy(r2, region, nbytes);
 			}
 		} else {
 			if (r2 != NULL){
-				for (i = 0; i < nbytes; i++) {
+				done = 0;
+#ifdef GF8_SIMD
+				done = gf8_region_xor_simd(region, r2, nbytes);
+#endif
+				for (i = done; i < nbytes; i++) {
 					r2[i] ^= region[i];
 				}
 			} else {
-				for (i = 0; i < nbytes; i++) {
-					region[i] = 0;
-				}
+				memset(region, 0, nbytes);
 			}
 		}
 
@@ -202,12 +347,20 @@ void gf8_region_multiply(uint8_t *galois_log_table,
 			if (r2 == NULL)
 				r2 = region;
 
-			for (i = 0; i < nbytes; i++) {
+			done = 0;
+#ifdef GF8_SIMD
+			done = gf8_region_multiply_simd(galois_log_table + 256 * (2 + 256) + 32 * multby, region, r2, nbytes, 0);
+#endif
+			for (i = done; i < nbytes; i++) {
 				prod = galois_mult_table[ region[i] ];
 				r2[i] = prod;
 			}
 		} else {
-			for (i = 0; i < nbytes; i++) {
+			done = 0;
+#ifdef GF8_SIMD
+			done = gf8_region_multiply_simd(galois_log_table + 256 * (2 + 256) + 32 * multby, region, r2, nbytes, 1);
+#endif
+			for (i = done; i < nbytes; i++) {
 				prod = galois_mult_table[ region[i] ];
 				r2[i] ^= prod;
 			}
@@ -216,16 +369,15 @@ void gf8_region_multiply(uint8_t *galois_log_table,
 }
 
 
-// Create parity bytes in the region
-void gf8_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
+// Update parity with 4-byte words in the region
+uint32_t gf8_region_parity(int prim_poly, uint32_t sum, uint8_t *buf, size_t size)
 {
-	uint32_t sum, temp, mask;
+	uint32_t temp, mask;
 
 	prim_poly &= 0xFF;	// reduce to 8-bit value
 
 	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
+	while (size >= 4){
 		temp = *((uint32_t *)buf);
 
 		// store highest bits of each 8-bit integer
@@ -245,46 +397,25 @@ void gf8_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
 	 	// add new 4 bytes
 		sum ^= temp;
 
-		region_size -= 4;
+		size -= 4;
 		buf += 4;
 	}
 
-	((uint32_t *)buf)[0] = sum;
+	return sum;
+}
+
+// Create parity bytes in the region
+void gf8_region_create_parity(int prim_poly, uint8_t *buf, size_t region_size)
+{
+	// Parity is saved at the last 4-bytes.
+	((uint32_t *)(buf + region_size - 4))[0] = gf8_region_parity(prim_poly, 0, buf, region_size - 4);
 }
 
 // Check parity bytes in the region
 int gf8_region_check_parity(int galois_poly, uint8_t *buf, size_t region_size)
 {
-	uint32_t sum, temp, mask;
-
-	galois_poly &= 0xFF;	// reduce to 8-bit value
-
-	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
-		temp = *((uint32_t *)buf);
-
-		// store highest bits of each 8-bit integer
-		mask = (sum & 0x80808080) >> 7;	// 0x01010101 or 0x00000000
-
-		// previous value multiply by 2
-		//sum = (sum & 0x7F7F7F7F) << 1;
-
-		// previous value multiply by 3
-		sum ^= (sum & 0x7F7F7F7F) << 1;
-
-		// galois_poly may be 0x1D
-		sum ^= mask * galois_poly;	// 0x1D1D1D1D or 0x00000000
-
-	 	// add new 4 bytes
-		sum ^= temp;
-
-		region_size -= 4;
-		buf += 4;
-	}
-
 	// Parity is 4 bytes.
-	if (((uint32_t *)buf)[0] != sum)
+	if (((uint32_t *)(buf + region_size - 4))[0] != gf8_region_parity(galois_poly, 0, buf, region_size - 4))
 		return 1;
 
 	return 0;
@@ -17,6 +17,8 @@ int par3_list(PAR3_CTX *par3_ctx)
 {
 	int ret;
 
+	// Data of Recovery Data Packets is read only when it's required.
+	par3_ctx->recv_packet_lazy = 1;
 	ret = read_packet(par3_ctx);
 	if (ret != 0)
 		return ret;
@@ -48,6 +50,8 @@ int par3_verify(PAR3_CTX *par3_ctx)
 	uint64_t block_count, block_available;
 	uint64_t recovery_block_available, recovery_block_lack;
 
+	// Data of Recovery Data Packets is read only when it's required.
+	par3_ctx->recv_packet_lazy = 1;
 	ret = read_packet(par3_ctx);
 	if (ret != 0)
 		return ret;
@@ -165,6 +169,11 @@ int par3_verify(PAR3_CTX *par3_ctx)
 		}
 	}
 
+	// Check data of Recovery Data Packets before counting them.
+	ret = check_recovery_packet(par3_ctx);
+	if (ret != 0)
+		return ret;
+
 	// Aggregate recovery blocks of each Matrix Packet
 	recovery_block_available = aggregate_recovery_block(par3_ctx);
 	if (par3_ctx->interleave == 0){
@@ -219,6 +228,8 @@ int par3_repair(PAR3_CTX *par3_ctx, char *temp_path)
 	uint64_t block_count, block_available;
 	uint64_t recovery_block_available, recovery_block_lack;
 
+	// Data of Recovery Data Packets is read only when it's required.
+	par3_ctx->recv_packet_lazy = 1;
 	ret = read_packet(par3_ctx);
 	if (ret != 0)
 		return ret;
@@ -336,6 +347,11 @@ int par3_repair(PAR3_CTX *par3_ctx, char *temp_path)
 		}
 	}
 
+	// Check data of Recovery Data Packets before counting them.
+	ret = check_recovery_packet(par3_ctx);
+	if (ret != 0)
+		return ret;
+
 	// Aggregate recovery blocks of each Matrix Packet
 	recovery_block_available = aggregate_recovery_block(par3_ctx);
 	if (par3_ctx->interleave == 0){
@@ -34,6 +34,10 @@
 
 #include "libpar3.h"
 #include "common.h"
+#include "cpu.h"
+#include "thread.h"
+#include "map.h"
+#include "cache.h"
 
 
 // This application name and version
@@ -81,10 +85,14 @@ static void print_help(void)
 "  -v [-v]  : Be more verbose\n"
 "  -q [-q]  : Be more quiet (-q -q gives silence)\n"
 "  -m<n>    : Memory to use\n"
+"  -T<n>    : Number of threads (0 = all processors)\n"
+"  -H<file> : Keep checksums of input files in cache file\n"
+"  -F       : Ignore cached checksums, and update cache file\n"
 "  --       : Treat all following arguments as filenames\n"
 "  -abs     : Enable absolute path\n"
 "Options: (verify or repair)\n"
 "  -S<n>    : Searching time limit (milli second)\n"
+"  -I       : Keep positions of packets in index file\n"
 "Options: (create)\n"
 "  -b<n>    : Set the Block-Count\n"
 "  -s<n>    : Set the Block-Size (don't use both -b and -s)\n"
@@ -310,6 +318,39 @@ int main(int argc, char *argv[])
 					}
 				}
 
+			} else if ( (tmp_p[0] == 'T') && (tmp_p[1] >= '0') && (tmp_p[1] <= '9') ){	// Set number of threads
+				if (par3_ctx->thread_count > 0){
+					printf("Cannot specify number of threads twice.\n");
+					ret = RET_INVALID_COMMAND;
+					goto prepare_return;
+				} else {
+					par3_ctx->thread_count = strtoul(tmp_p + 1, NULL, 10);
+					if (par3_ctx->thread_count == 0)
+						par3_ctx->thread_count = thread_cpu_count();
+					if (par3_ctx->thread_count > MAX_THREAD_COUNT)
+						par3_ctx->thread_count = MAX_THREAD_COUNT;
+				}
+
+			} else if ( (tmp_p[0] == 'H') && (tmp_p[1] != 0) ){	// Set cache file of checksums
+				if (par3_ctx->hash_cache_name[0] != 0){
+					printf("Cannot specify hash cache twice.\n");
+					ret = RET_INVALID_COMMAND;
+					goto prepare_return;
+				} else {
+					path_copy(par3_ctx->hash_cache_name, tmp_p + 1, _MAX_PATH - 32);
+				}
+
+			} else if (strcmp(tmp_p, "F") == 0){	// Calculate checksums again
+				par3_ctx->hash_cache_force = 'F';
+
+			} else if (strcmp(tmp_p, "I") == 0){	// Use index file of packet positions
+				if ( (command_operation == 'c') || (command_operation == 'i') || (command_operation == 'd') ){
+					printf("Cannot use packet index unless reading PAR files.\n");
+					ret = RET_INVALID_COMMAND;
+					goto prepare_return;
+				}
+				par3_ctx->packet_index = 'I';
+
 			} else if ( (tmp_p[0] == 'S') && (tmp_p[1] >= '0') && (tmp_p[1] <= '9') ){	// Set searching time limit
 				if ( (command_operation != 'v') && (command_operation != 'r') ){
 					printf("Cannot specify searching time limit unless reparing or verifying.\n");
@@ -684,6 +725,38 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (par3_ctx->hash_cache_name[0] != 0){
+		// Cache file is relative from current working directory, even when base-path is set.
+#ifdef _WIN32
+		if ( (par3_ctx->hash_cache_name[0] != '\\') && (par3_ctx->hash_cache_name[0] != '/')
+				&& (par3_ctx->hash_cache_name[1] != ':') ){
+#else
+		if (par3_ctx->hash_cache_name[0] != '/'){
+#endif
+			if (_getcwd(file_name, _MAX_PATH) == NULL){
+				perror("Failed to get current working directory");
+				ret = RET_FILE_IO_ERROR;
+				goto prepare_return;
+			}
+			len = strlen(file_name);
+			if (len + strlen(par3_ctx->hash_cache_name) + 2 >= _MAX_PATH - 8){
+				printf("Path of hash cache is too long\n");
+				ret = RET_INVALID_COMMAND;
+				goto prepare_return;
+			}
+			file_name[len] = '/';
+			strcpy(file_name + len + 1, par3_ctx->hash_cache_name);
+			strcpy(par3_ctx->hash_cache_name, file_name);
+		}
+		ret = cache_load(par3_ctx);
+		if (ret != 0)
+			goto prepare_return;
+	} else if (par3_ctx->hash_cache_force != 0){
+		printf("Cannot ignore hash cache without -H option.\n");
+		ret = RET_INVALID_COMMAND;
+		goto prepare_return;
+	}
+
 	if (par3_ctx->creator_packet_size > 0){
 		// Erase return code at the end of Creator text
 		par3_ctx->creator_packet_size = trim_text(par3_ctx->creator_packet, par3_ctx->creator_packet_size);
@@ -793,7 +866,14 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	// Start worker threads
+	if (par3_ctx->thread_count > 1)
+		par3_ctx->thread_count = thread_pool_start(par3_ctx->thread_count);
+
 	if (par3_ctx->noise_level >= 1){
+		printf("SIMD kernel: %s\n", cpu_feature_name());
+		if (par3_ctx->thread_count != 0)
+			printf("thread_count = %d\n", par3_ctx->thread_count);
 		if (par3_ctx->memory_limit != 0){
 			if ((par3_ctx->memory_limit & ((1 << 30) - 1)) == 0){
 				printf("memory_limit = %"PRIu64" GB\n", par3_ctx->memory_limit >> 30);
@@ -1177,9 +1257,12 @@ prepare_return:
 	if (utf8_argv_buf != NULL)
 		free(utf8_argv_buf);
 	if (par3_ctx != NULL){
+		if (cache_save(par3_ctx) != 0)
+			printf("Failed to save hash cache\n");
 		par3_release(par3_ctx);
 		free(par3_ctx);
 	}
+	thread_pool_stop();
 
 	return ret;
 }
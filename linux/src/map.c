@@ -13,29 +13,28 @@
 #include "blake3/blake3.h"
 #include "libpar3.h"
 #include "hash.h"
+#include "map.h"
 
 
 // map input file slices into input blocks without slide search
 int map_input_block(PAR3_CTX *par3_ctx)
 {
-	uint8_t *work_buf, buf_tail[40], buf_hash[16];
-	int progress_old, progress_now;
+	uint8_t *buf_hash;
+	int ret;
 	uint32_t num, num_pack, input_file_count;
 	uint32_t chunk_count, chunk_index, chunk_num;
-	int64_t find_index, previous_index, tail_offset;
+	int64_t find_index, previous_index, tail_offset, find_tail;
 	uint64_t block_size, tail_size, file_offset;
 	uint64_t block_count, block_index;
 	uint64_t slice_index, index, last_index;
-	uint64_t crc, num_dedup;
-	uint64_t progress_total, progress_step;
+	uint64_t crc, num_dedup, hash_index;
 	PAR3_FILE_CTX *file_p;
-	PAR3_CHUNK_CTX *chunk_p, *chunk_list;
+	PAR3_CHUNK_CTX *chunk_p;
 	PAR3_SLICE_CTX *slice_p, *slice_list;
 	PAR3_BLOCK_CTX *block_p, *block_list;
 	PAR3_CMP_CTX *crc_list;
-	FILE *fp;
-	blake3_hasher hasher;
-	time_t time_old, time_now;
+	MAP_FILE_HASH *file_hash, *hash_p;
+	MAP_HASH_CTX *block_hash;
 	clock_t clock_now;
 
 	// Copy variables from context to local.
@@ -56,7 +55,6 @@ int map_input_block(PAR3_CTX *par3_ctx)
 		perror("Failed to allocate memory for chunk description");
 		return RET_MEMORY_ERROR;
 	}
-	chunk_list = chunk_p;
 	par3_ctx->chunk_list = chunk_p;
 
 	// When no slide search, number of input file slice is same as number of input blocks.
@@ -78,55 +76,41 @@ int map_input_block(PAR3_CTX *par3_ctx)
 	block_list = block_p;
 	par3_ctx->block_list = block_p;
 
-	// Allocate list of CRC-64 for maximum items
-	crc_list = malloc(sizeof(PAR3_CMP_CTX) * block_count);
-	if (crc_list == NULL){
-		perror("Failed to allocate memory for comparison of CRC-64");
+	// Allocate hash index of CRC-64 for maximum items
+	if (crc_list_alloc(par3_ctx, block_count) != 0)
 		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->crc_list = crc_list;
-	par3_ctx->crc_count = 0;	// There is no item yet.
-
-	// Allocate memory to store file data temporary.
-	work_buf = malloc(block_size);
-	if (work_buf == NULL){
-		perror("Failed to allocate memory for input file data");
-		return RET_MEMORY_ERROR;
-	}
+	free(par3_ctx->tail_map_list);	// Index of chunk tails grows later.
+	par3_ctx->tail_map_list = NULL;
+	par3_ctx->tail_map_count = 0;
+	crc_list = par3_ctx->crc_list;
 
+	// Read data of input files on threads
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing hash:\n");
-		progress_total = par3_ctx->total_file_size;
-		progress_step = 0;
-		progress_old = 0;
-		time_old = time(NULL);
 		clock_now = clock();
 	}
+	ret = map_file_hash(par3_ctx, &file_hash, &block_hash);
+	if (ret != 0)
+		return ret;
 
-	// Read data of input files on memory
+	// Compare blocks in order of files
 	num_dedup = 0;
 	num_pack = 0;
 	chunk_index = 0;
 	block_index = 0;
 	slice_index = 0;
 	file_p = par3_ctx->input_file_list;
+	hash_p = file_hash;
 	for (num = 0; num < input_file_count; num++){
-		blake3_hasher_init(&hasher);
 		if (file_p->size == 0){	// Skip empty files.
-			blake3_hasher_finalize(&hasher, file_p->hash, 16);
 			file_p++;
+			hash_p++;
 			continue;
 		}
 		if (par3_ctx->noise_level >= 2){
 			printf("file size = %"PRIu64" \"%s\"\n", file_p->size, file_p->name);
 		}
 
-		fp = fopen(file_p->name, "rb");
-		if (fp == NULL){
-			perror("Failed to open input file");
-			return RET_FILE_IO_ERROR;
-		}
-
 		// First chunk in this file
 		previous_index = -4;
 		file_p->chunk = chunk_index;	// There is at least one chunk in each file.
@@ -134,41 +118,15 @@ int map_input_block(PAR3_CTX *par3_ctx)
 		chunk_p->block = 0;
 		chunk_num = 0;
 
-		// Read full size blocks
+		// Full size blocks
 		file_offset = 0;
+		hash_index = hash_p->block;
 		while (file_offset + block_size <= file_p->size){
-			// read full block from input file
-			if (fread(work_buf, 1, (size_t)block_size, fp) != (size_t)block_size){
-				perror("Failed to read full size chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += block_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + block_size < 16384){
-				file_p->crc = crc64(work_buf, (size_t)block_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
-			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
-
 			// Compare current CRC-64 with previous blocks.
-			crc = crc64(work_buf, (size_t)block_size, 0);
-			find_index = crc_list_compare(par3_ctx, crc, work_buf, buf_hash);
+			crc = block_hash[hash_index].crc;
+			buf_hash = block_hash[hash_index].hash;
+			hash_index++;
+			find_index = crc_list_compare(par3_ctx, crc, NULL, buf_hash);
 			//printf("find_index = %"PRId64", previous_index = %"PRId64"\n", find_index, previous_index);
 			if (find_index < 0){	// No match
 				// Add full size block into list
@@ -178,11 +136,7 @@ int map_input_block(PAR3_CTX *par3_ctx)
 				block_p->slice = slice_index;
 				block_p->size = block_size;
 				block_p->crc = crc;
-				if (find_index == -3){
-					memcpy(block_p->hash, buf_hash, 16);
-				} else {
-					blake3(work_buf, (size_t)block_size, block_p->hash);
-				}
+				memcpy(block_p->hash, buf_hash, 16);
 				block_p->state = 1 | 64;
 
 				// set chunk info
@@ -195,10 +149,9 @@ int map_input_block(PAR3_CTX *par3_ctx)
 						chunk_p = realloc(par3_ctx->chunk_list, sizeof(PAR3_CHUNK_CTX) * chunk_count);
 						if (chunk_p == NULL){
 							perror("Failed to re-allocate memory for chunk description");
-							fclose(fp);
+							free(file_hash);
 							return RET_MEMORY_ERROR;
 						}
-						chunk_list = chunk_p;
 						par3_ctx->chunk_list = chunk_p;
 						chunk_p += chunk_index;
 					} else {
@@ -244,10 +197,9 @@ int map_input_block(PAR3_CTX *par3_ctx)
 						chunk_p = realloc(par3_ctx->chunk_list, sizeof(PAR3_CHUNK_CTX) * chunk_count);
 						if (chunk_p == NULL){
 							perror("Failed to re-allocate memory for chunk description");
-							fclose(fp);
+							free(file_hash);
 							return RET_MEMORY_ERROR;
 						}
-						chunk_list = chunk_p;
 						par3_ctx->chunk_list = chunk_p;
 						chunk_p += chunk_index;
 					} else {
@@ -290,53 +242,25 @@ int map_input_block(PAR3_CTX *par3_ctx)
 			file_offset += block_size;
 		}
 
-		// Calculate size of chunk tail, and read it.
+		// Calculate size of chunk tail.
 		tail_size = file_p->size - file_offset;
 		//printf("tail_size = %"PRIu64", file size = %"PRIu64", offset %"PRIu64"\n", tail_size, file_p->size, file_offset);
 		if (tail_size >= 40){
-			// read chunk tail from input file on temporary block
-			if (fread(work_buf, 1, (size_t)tail_size, fp) != (size_t)tail_size){
-				perror("Failed to read tail chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += tail_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate checksum of chunk tail
-			chunk_p->tail_crc = crc64(work_buf, 40, 0);
-			blake3(work_buf, (size_t)tail_size, chunk_p->tail_hash);
+			// checksum of chunk tail
+			chunk_p->tail_crc = hash_p->tail_crc;
+			memcpy(chunk_p->tail_hash, hash_p->tail.hash, 16);
 
 			// search existing tails of same data
 			tail_offset = 0;
-			for (index = 0; index < slice_index; index++){
-				//printf("tail size = %"PRIu64"\n", slice_list[index].size);
-				if (slice_list[index].size == tail_size){	// same size tail
-					//printf("crc = 0x%016"PRIx64", 0x%016"PRIx64" chunk[%2u]\n", chunk_p->tail_crc, chunk_list[slice_list[index].chunk].tail_crc, slice_list[index].chunk);
-					if (chunk_p->tail_crc == chunk_list[slice_list[index].chunk].tail_crc){
-						if (memcmp(chunk_p->tail_hash, chunk_list[slice_list[index].chunk].tail_hash, 16) == 0){
-							tail_offset = -1;
-
-							// find the last slice info in the block
-							last_index = index;
-							while (slice_list[last_index].next != -1){
-								last_index = slice_list[last_index].next;
-							}
-							break;
-						}
-					}
+			find_tail = tail_map_compare(par3_ctx, chunk_p->tail_crc, tail_size, chunk_p->tail_hash);
+			if (find_tail >= 0){
+				tail_offset = -1;
+				index = (uint64_t)find_tail;
+
+				// find the last slice info in the block
+				last_index = index;
+				while (slice_list[last_index].next != -1){
+					last_index = slice_list[last_index].next;
 				}
 			}
 			if (tail_offset == 0){
@@ -390,7 +314,7 @@ int map_input_block(PAR3_CTX *par3_ctx)
 				// set block info (block for tails don't store checksum)
 				block_p->slice = slice_index;
 				block_p->size = tail_size;
-				block_p->crc = crc64(work_buf, (size_t)tail_size, 0);
+				block_p->crc = hash_p->tail.crc;
 				block_p->state = 2 | 64;
 				block_p++;
 				block_index++;
@@ -413,66 +337,34 @@ int map_input_block(PAR3_CTX *par3_ctx)
 
 				// update block info
 				block_list[slice_p->block].size = tail_offset + tail_size;
-				block_list[slice_p->block].crc = crc64(work_buf, (size_t)tail_size, block_list[slice_p->block].crc);
+				block_list[slice_p->block].crc = crc64_combine(block_list[slice_p->block].crc, hash_p->tail.crc, tail_size);
 			}
 
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + tail_size < 16384){
-				file_p->crc = crc64(work_buf, (size_t)tail_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
-			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
-
 			// set common slice info
 			slice_p->file = num;
 			slice_p->offset = file_offset;
 			slice_p->size = tail_size;
 			slice_p->chunk = chunk_index;
 			slice_p->next = -1;
+			if (tail_offset >= 0){	// Index new tail to find same data later.
+				if (tail_map_add(par3_ctx, chunk_p->tail_crc, slice_index) != 0)
+					return RET_MEMORY_ERROR;
+			}
 			slice_p++;
 			slice_index++;
 
 		} else if (tail_size > 0){
 			// When tail size is 1~39 bytes, it's saved in File Packet.
-			if (fread(buf_tail, 1, (size_t)tail_size, fp) != (size_t)tail_size){
-				perror("Failed to read tail chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-			memset(buf_tail + tail_size, 0, 40 - tail_size);	// zero fill the rest bytes
 			if (par3_ctx->noise_level >= 3){
 				printf("    block no  : slice no  chunk[%2u] file %d, offset %"PRIu64", tail size %"PRIu64"\n",
 						chunk_index, num, file_offset, tail_size);
 			}
 
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += tail_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + tail_size < 16384){
-				file_p->crc = crc64(buf_tail, (size_t)tail_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(buf_tail, (size_t)(16384 - file_offset), file_p->crc);
-			}
-			blake3_hasher_update(&hasher, buf_tail, (size_t)tail_size);
-
 			// copy 1 ~ 39 bytes
-			memcpy(&(chunk_p->tail_crc), buf_tail, 8);
-			memcpy(chunk_p->tail_hash, buf_tail + 8, 16);
-			memcpy(&(chunk_p->tail_block), buf_tail + 24, 8);
-			memcpy(&(chunk_p->tail_offset), buf_tail + 32, 8);
+			memcpy(&(chunk_p->tail_crc), hash_p->tail_data, 8);
+			memcpy(chunk_p->tail_hash, hash_p->tail_data + 8, 16);
+			memcpy(&(chunk_p->tail_block), hash_p->tail_data + 24, 8);
+			memcpy(&(chunk_p->tail_offset), hash_p->tail_data + 32, 8);
 		}
 		chunk_p->size += tail_size;
 
@@ -485,10 +377,9 @@ int map_input_block(PAR3_CTX *par3_ctx)
 				chunk_p = realloc(par3_ctx->chunk_list, sizeof(PAR3_CHUNK_CTX) * chunk_count);
 				if (chunk_p == NULL){
 					perror("Failed to re-allocate memory for chunk description");
-					fclose(fp);
+					free(file_hash);
 					return RET_MEMORY_ERROR;
 				}
-				chunk_list = chunk_p;
 				par3_ctx->chunk_list = chunk_p;
 				chunk_p += chunk_index;
 			} else {
@@ -497,27 +388,21 @@ int map_input_block(PAR3_CTX *par3_ctx)
 		}
 		file_p->chunk_num = chunk_num;
 
-		blake3_hasher_finalize(&hasher, file_p->hash, 16);
-		if (fclose(fp) != 0){
-			perror("Failed to close input file");
-			return RET_FILE_IO_ERROR;
-		}
-
 		file_p++;
+		hash_p++;
 	}
 
 	// Release temporary buffer.
 	free(crc_list);
 	par3_ctx->crc_list = NULL;
+	par3_ctx->crc_filter = NULL;
+	free(par3_ctx->tail_map_list);
+	par3_ctx->tail_map_list = NULL;
+	par3_ctx->tail_map_count = 0;
 	par3_ctx->crc_count = 0;
-	free(work_buf);
-	par3_ctx->work_buf = NULL;
+	free(file_hash);
 
 	if (par3_ctx->noise_level >= 0){
-		if (par3_ctx->noise_level <= 2){
-			if (progress_step < progress_total)
-				printf("Didn't finish progress. %"PRIu64" / %"PRIu64"\n", progress_step, progress_total);
-		}
 		clock_now = clock() - clock_now;
 		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
 		printf("\n");
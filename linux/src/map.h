@@ -1,4 +1,25 @@
 
+// checksums of a full size block or chunk tail
+typedef struct {
+	uint64_t crc;		// CRC-64 of whole data
+	uint8_t hash[16];	// BLAKE3 of whole data
+} MAP_HASH_CTX;
+
+// checksums of an input file, which are calculated before mapping
+typedef struct {
+	uint64_t block;		// index of the first full size block in list of block checksums
+	uint64_t tail_crc;	// CRC-64 of the first 40 bytes in chunk tail
+	MAP_HASH_CTX tail;	// checksums of whole chunk tail
+	uint8_t tail_data[40];	// chunk tail of 1 ~ 39 bytes, zero filled
+	int ret;
+	int cached;		// 1 = read from hash cache, -1 = cannot store in cache
+} MAP_FILE_HASH;
+
+// Read input files on threads, and calculate checksums of blocks and files.
+// List of block checksums follows list of file checksums in the same memory.
+// Caller frees the file list after mapping. When it fails, no need to free.
+int map_file_hash(PAR3_CTX *par3_ctx, MAP_FILE_HASH **file_hash_list, MAP_HASH_CTX **block_hash_list);
+
 // map chunk tails, when there are no input blocks.
 int map_chunk_tail(PAR3_CTX *par3_ctx);
 
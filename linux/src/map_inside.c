@@ -162,7 +162,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
 			}
 		}
-		blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
+		blake3_update(&hasher, work_buf, (size_t)block_size);
 
 		// set block info
 		block_p->slice = slice_index;
@@ -252,7 +252,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
 			}
 		}
-		blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
+		blake3_update(&hasher, work_buf, (size_t)tail_size);
 
 		// set common slice info
 		slice_p->file = 0;
@@ -347,7 +347,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 					file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
 				}
 			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
+			blake3_update(&hasher, work_buf, (size_t)block_size);
 
 			// set block info
 			block_p->slice = slice_index;
@@ -456,7 +456,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 					file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
 				}
 			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
+			blake3_update(&hasher, work_buf, (size_t)tail_size);
 
 			// set common slice info
 			tail_index = slice_index;
@@ -563,7 +563,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 				}
 			}
 
-			blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
+			blake3_update(&hasher, work_buf, (size_t)block_size);
 
 			// set slice info
 			slice_p->chunk = chunk_index;
@@ -605,7 +605,7 @@ int map_input_block_zip(PAR3_CTX *par3_ctx, int footer_size, uint64_t unprotecte
 				}
 			}
 
-			blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
+			blake3_update(&hasher, work_buf, (size_t)tail_size);
 		}
 		if (tail_size >= 40){
 			slice_p->chunk = chunk_index;
@@ -22,15 +22,16 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 	int progress_old, progress_now;
 	uint32_t num, num_pack, input_file_count;
 	uint32_t chunk_count, chunk_index, chunk_num;
-	int64_t find_index, previous_index, tail_offset;
+	int64_t find_index, previous_index, tail_offset, find_tail;
 	uint64_t block_size, tail_size, file_offset;
 	uint64_t file_size, read_size, slide_offset;
 	uint64_t block_count, block_index;
 	uint64_t slice_count, slice_index, index, last_index;
 	uint64_t crc, crc_slide, window_mask, *window_table, num_dedup;
+	uint64_t crc_mask, *crc_filter, crc_batch[CRC_SLIDE_BATCH], batch_start, batch_end;
 	uint64_t progress_total, progress_step;
 	PAR3_FILE_CTX *file_p;
-	PAR3_CHUNK_CTX *chunk_p, *chunk_list;
+	PAR3_CHUNK_CTX *chunk_p;
 	PAR3_SLICE_CTX *slice_p, *slice_list;
 	PAR3_BLOCK_CTX *block_p, *block_list;
 	PAR3_CMP_CTX *crc_list;
@@ -62,7 +63,6 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 		perror("Failed to allocate memory for chunk description");
 		return RET_MEMORY_ERROR;
 	}
-	chunk_list = chunk_p;
 	par3_ctx->chunk_list = chunk_p;
 
 	// For deduplication, allocate input file slices as 2 * number of input blocks.
@@ -87,14 +87,15 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 	block_list = block_p;
 	par3_ctx->block_list = block_p;
 
-	// Allocate list of CRC-64 for maximum items
-	crc_list = malloc(sizeof(PAR3_CMP_CTX) * block_count);
-	if (crc_list == NULL){
-		perror("Failed to allocate memory for comparison of CRC-64");
+	// Allocate hash index of CRC-64 for maximum items
+	if (crc_list_alloc(par3_ctx, block_count) != 0)
 		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->crc_list = crc_list;
-	par3_ctx->crc_count = 0;	// There is no item yet.
+	free(par3_ctx->tail_map_list);	// Index of chunk tails grows later.
+	par3_ctx->tail_map_list = NULL;
+	par3_ctx->tail_map_count = 0;
+	crc_list = par3_ctx->crc_list;
+	crc_mask = par3_ctx->crc_mask;
+	crc_filter = par3_ctx->crc_filter;
 
 	// Allocate memory to store file data temporary.
 	work_buf = malloc(block_size * 2);
@@ -168,7 +169,7 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 		} else {
 			file_p->crc = crc64(work_buf, 16384, 0);
 		}
-		blake3_hasher_update(&hasher, work_buf, (size_t)read_size);
+		blake3_update(&hasher, work_buf, (size_t)read_size);
 
 		// First chunk in this file
 		previous_index = -4;
@@ -192,10 +193,28 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 					//printf("slide: file %d, offset %"PRIu64", crc_count = %"PRIu64"\n", num, file_offset, par3_ctx->crc_count);
 					crc_slide = crc;
 					slide_offset = 0;
+					batch_start = batch_end = 0;
 					while (slide_offset + 1 < block_size){
-						crc_slide = window_mask ^ crc_slide_byte(window_mask ^ crc_slide,
-								work_buf[slide_offset + block_size], work_buf[slide_offset], window_table);
-						slide_offset++;
+						if (slide_offset + 1 >= batch_end){
+							// Slide next range of offsets at once.
+							batch_start = slide_offset;
+							batch_end = block_size;
+							if (batch_end > batch_start + CRC_SLIDE_BATCH)
+								batch_end = batch_start + CRC_SLIDE_BATCH;
+							crc_slide_batch(work_buf + batch_start, block_size, (size_t)(batch_end - batch_start),
+									crc_slide, crc_batch, window_mask, window_table);
+						}
+
+						// Most offsets are rejected by bitmap filter.
+						slide_offset = batch_start + crc_slide_scan(crc_batch, (size_t)(slide_offset + 1 - batch_start),
+								(size_t)(batch_end - batch_start), crc_filter, crc_mask);
+						if (slide_offset >= batch_end){
+							slide_offset = batch_end - 1;
+							crc_slide = crc_batch[slide_offset - batch_start];
+							find_index = -2;
+							continue;
+						}
+						crc_slide = crc_batch[slide_offset - batch_start];
 						//printf("offset = %"PRIu64", crc = 0x%016"PRIx64", 0x%016"PRIx64"\n", slide_offset, crc64(work_buf + slide_offset, block_size, 0), crc_slide);
 
 						find_index = crc_list_compare(par3_ctx, crc_slide, work_buf + slide_offset, buf_hash);
@@ -215,22 +234,15 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 
 						// search existing tails of same data
 						tail_offset = 0;
-						for (index = 0; index < slice_index; index++){
-							//printf("tail size = %"PRIu64"\n", slice_list[index].size);
-							if (slice_list[index].size == tail_size){	// same size tail
-								//printf("crc = 0x%016"PRIx64", 0x%016"PRIx64" chunk[%2u]\n", chunk_p->tail_crc, chunk_list[slice_list[index].chunk].tail_crc, slice_list[index].chunk);
-								if (chunk_p->tail_crc == chunk_list[slice_list[index].chunk].tail_crc){
-									if (memcmp(chunk_p->tail_hash, chunk_list[slice_list[index].chunk].tail_hash, 16) == 0){
-										tail_offset = -1;
-
-										// find the last slice info in the block
-										last_index = index;
-										while (slice_list[last_index].next != -1){
-											last_index = slice_list[last_index].next;
-										}
-										break;
-									}
-								}
+						find_tail = tail_map_compare(par3_ctx, chunk_p->tail_crc, tail_size, chunk_p->tail_hash);
+						if (find_tail >= 0){
+							tail_offset = -1;
+							index = (uint64_t)find_tail;
+
+							// find the last slice info in the block
+							last_index = index;
+							while (slice_list[last_index].next != -1){
+								last_index = slice_list[last_index].next;
 							}
 						}
 						if (tail_offset == 0){
@@ -316,6 +328,10 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 						slice_p->size = tail_size;
 						slice_p->chunk = chunk_index;
 						slice_p->next = -1;
+						if (tail_offset >= 0){	// Index new tail to find same data later.
+							if (tail_map_add(par3_ctx, chunk_p->tail_crc, slice_index) != 0)
+								return RET_MEMORY_ERROR;
+						}
 						slice_index++;
 						if (slice_index >= slice_count){
 							slice_count *= 2;
@@ -359,7 +375,6 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 							fclose(fp);
 							return RET_MEMORY_ERROR;
 						}
-						chunk_list = chunk_p;
 						par3_ctx->chunk_list = chunk_p;
 						chunk_p += chunk_index;
 					} else {
@@ -455,7 +470,7 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 						} else if (file_offset + (block_size - slide_offset) < 16384){
 							file_p->crc = crc64(buf_p, (size_t)(16384 - file_offset - (block_size - slide_offset)), file_p->crc);
 						}
-						blake3_hasher_update(&hasher, buf_p, (size_t)read_size);
+						blake3_update(&hasher, buf_p, (size_t)read_size);
 					}
 
 					// Calculate CRC-64 of next block.
@@ -490,7 +505,6 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 								fclose(fp);
 								return RET_MEMORY_ERROR;
 							}
-							chunk_list = chunk_p;
 							par3_ctx->chunk_list = chunk_p;
 							chunk_p += chunk_index;
 						} else {
@@ -581,7 +595,7 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 						} else if (file_offset + block_size < 16384){
 							file_p->crc = crc64(work_buf + block_size, (size_t)(16384 - file_offset - block_size), file_p->crc);
 						}
-						blake3_hasher_update(&hasher, work_buf + block_size, (size_t)read_size);
+						blake3_update(&hasher, work_buf + block_size, (size_t)read_size);
 					}
 
 					// Calculate CRC-64 of next block.
@@ -612,7 +626,6 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 							fclose(fp);
 							return RET_MEMORY_ERROR;
 						}
-						chunk_list = chunk_p;
 						par3_ctx->chunk_list = chunk_p;
 						chunk_p += chunk_index;
 					} else {
@@ -705,7 +718,7 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 					} else if (file_offset + block_size < 16384){
 						file_p->crc = crc64(work_buf + block_size, (size_t)(16384 - file_offset - block_size), file_p->crc);
 					}
-					blake3_hasher_update(&hasher, work_buf + block_size, (size_t)read_size);
+					blake3_update(&hasher, work_buf + block_size, (size_t)read_size);
 				}
 
 				// Calculate CRC-64 of next block.
@@ -724,22 +737,15 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 
 			// search existing tails of same data
 			tail_offset = 0;
-			for (index = 0; index < slice_index; index++){
-				//printf("tail size = %"PRIu64"\n", slice_list[index].size);
-				if (slice_list[index].size == tail_size){	// same size tail
-					//printf("crc = 0x%016I64x, 0x%016I64x chunk[%2u]\n", chunk_p->tail_crc, chunk_list[slice_list[index].chunk].tail_crc, slice_list[index].chunk);
-					if (chunk_p->tail_crc == chunk_list[slice_list[index].chunk].tail_crc){
-						if (memcmp(chunk_p->tail_hash, chunk_list[slice_list[index].chunk].tail_hash, 16) == 0){
-							tail_offset = -1;
-
-							// find the last slice info in the block
-							last_index = index;
-							while (slice_list[last_index].next != -1){
-								last_index = slice_list[last_index].next;
-							}
-							break;
-						}
-					}
+			find_tail = tail_map_compare(par3_ctx, chunk_p->tail_crc, tail_size, chunk_p->tail_hash);
+			if (find_tail >= 0){
+				tail_offset = -1;
+				index = (uint64_t)find_tail;
+
+				// find the last slice info in the block
+				last_index = index;
+				while (slice_list[last_index].next != -1){
+					last_index = slice_list[last_index].next;
 				}
 			}
 			if (tail_offset == 0){
@@ -825,6 +831,10 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 			slice_p->size = tail_size;
 			slice_p->chunk = chunk_index;
 			slice_p->next = -1;
+			if (tail_offset >= 0){	// Index new tail to find same data later.
+				if (tail_map_add(par3_ctx, chunk_p->tail_crc, slice_index) != 0)
+					return RET_MEMORY_ERROR;
+			}
 			slice_index++;
 			if (slice_index >= slice_count){
 				slice_count *= 2;
@@ -869,7 +879,6 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 					fclose(fp);
 					return RET_MEMORY_ERROR;
 				}
-				chunk_list = chunk_p;
 				par3_ctx->chunk_list = chunk_p;
 				chunk_p += chunk_index;
 			} else {
@@ -889,14 +898,19 @@ int map_input_block_slide(PAR3_CTX *par3_ctx)
 
 /*
 	// for debug
-	for (i = 0; i < par3_ctx->crc_count; i++){
-		printf("crc_list[%2u] = 0x%016I64x , %"PRIu64"\n", i, crc_list[i].crc, crc_list[i].index);
+	for (i = 0; i <= par3_ctx->crc_mask; i++){
+		if (crc_list[i].index != CMP_LIST_EMPTY)
+			printf("crc_list[%2u] = 0x%016I64x , %"PRIu64"\n", i, crc_list[i].crc, crc_list[i].index);
 	}
 */
 
 	// Release temporary buffer.
 	free(crc_list);
 	par3_ctx->crc_list = NULL;
+	par3_ctx->crc_filter = NULL;
+	free(par3_ctx->tail_map_list);
+	par3_ctx->tail_map_list = NULL;
+	par3_ctx->tail_map_count = 0;
 	par3_ctx->crc_count = 0;
 	free(work_buf);
 	par3_ctx->work_buf = NULL;
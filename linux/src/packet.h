@@ -17,6 +17,7 @@ int check_packet_exist(uint8_t *buf, size_t buf_size, uint8_t *packet, uint64_t
 int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet);
 int list_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet, char *filename, int64_t offset);
 int check_packet_set(PAR3_CTX *par3_ctx);
+void release_packet_registry(PAR3_CTX *par3_ctx);
 
 int parse_vital_packet(PAR3_CTX *par3_ctx);
 int parse_external_data_packet(PAR3_CTX *par3_ctx);
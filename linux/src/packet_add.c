@@ -5,6 +5,8 @@
 #include <string.h>
 
 #include "libpar3.h"
+#include "hash.h"
+#include "packet.h"
 
 
 // 0 = no packet yet, 1 = the packet exists already
@@ -30,6 +32,293 @@ int check_packet_exist(uint8_t *buf, size_t buf_size, uint8_t *packet, uint64_t
 	return 0;
 }
 
+// Hash index of packets
+typedef struct {
+	PAR3_CMP_CTX *cmp_list;
+	uint64_t mask;		// Number of slots - 1
+} PACKET_INDEX;
+
+// List of Data Packets or Recovery Data Packets
+typedef struct {
+	PAR3_PKT_CTX *list;	// list which the index was made for
+	uint64_t count;
+	uint64_t max;		// Number of allocated items
+	PACKET_INDEX index;
+} PACKET_LIST;
+
+// Registry of found packets, so that duplicated packets are found quickly.
+typedef struct {
+	PACKET_LIST data;
+	PACKET_LIST recv;
+
+	// Vital packets are distinguished by fingerprint hash and packet size.
+	uint8_t *vital_key;	// 24 bytes per packet
+	uint64_t vital_count;
+	uint64_t vital_max;
+	size_t vital_total;	// Total size of packet buffers at the last update
+	PACKET_INDEX vital_index;
+} PACKET_REGISTRY;
+
+static PACKET_REGISTRY * get_packet_registry(PAR3_CTX *par3_ctx)
+{
+	if (par3_ctx->packet_registry == NULL){
+		par3_ctx->packet_registry = calloc(1, sizeof(PACKET_REGISTRY));
+		if (par3_ctx->packet_registry == NULL)
+			perror("Failed to allocate memory for packet registry");
+	}
+	return par3_ctx->packet_registry;
+}
+
+void release_packet_registry(PAR3_CTX *par3_ctx)
+{
+	PACKET_REGISTRY *reg = par3_ctx->packet_registry;
+
+	if (reg == NULL)
+		return;
+	free(reg->data.index.cmp_list);
+	free(reg->recv.index.cmp_list);
+	free(reg->vital_key);
+	free(reg->vital_index.cmp_list);
+	free(reg);
+	par3_ctx->packet_registry = NULL;
+}
+
+// Allocate empty slots for the number of items.
+static int packet_index_make(PACKET_INDEX *index, uint64_t count)
+{
+	uint64_t size;
+
+	size = cmp_list_size(count);
+	free(index->cmp_list);
+	index->cmp_list = malloc(sizeof(PAR3_CMP_CTX) * size);
+	if (index->cmp_list == NULL){
+		perror("Failed to allocate memory for packet index");
+		return RET_MEMORY_ERROR;
+	}
+	cmp_list_clear(index->cmp_list, size);
+	index->mask = size - 1;
+
+	return 0;
+}
+
+// InputSetID and index of block, and checksums for Recovery Data Packet
+static uint64_t packet_item_crc(PAR3_PKT_CTX *item, int flag_recv)
+{
+	uint8_t buf[48];
+
+	memcpy(buf, &(item->id), 8);
+	memcpy(buf + 8, &(item->index), 8);
+	if (flag_recv == 0)
+		return crc64(buf, 16, 0);
+	memcpy(buf + 16, item->root, 16);
+	memcpy(buf + 32, item->matrix, 16);
+	return crc64(buf, 48, 0);
+}
+
+// Make index of all items in the list.
+static int packet_list_index(PACKET_LIST *reg, int flag_recv)
+{
+	uint64_t i;
+
+	if (packet_index_make(&(reg->index), reg->max) != 0)
+		return RET_MEMORY_ERROR;
+	for (i = 0; i < reg->count; i++)
+		cmp_list_add(reg->index.cmp_list, reg->index.mask, packet_item_crc(reg->list + i, flag_recv), i);
+
+	return 0;
+}
+
+// -1 = the packet exists already, 0 = added, 1~ = error
+static int packet_list_add(PACKET_LIST *reg, PAR3_PKT_CTX **list_p, uint64_t *count_p,
+		PAR3_PKT_CTX *item, int flag_recv)
+{
+	int64_t position;
+	uint64_t crc;
+	PAR3_PKT_CTX *list;
+
+	// When items were deleted, make index again.
+	if ( (reg->list != *list_p) || (reg->count != *count_p) || (reg->index.cmp_list == NULL) ){
+		reg->list = *list_p;
+		reg->count = *count_p;
+		reg->max = *count_p;
+		if (packet_list_index(reg, flag_recv) != 0)
+			return RET_MEMORY_ERROR;
+	}
+
+	// Check InputSetID and index, and checksums of Recovery Data Packet.
+	crc = packet_item_crc(item, flag_recv);
+	position = cmp_list_search(reg->index.cmp_list, reg->index.mask, crc);
+	while (position >= 0){
+		list = reg->list + reg->index.cmp_list[position].index;
+		if ( (list->id == item->id) && (list->index == item->index) ){
+			if (flag_recv == 0)
+				return -1;
+			if ( (memcmp(list->root, item->root, 16) == 0) && (memcmp(list->matrix, item->matrix, 16) == 0) )
+				return -1;
+		}
+		position = cmp_list_next(reg->index.cmp_list, reg->index.mask, crc, position + 1);
+	}
+
+	// Allocate double items, when the list is full.
+	if (reg->count >= reg->max){
+		reg->max = reg->max * 2 + 16;
+		list = realloc(reg->list, sizeof(PAR3_PKT_CTX) * reg->max);
+		if (list == NULL){
+			perror("Failed to re-allocate memory for packet list");
+			return RET_MEMORY_ERROR;
+		}
+		reg->list = list;
+		*list_p = list;
+		if (packet_list_index(reg, flag_recv) != 0)
+			return RET_MEMORY_ERROR;
+	}
+
+	memcpy(reg->list + reg->count, item, sizeof(PAR3_PKT_CTX));
+	cmp_list_add(reg->index.cmp_list, reg->index.mask, crc, reg->count);
+	reg->count++;
+	*count_p = reg->count;
+
+	return 0;
+}
+
+// Total size of buffers for vital packets
+static size_t vital_packet_total(PAR3_CTX *par3_ctx)
+{
+	return par3_ctx->creator_packet_size + par3_ctx->comment_packet_size
+			+ par3_ctx->start_packet_size + par3_ctx->matrix_packet_size
+			+ par3_ctx->file_packet_size + par3_ctx->dir_packet_size
+			+ par3_ctx->root_packet_size + par3_ctx->file_system_packet_size
+			+ par3_ctx->ext_data_packet_size;
+}
+
+static int vital_key_add(PACKET_REGISTRY *reg, uint8_t *packet)
+{
+	uint64_t crc, index;
+
+	if (reg->vital_count >= reg->vital_max){
+		uint8_t *tmp_p;
+
+		reg->vital_max = reg->vital_max * 2 + 16;
+		tmp_p = realloc(reg->vital_key, 24 * reg->vital_max);
+		if (tmp_p == NULL){
+			perror("Failed to re-allocate memory for packet registry");
+			return RET_MEMORY_ERROR;
+		}
+		reg->vital_key = tmp_p;
+
+		// Make index again.
+		if (packet_index_make(&(reg->vital_index), reg->vital_max) != 0)
+			return RET_MEMORY_ERROR;
+		for (index = 0; index < reg->vital_count; index++){
+			memcpy(&crc, reg->vital_key + 24 * index, 8);
+			cmp_list_add(reg->vital_index.cmp_list, reg->vital_index.mask, crc, index);
+		}
+	}
+
+	// Fingerprint hash is random enough to use as key.
+	memcpy(reg->vital_key + 24 * reg->vital_count, packet + 8, 24);	// hash and packet size
+	memcpy(&crc, packet + 8, 8);
+	cmp_list_add(reg->vital_index.cmp_list, reg->vital_index.mask, crc, reg->vital_count);
+	reg->vital_count++;
+
+	return 0;
+}
+
+// Register all packets in buffers again.
+static int vital_key_make(PACKET_REGISTRY *reg, PAR3_CTX *par3_ctx)
+{
+	uint8_t *buf_list[9];
+	size_t size_list[9], offset;
+	uint64_t packet_size;
+	int i;
+
+	buf_list[0] = par3_ctx->creator_packet;
+	size_list[0] = par3_ctx->creator_packet_size;
+	buf_list[1] = par3_ctx->comment_packet;
+	size_list[1] = par3_ctx->comment_packet_size;
+	buf_list[2] = par3_ctx->start_packet;
+	size_list[2] = par3_ctx->start_packet_size;
+	buf_list[3] = par3_ctx->matrix_packet;
+	size_list[3] = par3_ctx->matrix_packet_size;
+	buf_list[4] = par3_ctx->file_packet;
+	size_list[4] = par3_ctx->file_packet_size;
+	buf_list[5] = par3_ctx->dir_packet;
+	size_list[5] = par3_ctx->dir_packet_size;
+	buf_list[6] = par3_ctx->root_packet;
+	size_list[6] = par3_ctx->root_packet_size;
+	buf_list[7] = par3_ctx->file_system_packet;
+	size_list[7] = par3_ctx->file_system_packet_size;
+	buf_list[8] = par3_ctx->ext_data_packet;
+	size_list[8] = par3_ctx->ext_data_packet_size;
+
+	reg->vital_count = 0;
+	if (packet_index_make(&(reg->vital_index), reg->vital_max) != 0)
+		return RET_MEMORY_ERROR;
+	for (i = 0; i < 9; i++){
+		offset = 0;
+		while (offset + 48 <= size_list[i]){
+			if (vital_key_add(reg, buf_list[i] + offset) != 0)
+				return RET_MEMORY_ERROR;
+			memcpy(&packet_size, buf_list[i] + offset + 24, 8);
+			if (packet_size < 48)
+				break;
+			offset += packet_size;
+		}
+	}
+	reg->vital_total = vital_packet_total(par3_ctx);
+
+	return 0;
+}
+
+// 0 = no packet yet, 1 = the packet exists already
+// When memory is not enough, it returns 0, and error happens at registering the packet.
+static int vital_packet_exist(PAR3_CTX *par3_ctx, uint8_t *packet)
+{
+	int64_t position;
+	uint64_t crc;
+	PACKET_REGISTRY *reg;
+
+	reg = get_packet_registry(par3_ctx);
+	if (reg == NULL)
+		return 0;
+
+	// When packets were deleted or added by others, register them again.
+	if ( (reg->vital_total != vital_packet_total(par3_ctx)) || (reg->vital_index.cmp_list == NULL) ){
+		if (vital_key_make(reg, par3_ctx) != 0)
+			return 0;
+	}
+
+	memcpy(&crc, packet + 8, 8);
+	position = cmp_list_search(reg->vital_index.cmp_list, reg->vital_index.mask, crc);
+	while (position >= 0){
+		if (memcmp(reg->vital_key + 24 * reg->vital_index.cmp_list[position].index, packet + 8, 24) == 0)
+			return 1;
+		position = cmp_list_next(reg->vital_index.cmp_list, reg->vital_index.mask, crc, position + 1);
+	}
+
+	return 0;
+}
+
+// Register a packet, which was stored in a buffer.
+static int vital_packet_add(PAR3_CTX *par3_ctx, uint8_t *packet, uint64_t packet_size)
+{
+	PACKET_REGISTRY *reg;
+
+	reg = get_packet_registry(par3_ctx);
+	if (reg == NULL)
+		return RET_MEMORY_ERROR;
+
+	if ( (reg->vital_total + packet_size != vital_packet_total(par3_ctx)) || (reg->vital_index.cmp_list == NULL) ){
+		// The packet is registered with others.
+		return vital_key_make(reg, par3_ctx);
+	}
+	if (vital_key_add(reg, packet) != 0)
+		return RET_MEMORY_ERROR;
+	reg->vital_total += packet_size;
+
+	return 0;
+}
+
 // It allocates memory for each packet type, and stores the packet.
 // -2 = unknown type, -1 = the packet exists already, 0 = added, 1~ = error
 int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
@@ -52,7 +341,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->creator_packet, packet, packet_size);
 			par3_ctx->creator_packet_size = packet_size;
 			par3_ctx->creator_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->creator_packet, par3_ctx->creator_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -78,7 +367,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->comment_packet, packet, packet_size);
 			par3_ctx->comment_packet_size = packet_size;
 			par3_ctx->comment_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->comment_packet, par3_ctx->comment_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -104,7 +393,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->start_packet, packet, packet_size);
 			par3_ctx->start_packet_size = packet_size;
 			par3_ctx->start_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->start_packet, par3_ctx->start_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -130,7 +419,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->file_packet, packet, packet_size);
 			par3_ctx->file_packet_size = packet_size;
 			par3_ctx->file_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->file_packet, par3_ctx->file_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -156,7 +445,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->dir_packet, packet, packet_size);
 			par3_ctx->dir_packet_size = packet_size;
 			par3_ctx->dir_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->dir_packet, par3_ctx->dir_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -182,7 +471,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->root_packet, packet, packet_size);
 			par3_ctx->root_packet_size = packet_size;
 			par3_ctx->root_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->root_packet, par3_ctx->root_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -208,7 +497,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->ext_data_packet, packet, packet_size);
 			par3_ctx->ext_data_packet_size = packet_size;
 			par3_ctx->ext_data_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->ext_data_packet, par3_ctx->ext_data_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -234,7 +523,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->matrix_packet, packet, packet_size);
 			par3_ctx->matrix_packet_size = packet_size;
 			par3_ctx->matrix_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->matrix_packet, par3_ctx->matrix_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -260,7 +549,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->matrix_packet, packet, packet_size);
 			par3_ctx->matrix_packet_size = packet_size;
 			par3_ctx->matrix_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->matrix_packet, par3_ctx->matrix_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -288,7 +577,7 @@ int add_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet)
 			memcpy(par3_ctx->file_system_packet, packet, packet_size);
 			par3_ctx->file_system_packet_size = packet_size;
 			par3_ctx->file_system_packet_count = 1;
-		} else if (check_packet_exist(par3_ctx->file_system_packet, par3_ctx->file_system_packet_size, packet, packet_size) == 1){
+		} else if (vital_packet_exist(par3_ctx, packet) == 1){
 			// If there is the packet already, just exit.
 			return -1;
 		} else {
@@ -312,125 +601,44 @@ Data Packet and Recovery Data Packet will be too large to store on memory.
 */
 	}
 
-	return 0;
-}
-
-// 0 = no packet yet, 1 = the packet exists already
-static int check_item_exist(PAR3_PKT_CTX *list, uint64_t item_count, uint64_t id, uint64_t index, uint8_t *cmp_buf)
-{
-	while (item_count != 0){
-		// compare InputSetID and index
-		if ( (list->id == id) && (list->index == index) ){
-			if (cmp_buf == NULL){	// Data Packet
-				return 1;
-			} else {	// Recovery Data Packet
-				// comprare other values
-				if ( (memcmp(list->root, cmp_buf, 16) == 0) && (memcmp(list->matrix, cmp_buf + 16, 16) == 0) ){
-					return 1;
-				}
-			}
-		}
-
-		list++;
-		item_count--;
-	}
-
-	return 0;
+	// Register the stored packet.
+	return vital_packet_add(par3_ctx, packet, packet_size);
 }
 
-// It allocates memory for each packet type, and lists the packet.
+// It lists the packet in registry.
 // -2 = unknown type, -1 = the packet exists already, 0 = added, 1~ = error
 int list_found_packet(PAR3_CTX *par3_ctx, uint8_t *packet, char *filename, int64_t offset)
 {
-	uint8_t *packet_type, cmp_buf[32];
-	uint64_t set_id, index, count;
-	PAR3_PKT_CTX *list;
+	uint8_t *packet_type;
+	PAR3_PKT_CTX item;
+	PACKET_REGISTRY *reg;
+
+	reg = get_packet_registry(par3_ctx);
+	if (reg == NULL)
+		return RET_MEMORY_ERROR;
 
 	// allocate memory for the packet type
 	packet_type = packet + 40;
 	if (memcmp(packet_type, "PAR DAT\0", 8) == 0){	// Data Packet
-		memcpy(&set_id, packet + 32, 8);	// InputSetID
-		memcpy(&index, packet + 48, 8);		// Index of input block
-		if (par3_ctx->data_packet_list == NULL){
-			list = malloc(sizeof(PAR3_PKT_CTX));
-			if (list == NULL){
-				perror("Failed to allocate memory for Data Packet");
-				return RET_MEMORY_ERROR;
-			}
-			par3_ctx->data_packet_list = list;
-			list[0].id = set_id;
-			memset(list[0].root, 0, 16);	// Zero fill unused values
-			memset(list[0].matrix, 0, 16);
-			list[0].index = index;
-			list[0].name = filename;
-			list[0].offset = offset;
-			par3_ctx->data_packet_count = 1;
-		} else if (check_item_exist(par3_ctx->data_packet_list, par3_ctx->data_packet_count, set_id, index, NULL) == 1){
-			// If there is the packet already, just exit.
-			return -1;
-		} else {
-			// Add this packet after other packets.
-			count = par3_ctx->data_packet_count;
-			list = realloc(par3_ctx->data_packet_list, sizeof(PAR3_PKT_CTX) * (count + 1));
-			if (list == NULL){
-				perror("Failed to re-allocate memory for Data Packet");
-				return RET_MEMORY_ERROR;
-			}
-			par3_ctx->data_packet_list = list;
-			list[count].id = set_id;
-			memset(list[count].root, 0, 16);	// Zero fill unused values
-			memset(list[count].matrix, 0, 16);
-			list[count].index = index;
-			list[count].name = filename;
-			list[count].offset = offset;
-			par3_ctx->data_packet_count += 1;
-		}
+		memcpy(&(item.id), packet + 32, 8);		// InputSetID
+		memset(item.root, 0, 16);	// Zero fill unused values
+		memset(item.matrix, 0, 16);
+		memcpy(&(item.index), packet + 48, 8);	// Index of input block
+		item.name = filename;
+		item.offset = offset;
+		return packet_list_add(&(reg->data), &(par3_ctx->data_packet_list), &(par3_ctx->data_packet_count), &item, 0);
 
 	} else if (memcmp(packet_type, "PAR REC\0", 8) == 0){	// Recovery Data Packet
-		memcpy(&set_id, packet + 32, 8);		// InputSetID
-		memcpy(cmp_buf, packet + 48, 16);		// checksum from Root packet
-		memcpy(cmp_buf + 16, packet + 64, 16);	// checksum from Matrix packet
-		memcpy(&index, packet + 80, 8);			// Index of recovery block
-		if (par3_ctx->recv_packet_list == NULL){
-			list = malloc(sizeof(PAR3_PKT_CTX));
-			if (list == NULL){
-				perror("Failed to allocate memory for Recovery Data Packet");
-				return RET_MEMORY_ERROR;
-			}
-			par3_ctx->recv_packet_list = list;
-			list[0].id = set_id;
-			memcpy(list[0].root, cmp_buf, 16);
-			memcpy(list[0].matrix, cmp_buf + 16, 16);
-			list[0].index = index;
-			list[0].name = filename;
-			list[0].offset = offset;
-			par3_ctx->recv_packet_count = 1;
-		} else if (check_item_exist(par3_ctx->recv_packet_list, par3_ctx->recv_packet_count, set_id, index, cmp_buf) == 1){
-			// If there is the packet already, just exit.
-			return -1;
-		} else {
-			// Add this packet after other packets.
-			count = par3_ctx->recv_packet_count;
-			list = realloc(par3_ctx->recv_packet_list, sizeof(PAR3_PKT_CTX) * (count + 1));
-			if (list == NULL){
-				perror("Failed to re-allocate memory for Recovery Data Packet");
-				return RET_MEMORY_ERROR;
-			}
-			par3_ctx->recv_packet_list = list;
-			list[count].id = set_id;
-			memcpy(list[count].root, cmp_buf, 16);
-			memcpy(list[count].matrix, cmp_buf + 16, 16);
-			list[count].index = index;
-			list[count].name = filename;
-			list[count].offset = offset;
-			par3_ctx->recv_packet_count += 1;
-		}
-
-	} else {
-		return -2;
+		memcpy(&(item.id), packet + 32, 8);		// InputSetID
+		memcpy(item.root, packet + 48, 16);		// checksum from Root packet
+		memcpy(item.matrix, packet + 64, 16);	// checksum from Matrix packet
+		memcpy(&(item.index), packet + 80, 8);	// Index of recovery block
+		item.name = filename;
+		item.offset = offset;
+		return packet_list_add(&(reg->recv), &(par3_ctx->recv_packet_list), &(par3_ctx->recv_packet_count), &item, 1);
 	}
 
-	return 0;
+	return -2;
 }
 
 // Delete packets and move former, return new size.
@@ -438,11 +646,13 @@ static size_t adjust_packet_buf(uint8_t *buf, size_t buf_size, uint64_t *id_list
 {
 	int i;
 	uint32_t count;
-	size_t offset;
+	size_t offset, new_size;
 	uint64_t packet_size, this_id;
 
+	// Matched packets are moved to former in one pass.
 	count = 0;
 	offset = 0;
+	new_size = 0;
 	while (offset < buf_size){
 		// read packet size
 		memcpy(&packet_size, buf + offset + 24, 8);
@@ -453,28 +663,28 @@ static size_t adjust_packet_buf(uint8_t *buf, size_t buf_size, uint64_t *id_list
 			if (id_list[i] == this_id)
 				break;
 		}
-		if (i == id_count){	// When packet didn't match, delete it.
-			memmove(buf + offset, buf + offset + packet_size, buf_size - offset - packet_size);
-			buf_size -= packet_size;
-
-		} else {	// goto next packet
+		if (i < id_count){	// When packet matched, keep it.
+			if (new_size < offset)
+				memmove(buf + new_size, buf + offset, packet_size);
+			new_size += packet_size;
 			count++;
-			offset += packet_size;
 		}
+		offset += packet_size;
 	}
 	*new_count = count;
 
-	return buf_size;
+	return new_size;
 }
 
 // Delete items and move former, return new count.
 static uint64_t adjust_packet_list(PAR3_PKT_CTX *list, uint64_t item_count, uint64_t *id_list, int id_count, uint8_t *root)
 {
 	int i;
-	uint64_t this_id, item_index;
+	uint64_t this_id, item_index, new_count;
 
-	item_index = 0;
-	while (item_index < item_count){
+	// Matched items are moved to former in one pass.
+	new_count = 0;
+	for (item_index = 0; item_index < item_count; item_index++){
 		// check SetID
 		this_id = list[item_index].id;
 		for (i = 0; i < id_count; i++){
@@ -489,16 +699,14 @@ static uint64_t adjust_packet_list(PAR3_PKT_CTX *list, uint64_t item_count, uint
 				}
 			}
 		}
-		if (i == id_count){	// When packet didn't match, delete it.
-			memmove(list + item_index, list + item_index + 1, sizeof(PAR3_PKT_CTX) * (item_count - item_index - 1));
-			item_count--;
-
-		} else {	// goto next packet
-			item_index++;
+		if (i < id_count){	// When packet matched, keep it.
+			if (new_count < item_index)
+				memcpy(list + new_count, list + item_index, sizeof(PAR3_PKT_CTX));
+			new_count++;
 		}
 	}
 
-	return item_index;
+	return new_count;
 }
 
 // Remove useless packets
@@ -2,6 +2,7 @@
 #ifdef __linux__
 #define _FILE_OFFSET_BITS 64
 #define _fileno fileno
+#define _fseeki64 fseeko
 #elif _WIN32
 // avoid error of MSVC
 #define _CRT_SECURE_NO_WARNINGS
@@ -15,202 +16,955 @@
 
 #ifdef __linux__
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #elif _WIN32
 
 // MSVC headers
 #include <io.h>
+#include <windows.h>
 
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SEARCH_SSE2
+#endif
+
 #include "blake3/blake3.h"
 #include "libpar3.h"
 #include "common.h"
 #include "hash.h"
 #include "packet.h"
 #include "file.h"
+#include "map.h"
+#include "cache.h"
+#include "thread.h"
 
 
-int read_packet(PAR3_CTX *par3_ctx)
-{
-	char *namez, packet_type[9];
-	uint8_t *buf, buf_hash[16];
-	int ret;
-	size_t namez_len, namez_off;
-	size_t buf_size, read_size, max, offset;
-	uint64_t file_size, file_offset, packet_size;
-	uint64_t packet_count, new_packet_count;
+// PAR file is mapped in part, so that resident memory is bounded.
+#define PACKET_VIEW_SIZE	(1 << 26)	// 64 MB
+#define PACKET_VIEW_ALIGN	65536		// allocation granularity on Windows, multiple of page size
+
+// A window of PAR file on memory
+typedef struct {
 	FILE *fp;
+	uint64_t file_size;
+#ifdef _WIN32
+	HANDLE map_handle;
+#endif
+	uint8_t *data;		// file data at offset
+	uint64_t offset;	// file offset of the window
+	size_t size;		// size of the window
+	void *map_base;
+	size_t map_size;
+	int map_flag;		// 1 = mapped, 0 = read in allocated buffer
+} PACKET_VIEW;
+
+static void view_release(PACKET_VIEW *view)
+{
+	if (view->map_base != NULL){
+		if (view->map_flag){
+#ifdef _WIN32
+			UnmapViewOfFile(view->map_base);
+#else
+			munmap(view->map_base, view->map_size);
+#endif
+		} else {
+			free(view->map_base);
+		}
+		view->map_base = NULL;
+	}
+	view->data = NULL;
+	view->size = 0;
+}
 
-	//for debug
-	//par3_ctx->memory_limit = 1024;
+static void view_close(PACKET_VIEW *view)
+{
+	view_release(view);
+#ifdef _WIN32
+	if (view->map_handle != NULL){
+		CloseHandle(view->map_handle);
+		view->map_handle = NULL;
+	}
+#endif
+}
 
-	packet_type[8] = 0;	// Set null string.
+// Show a window from offset. When mapping fails, file data is read instead.
+static int view_map(PACKET_VIEW *view, uint64_t offset, size_t size)
+{
+	uint64_t aligned;
 
-	// Allocate buffer to keep PAR file.
-	buf_size = par3_ctx->max_file_size;
-	if ( (par3_ctx->memory_limit != 0) && (buf_size > par3_ctx->memory_limit) ){
-		buf_size = par3_ctx->memory_limit;	// multiple of MB
-		// When buffer size is 1 MB, readable minimum packet size becomes 1 MB, too.
-		// So, a user should not set small limit.
+	view_release(view);
+	aligned = offset - (offset % PACKET_VIEW_ALIGN);
+	view->map_size = (size_t)(offset - aligned) + size;
+	view->map_flag = 1;
+#ifdef _WIN32
+	if (view->map_handle == NULL){
+		view->map_handle = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(view->fp)), NULL, PAGE_READONLY, 0, 0, NULL);
 	}
-	if (par3_ctx->noise_level >= 2){
-		printf("buffer size for PAR files = %"PRIu64"\n", buf_size);
+	if (view->map_handle != NULL){
+		view->map_base = MapViewOfFile(view->map_handle, FILE_MAP_READ,
+				(DWORD)(aligned >> 32), (DWORD)aligned, view->map_size);
+	}
+#else
+	view->map_base = mmap(NULL, view->map_size, PROT_READ, MAP_PRIVATE, _fileno(view->fp), (off_t)aligned);
+	if (view->map_base == MAP_FAILED){
+		view->map_base = NULL;
+	} else {
+		madvise(view->map_base, view->map_size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (view->map_base == NULL){
+		view->map_flag = 0;
+		aligned = offset;
+		view->map_size = size;
+		view->map_base = malloc(size);
+		if (view->map_base == NULL){
+			perror("Failed to allocate memory for PAR file");
+			return RET_MEMORY_ERROR;
+		}
+		if ( (_fseeki64(view->fp, offset, SEEK_SET) != 0) || (fread(view->map_base, 1, size, view->fp) != size) ){
+			view_release(view);
+			return RET_FILE_IO_ERROR;
+		}
+	}
+
+	view->data = (uint8_t *)(view->map_base) + (offset - aligned);
+	view->offset = offset;
+	view->size = size;
+	return 0;
+}
+
+// Return position of the first Magic sequence, or size when it's not found.
+static size_t search_magic(const uint8_t *buf, size_t size)
+{
+	size_t offset = 0;
+
+#ifdef SEARCH_SSE2
+	__m128i char_p, char_a, data0, data1;
+	unsigned int mask, bit;
+
+	// Check "PA" at 16 positions at once, and compare whole bytes only at them.
+	char_p = _mm_set1_epi8('P');
+	char_a = _mm_set1_epi8('A');
+	while (offset + 24 <= size){
+		data0 = _mm_loadu_si128((const __m128i *)(buf + offset));
+		data1 = _mm_loadu_si128((const __m128i *)(buf + offset + 1));
+		mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(data0, char_p), _mm_cmpeq_epi8(data1, char_a)));
+		for (bit = 0; mask != 0; bit++, mask >>= 1){
+			if ( (mask & 1) && (memcmp(buf + offset + bit, "PAR3\0PKT", 8) == 0) )
+				return offset + bit;
+		}
+		offset += 16;
+	}
+#endif
+
+	while (offset + 8 <= size){
+		const uint8_t *p = memchr(buf + offset, 'P', size - 7 - offset);
+		if (p == NULL)
+			break;
+		offset = p - buf;
+		if (memcmp(p, "PAR3\0PKT", 8) == 0)
+			return offset;
+		offset++;
+	}
+
+	return size;
+}
+
+/*
+Format of packet index file
+
+ 8 bytes: "PAR3IDX\0"
+ 8 bytes: version (1)
+ 8 bytes: number of PAR files
+ 8 bytes: CRC-64 of all records
+ records: INDEX_FILE, name of PAR file, and INDEX_PACKET of each packet
+
+Values are stored in native byte order, because the index is used on the same PC.
+Records are used on the loaded buffer directly.
+*/
+
+#define INDEX_MAGIC		"PAR3IDX"
+#define INDEX_VERSION	1
+#define INDEX_HEADER_SIZE	32
+#define INDEX_HEAD_SIZE	88	// header of packet and the first 40 bytes of body
+
+// A record of PAR file in index file
+typedef struct {
+	uint64_t name_size;	// size of name with null, multiple of 8
+	uint64_t file_size;
+	int64_t mtime;		// modification time in nanoseconds
+	uint64_t packet_count;
+} INDEX_FILE;
+
+// A record of packet in index file
+typedef struct {
+	uint64_t offset;
+	uint64_t size;
+	uint8_t head[INDEX_HEAD_SIZE];
+} INDEX_PACKET;
+
+// Loaded index file
+typedef struct {
+	uint8_t *buf;
+	size_t buf_size;
+	INDEX_FILE **record_list;	// pointers to records on buf
+	uint64_t record_count;
+	PAR3_CMP_CTX *cmp_list;		// hash index of name
+	uint64_t cmp_mask;
+} PACKET_INDEX_FILE;
+
+// A packet found in PAR file
+typedef struct {
+	uint64_t offset;
+	uint64_t size;
+	uint8_t head[INDEX_HEAD_SIZE];	// the first bytes of packet, zero filled
+	int flag;			// 0 = valid packet, 1 = too large packet
+} PACKET_FOUND;
+
+// Result of scanning a PAR file
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	char *filename;
+	PACKET_FOUND *list;
+	size_t count;
+	size_t max;
+	int ret;			// 0 = done, -1 = failed to open, -2 = failed to read, -3 = failed to close, others = error
+	CACHE_KEY key;		// size and modification time of the file
+	INDEX_FILE *record;	// record in index file, or NULL
+	int index_state;	// 0 = not indexed, 1 = read by index, 2 = searched
+} PACKET_SCAN;
+
+#define SCAN_OPEN_ERROR		-1
+#define SCAN_READ_ERROR		-2
+#define SCAN_CLOSE_ERROR	-3
+
+// Only header is available for too large packet.
+static int scan_add(PACKET_SCAN *scan, uint64_t offset, uint64_t size, uint8_t *packet, int flag)
+{
+	size_t head_size;
+
+	if (scan->count >= scan->max){
+		PACKET_FOUND *tmp_p;
+		size_t new_max = scan->max * 2 + 16;
+
+		tmp_p = realloc(scan->list, sizeof(PACKET_FOUND) * new_max);
+		if (tmp_p == NULL){
+			perror("Failed to allocate memory for found packets");
+			return RET_MEMORY_ERROR;
+		}
+		scan->list = tmp_p;
+		scan->max = new_max;
+	}
+	scan->list[scan->count].offset = offset;
+	scan->list[scan->count].size = size;
+	head_size = 48;
+	if (flag == 0){
+		head_size = INDEX_HEAD_SIZE;
+		if (head_size > size)
+			head_size = (size_t)size;
+	}
+	memcpy(scan->list[scan->count].head, packet, head_size);
+	memset(scan->list[scan->count].head + head_size, 0, INDEX_HEAD_SIZE - head_size);
+	scan->list[scan->count].flag = flag;
+	scan->count++;
+	return 0;
+}
+
+// Size of window depends on memory limit.
+static size_t view_window_size(PAR3_CTX *par3_ctx)
+{
+	size_t view_size;
+
+	// When buffer size is 1 MB, readable maximum packet size becomes 1 MB, too.
+	// So, a user should not set small limit.
+	view_size = PACKET_VIEW_SIZE;
+	if ( (par3_ctx->memory_limit != 0) && (view_size > par3_ctx->memory_limit) ){
+		view_size = (size_t)(par3_ctx->memory_limit);
+		if (view_size < PACKET_VIEW_ALIGN)
+			view_size = PACKET_VIEW_ALIGN;
+	}
+	return view_size;
+}
+
+static uint64_t name_crc(char *name)
+{
+	return crc64((uint8_t *)name, strlen(name), 0);
+}
+
+static void index_release(PACKET_INDEX_FILE *index_file)
+{
+	if (index_file == NULL)
+		return;
+	free(index_file->buf);
+	free(index_file->record_list);
+	free(index_file->cmp_list);
+	free(index_file);
+}
+
+// Read index file. When it doesn't exist or is broken, index becomes NULL.
+static int index_load(PAR3_CTX *par3_ctx, char *index_name, PACKET_INDEX_FILE **index_p)
+{
+	uint8_t *buf;
+	uint64_t count, offset, index, crc, record_size;
+	size_t buf_size;
+	PACKET_INDEX_FILE *index_file;
+	INDEX_FILE *record;
+	FILE *fp;
+
+	*index_p = NULL;
+	fp = fopen(index_name, "rb");
+	if (fp == NULL)
+		return 0;
+	buf_size = (size_t)_filelengthi64(_fileno(fp));
+	if (buf_size < INDEX_HEADER_SIZE){
+		fclose(fp);
+		return 0;
+	}
+
+	index_file = calloc(1, sizeof(PACKET_INDEX_FILE));
+	if (index_file == NULL){
+		perror("Failed to allocate memory for packet index");
+		fclose(fp);
+		return RET_MEMORY_ERROR;
 	}
 	buf = malloc(buf_size);
 	if (buf == NULL){
-		perror("Failed to allocate memory for PAR files");
+		perror("Failed to allocate memory for packet index");
+		fclose(fp);
+		index_release(index_file);
 		return RET_MEMORY_ERROR;
 	}
-	par3_ctx->work_buf = buf;
+	index_file->buf = buf;
+	index_file->buf_size = buf_size;
+	if (fread(buf, 1, buf_size, fp) != buf_size){
+		perror("Failed to read packet index");
+		fclose(fp);
+		index_release(index_file);
+		return RET_FILE_IO_ERROR;
+	}
+	fclose(fp);
 
-	namez = par3_ctx->par_file_name;
-	namez_len = par3_ctx->par_file_name_len;
-	namez_off = 0;
-	while (namez_off < namez_len){
-		if (par3_ctx->noise_level >= -1){
-			printf("Loading \"%s\".\n", namez + namez_off);
+	// Broken or old index is ignored, and it will be overwritten.
+	memcpy(&index, buf + 8, 8);
+	memcpy(&count, buf + 16, 8);
+	memcpy(&crc, buf + 24, 8);
+	if ( (memcmp(buf, INDEX_MAGIC, 8) != 0) || (index != INDEX_VERSION) ||
+			(crc != crc64(buf + INDEX_HEADER_SIZE, buf_size - INDEX_HEADER_SIZE, 0)) ){
+		if (par3_ctx->noise_level >= 0){
+			printf("Packet index is invalid, and will be made again.\n");
 		}
+		index_release(index_file);
+		return 0;
+	}
 
-		fp = fopen(namez + namez_off, "rb");
-		if (fp == NULL){
-			printf("Failed to open \"%s\", skip to next file.\n", namez + namez_off);
-			namez_off += strlen(namez + namez_off) + 1;
-			continue;
+	index_file->record_list = malloc(sizeof(INDEX_FILE *) * (count + 1));
+	index_file->cmp_mask = cmp_list_size(count) - 1;
+	index_file->cmp_list = malloc(sizeof(PAR3_CMP_CTX) * (index_file->cmp_mask + 1));
+	if ( (index_file->record_list == NULL) || (index_file->cmp_list == NULL) ){
+		perror("Failed to allocate memory for packet index");
+		index_release(index_file);
+		return RET_MEMORY_ERROR;
+	}
+	cmp_list_clear(index_file->cmp_list, index_file->cmp_mask + 1);
+
+	// Check range of each record
+	offset = INDEX_HEADER_SIZE;
+	for (index = 0; index < count; index++){
+		if (offset + sizeof(INDEX_FILE) > buf_size)
+			break;
+		record = (INDEX_FILE *)(buf + offset);
+		if ( (record->name_size == 0) || (record->name_size > _MAX_PATH + 8) || ((record->name_size & 7) != 0) )
+			break;
+		if (record->packet_count > (buf_size - offset) / sizeof(INDEX_PACKET))
+			break;
+		record_size = sizeof(INDEX_FILE) + record->name_size + sizeof(INDEX_PACKET) * record->packet_count;
+		if (offset + record_size > buf_size)
+			break;
+		if (buf[offset + sizeof(INDEX_FILE) + record->name_size - 1] != 0)
+			break;
+		index_file->record_list[index] = record;
+		cmp_list_add(index_file->cmp_list, index_file->cmp_mask, name_crc((char *)(record + 1)), index);
+		offset += record_size;
+	}
+	if (index < count){
+		if (par3_ctx->noise_level >= 0){
+			printf("Packet index is broken at record %"PRIu64".\n", index);
 		}
+		index_release(index_file);
+		return 0;
+	}
+	index_file->record_count = count;
+	if (par3_ctx->noise_level >= 1){
+		printf("Number of PAR files in packet index = %"PRIu64"\n", count);
+	}
 
-		// get file size
-		file_size = _filelengthi64(_fileno(fp));
+	*index_p = index_file;
+	return 0;
+}
 
-		// Read file data at first.
-		read_size = buf_size;
-		if (file_size < buf_size)
-			read_size = file_size;
-		//printf("file data = %"PRIu64", read_size = %zu, remain = %zu\n", file_size, read_size, file_size - read_size);
-		if (fread(buf, 1, read_size, fp) != read_size){
-			printf("Failed to read \"%s\", skip to next file.\n", namez + namez_off);
-			namez_off += strlen(namez + namez_off) + 1;
-			fclose(fp);
-			continue;
+// Return a record of the same file, or NULL.
+static INDEX_FILE * index_find(PACKET_INDEX_FILE *index_file, char *name, CACHE_KEY *key)
+{
+	int64_t position;
+	uint64_t crc;
+	INDEX_FILE *record;
+
+	if ( (index_file == NULL) || (index_file->record_count == 0) )
+		return NULL;
+
+	crc = name_crc(name);
+	position = cmp_list_search(index_file->cmp_list, index_file->cmp_mask, crc);
+	while (position >= 0){
+		record = index_file->record_list[index_file->cmp_list[position].index];
+		if (strcmp((char *)(record + 1), name) == 0){
+			if ( (record->file_size == key->size) && (record->mtime == key->mtime) )
+				return record;
+			return NULL;
 		}
-		file_size -= read_size;
-		max = read_size;
-
-		file_offset = 0;
-		packet_count = 0;
-		new_packet_count = 0;
-		offset = 0;
-		while (offset + 48 < max){
-			if (memcmp(buf + offset, "PAR3\0PKT", 8) == 0){	// check Magic sequence
-				// read packet size
-				memcpy(&packet_size, buf + (offset + 24), 8);
-				if (packet_size <= 48){	// If packet is too small, just ignore it.
-					offset += 8;
-					continue;
-				}
-				if (offset + packet_size > buf_size + file_size){	// If not enough data, ignore the packet.
-					offset += 8;
-					continue;
-				}
-				if (packet_size > buf_size){	// If packet is larger than buffer, show error and continue.
-					if (par3_ctx->noise_level >= 1){
-						memcpy(packet_type, buf + (offset + 40), 8);
-						printf("Warning, packet is too large. size = %"PRIu64", type = %s\n", packet_size, packet_type);
-					}
-					offset += 8;
-					continue;
-				}
-				// If packet exceeds buffer, read more bytes.
-				if (offset + packet_size > buf_size){
-					read_size = offset;
-					if (read_size > file_size)
-						read_size = file_size;
-
-					// slide data to top
-					memmove(buf, buf + offset, buf_size - offset);
-					//printf("file data = %"PRIu64", offset = %zu, read_size = %zu, ", file_size, offset, read_size);
-					if (fread(buf + buf_size - offset, 1, read_size, fp) != read_size){
-						printf("Failed to read \"%s\", skip to next file.\n", namez + namez_off);
-						namez_off += strlen(namez + namez_off) + 1;
-						fclose(fp);
-						continue;
-					}
-					file_size -= read_size;
-					max = buf_size - offset + read_size;
-					//printf("remain = %"PRIu64", max = %zu\n", file_size, max);
-					file_offset += offset;
-					offset = 0;
-				}
+		position = cmp_list_next(index_file->cmp_list, index_file->cmp_mask, crc, position + 1);
+	}
 
-				// check fingerprint hash of the packet
-				blake3(buf + (offset + 24), packet_size - 24, buf_hash);
-				if (memcmp(buf + (offset + 8), buf_hash, 16) != 0){
-					// If checksum is different, ignore the packet.
-					offset += 8;
-					continue;
-				}
-				packet_count++;
+	return NULL;
+}
 
-				// read packet type
-				memcpy(packet_type, buf + (offset + 40), 8);
-				if (par3_ctx->noise_level >= 3){
-					printf("offset =%6"PRIu64", size =%5"PRIu64", type = %s\n", file_offset + offset, packet_size, packet_type);
-				}
+// Write positions of packets in PAR files, which were read completely.
+static int index_save(PAR3_CTX *par3_ctx, char *index_name, PACKET_SCAN *scan_list, uint32_t scan_count)
+{
+	char temp_name[_MAX_PATH + 16];
+	uint8_t header[INDEX_HEADER_SIZE], zero_pad[8];
+	uint32_t num;
+	uint64_t crc, value, count;
+	size_t index, name_len;
+	INDEX_FILE record;
+	INDEX_PACKET entry;
+	FILE *fp;
 
-				// store the found packet
-				ret = add_found_packet(par3_ctx, buf + offset);
-				if (ret == -2){
-					ret = list_found_packet(par3_ctx, buf + offset, namez + namez_off, file_offset + offset);
-				}
-				if (ret > 0){
-					fclose(fp);
-					return ret;
-				} else if (ret == 0){
-					new_packet_count++;
-				}
+	// Write to temporary file, and replace old one at the end.
+	sprintf(temp_name, "%s.tmp", index_name);
+	fp = fopen(temp_name, "wb");
+	if (fp == NULL){
+		perror("Failed to create packet index");
+		return RET_FILE_IO_ERROR;
+	}
 
-				offset += packet_size;
-			} else {
-				offset++;
+	// Header is written again after CRC-64 is calculated.
+	memset(header, 0, INDEX_HEADER_SIZE);
+	if (fwrite(header, 1, INDEX_HEADER_SIZE, fp) != INDEX_HEADER_SIZE){
+		perror("Failed to write packet index");
+		fclose(fp);
+		return RET_FILE_IO_ERROR;
+	}
+	memset(zero_pad, 0, 8);
+	crc = 0;
+	count = 0;
+	for (num = 0; num < scan_count; num++){
+		if (scan_list[num].index_state == 0)
+			continue;
+
+		memset(&record, 0, sizeof(INDEX_FILE));
+		name_len = strlen(scan_list[num].filename) + 1;
+		record.name_size = (name_len + 7) & ~((uint64_t)7);
+		record.file_size = scan_list[num].key.size;
+		record.mtime = scan_list[num].key.mtime;
+		record.packet_count = scan_list[num].count;
+		crc = crc64((uint8_t *)&record, sizeof(INDEX_FILE), crc);
+		if (fwrite(&record, 1, sizeof(INDEX_FILE), fp) != sizeof(INDEX_FILE)){
+			perror("Failed to write packet index");
+			fclose(fp);
+			return RET_FILE_IO_ERROR;
+		}
+
+		// Name is zero filled to align records.
+		crc = crc64((uint8_t *)(scan_list[num].filename), name_len, crc);
+		crc = crc64(zero_pad, (size_t)(record.name_size) - name_len, crc);
+		if ( (fwrite(scan_list[num].filename, 1, name_len, fp) != name_len)
+				|| (fwrite(zero_pad, 1, (size_t)(record.name_size) - name_len, fp) != (size_t)(record.name_size) - name_len) ){
+			perror("Failed to write packet index");
+			fclose(fp);
+			return RET_FILE_IO_ERROR;
+		}
+
+		for (index = 0; index < scan_list[num].count; index++){
+			entry.offset = scan_list[num].list[index].offset;
+			entry.size = scan_list[num].list[index].size;
+			memcpy(entry.head, scan_list[num].list[index].head, INDEX_HEAD_SIZE);
+			crc = crc64((uint8_t *)&entry, sizeof(INDEX_PACKET), crc);
+			if (fwrite(&entry, 1, sizeof(INDEX_PACKET), fp) != sizeof(INDEX_PACKET)){
+				perror("Failed to write packet index");
+				fclose(fp);
+				return RET_FILE_IO_ERROR;
 			}
+		}
+		count++;
+	}
 
-			if ( (file_size > 0) && (offset + 48 >= max) ){	// read more bytes
-				read_size = offset;
-				if (read_size > file_size)
-					read_size = file_size;
-
-				// slide data to top
-				memmove(buf, buf + offset, buf_size - offset);
-				//printf("file_size = %"PRIu64", offset = %zu, read_size = %zu, ", file_size, offset, read_size);
-				if (fread(buf + buf_size - offset, 1, read_size, fp) != read_size){
-					printf("Failed to read \"%s\", skip to next file.\n", namez + namez_off);
-					namez_off += strlen(namez + namez_off) + 1;
-					fclose(fp);
-					continue;
-				}
-				file_size -= read_size;
-				max = buf_size - offset + read_size;
-				//printf("remain = %"PRIu64", max = %zu\n", file_size, max);
-				file_offset += offset;
-				offset = 0;
+	memcpy(header, INDEX_MAGIC, 8);
+	value = INDEX_VERSION;
+	memcpy(header + 8, &value, 8);
+	memcpy(header + 16, &count, 8);
+	memcpy(header + 24, &crc, 8);
+	if ( (_fseeki64(fp, 0, SEEK_SET) != 0) || (fwrite(header, 1, INDEX_HEADER_SIZE, fp) != INDEX_HEADER_SIZE) ){
+		perror("Failed to write packet index");
+		fclose(fp);
+		return RET_FILE_IO_ERROR;
+	}
+	if (fclose(fp) != 0){
+		perror("Failed to close packet index");
+		return RET_FILE_IO_ERROR;
+	}
+
+	remove(index_name);
+	if (rename(temp_name, index_name) != 0){
+		perror("Failed to rename packet index");
+		return RET_FILE_IO_ERROR;
+	}
+	if (par3_ctx->noise_level >= 1){
+		printf("Saved packet index of %"PRIu64" PAR files\n", count);
+	}
+
+	return 0;
+}
+
+// Check packets at positions in index file, instead of searching whole file.
+// Fingerprint hash is checked for all packets, except data of Recovery Data Packets,
+// which is checked later by check_recovery_packet(), when it's required.
+// return 0 = same packets exist, 1 = different, others = error
+static int read_packet_index(PACKET_SCAN *scan, PACKET_VIEW *view)
+{
+	PAR3_CTX *par3_ctx = scan->par3_ctx;
+	uint8_t *packet, buf_hash[16];
+	int ret, flag;
+	size_t view_size, map_size, check_size, head_size;
+	uint64_t num, file_offset, packet_size;
+	INDEX_FILE *record = scan->record;
+	INDEX_PACKET *entry;
+
+	if (view->file_size != record->file_size)
+		return 1;
+	view_size = view_window_size(par3_ctx);
+
+	entry = (INDEX_PACKET *)((uint8_t *)(record + 1) + record->name_size);
+	for (num = 0; num < record->packet_count; num++){
+		file_offset = entry[num].offset;
+		packet_size = entry[num].size;
+		if ( (packet_size <= 48) || (file_offset >= view->file_size) || (packet_size > view->file_size - file_offset) )
+			return 1;
+
+		flag = 0;
+		head_size = INDEX_HEAD_SIZE;
+		if (head_size > packet_size)
+			head_size = (size_t)packet_size;
+		if ( (par3_ctx->memory_limit != 0) && (packet_size > par3_ctx->memory_limit) ){
+			flag = 1;
+			head_size = 48;
+			check_size = 48;
+		} else if ( (par3_ctx->recv_packet_lazy != 0) && (memcmp(entry[num].head + 40, "PAR REC\0", 8) == 0) ){
+			check_size = head_size;	// Pages of recovery data are not read.
+		} else {
+			check_size = (size_t)packet_size;
+		}
+
+		if ( (view->data == NULL) || (file_offset < view->offset) || (file_offset + check_size > view->offset + view->size) ){
+			map_size = view_size;
+			if (map_size < check_size)
+				map_size = check_size;
+			if (map_size > view->file_size - file_offset)
+				map_size = (size_t)(view->file_size - file_offset);
+			ret = view_map(view, file_offset, map_size);
+			if (ret != 0)
+				return ret;
+		}
+		packet = view->data + (file_offset - view->offset);
+
+		if (memcmp(packet, entry[num].head, head_size) != 0)
+			return 1;
+		if (check_size == packet_size){
+			blake3(packet + 24, packet_size - 24, buf_hash);
+			if (memcmp(packet + 8, buf_hash, 16) != 0)
+				return 1;
+		}
+		ret = scan_add(scan, file_offset, packet_size, packet, flag);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+// Add Recovery Data Packet without reading its data.
+// Data is skipped, only when next packet or end of file follows it.
+// return 0 = added, 1 = next packet isn't found, others = error
+static int read_packet_lazy(PACKET_SCAN *scan, PACKET_VIEW *view, uint64_t offset, uint64_t packet_size, size_t view_size)
+{
+	uint8_t head[INDEX_HEAD_SIZE];
+	int ret;
+	size_t map_size;
+	uint64_t next_offset;
+
+	if ( (view->data == NULL) || (offset < view->offset) || (offset + INDEX_HEAD_SIZE > view->offset + view->size) ){
+		map_size = view_size;
+		if (map_size > view->file_size - offset)
+			map_size = (size_t)(view->file_size - offset);
+		ret = view_map(view, offset, map_size);
+		if (ret != 0)
+			return ret;
+	}
+	memcpy(head, view->data + (offset - view->offset), INDEX_HEAD_SIZE);
+
+	next_offset = offset + packet_size;
+	if (next_offset + 8 <= view->file_size){
+		if ( (next_offset < view->offset) || (next_offset + 8 > view->offset + view->size) ){
+			map_size = view_size;
+			if (map_size > view->file_size - next_offset)
+				map_size = (size_t)(view->file_size - next_offset);
+			ret = view_map(view, next_offset, map_size);
+			if (ret != 0)
+				return ret;
+		}
+		if (memcmp(view->data + (next_offset - view->offset), "PAR3\0PKT", 8) != 0)
+			return 1;
+	}
+
+	return scan_add(scan, offset, packet_size, head, 0);
+}
+
+// Find packets in a PAR file, and check their fingerprint hash.
+// PAR files are scanned on threads, and each file is read sequentially.
+// When the file is same as index file, packets are checked at the recorded positions.
+static void read_packet_scan(void *arg, int index)
+{
+	PACKET_SCAN *scan = (PACKET_SCAN *)arg + index;
+	PAR3_CTX *par3_ctx = scan->par3_ctx;
+	uint8_t *packet, buf_hash[16];
+	int ret;
+	size_t view_size, map_size, find_size;
+	uint64_t file_size, file_offset, view_end, packet_size, strict_offset;
+	PACKET_VIEW view;
+
+	memset(&view, 0, sizeof(PACKET_VIEW));
+	view.fp = fopen(scan->filename, "rb");
+	if (view.fp == NULL){
+		scan->ret = SCAN_OPEN_ERROR;
+		return;
+	}
+
+	// get file size
+	file_size = _filelengthi64(_fileno(view.fp));
+	view.file_size = file_size;
+	view_size = view_window_size(par3_ctx);
+
+	ret = 0;
+	file_offset = 0;
+	strict_offset = UINT64_MAX;
+	if (scan->record != NULL){
+		ret = read_packet_index(scan, &view);
+		if (ret == 0){
+			scan->index_state = 1;
+			file_offset = file_size;	// No need to search packets.
+		} else {
+			scan->count = 0;	// Search whole file, when it's different from index.
+			ret = 0;
+		}
+	}
+	while (file_offset + 48 < file_size){
+		// Map a new window, when the packet header isn't in current window.
+		view_end = view.offset + view.size;
+		if ( (view.data == NULL) || (file_offset < view.offset) || (file_offset + 48 >= view_end) ){
+			map_size = view_size;
+			if (map_size > file_size - file_offset)
+				map_size = (size_t)(file_size - file_offset);
+			ret = view_map(&view, file_offset, map_size);
+			if (ret != 0)
+				break;
+			view_end = view.offset + view.size;
+		}
+
+		// Search Magic sequence in the window.
+		find_size = search_magic(view.data + (file_offset - view.offset), (size_t)(view_end - file_offset));
+		if (file_offset + find_size + 8 > view_end){	// Not found
+			if (view_end >= file_size)
+				break;
+			file_offset = view_end - 7;	// Magic sequence may cross the end of window.
+			continue;
+		}
+		file_offset += find_size;
+		if (file_offset + 48 >= file_size)
+			break;
+		if (file_offset + 48 >= view_end)
+			continue;	// Read the packet header in next window.
+		packet = view.data + (file_offset - view.offset);
+
+		// read packet size
+		memcpy(&packet_size, packet + 24, 8);
+		if (packet_size <= 48){	// If packet is too small, just ignore it.
+			file_offset += 8;
+			continue;
+		}
+		if (packet_size > file_size - file_offset){	// If not enough data, ignore the packet.
+			file_offset += 8;
+			continue;
+		}
+		if ( (par3_ctx->memory_limit != 0) && (packet_size > par3_ctx->memory_limit) ){
+			// If packet is larger than limit, show error later and continue.
+			ret = scan_add(scan, file_offset, packet_size, packet, 1);
+			if (ret != 0)
+				break;
+			file_offset += 8;
+			continue;
+		}
+
+		// Data of Recovery Data Packet is checked later, only when it's required.
+		if ( (par3_ctx->recv_packet_lazy != 0) && (file_offset != strict_offset)
+				&& (packet_size > INDEX_HEAD_SIZE) && (memcmp(packet + 40, "PAR REC\0", 8) == 0) ){
+			ret = read_packet_lazy(scan, &view, file_offset, packet_size, view_size);
+			if (ret == 0){
+				file_offset += packet_size;
+				continue;
+			} else if (ret != 1){
+				break;
 			}
+			ret = 0;
+			strict_offset = file_offset;	// Check the packet, when its size may be wrong.
+			continue;
 		}
 
-		if (fclose(fp) != 0){
-			printf("Failed to close \"%s\", skip to next file.\n", namez + namez_off);
-			namez_off += strlen(namez + namez_off) + 1;
+		// If packet exceeds window, map the whole packet.
+		if (file_offset + packet_size > view_end){
+			map_size = view_size;
+			if (map_size < packet_size)
+				map_size = (size_t)packet_size;
+			if (map_size > file_size - file_offset)
+				map_size = (size_t)(file_size - file_offset);
+			ret = view_map(&view, file_offset, map_size);
+			if (ret != 0)
+				break;
+			packet = view.data;
+		}
+
+		// check fingerprint hash of the packet
+		blake3(packet + 24, packet_size - 24, buf_hash);
+		if (memcmp(packet + 8, buf_hash, 16) != 0){
+			// If checksum is different, ignore the packet.
+			file_offset += 8;
 			continue;
 		}
+		ret = scan_add(scan, file_offset, packet_size, packet, 0);
+		if (ret != 0)
+			break;
 
-		if (par3_ctx->noise_level >= 0){
-			printf("Loaded %"PRIu64" new packets (found %"PRIu64" packets)\n", new_packet_count, packet_count);
+		file_offset += packet_size;
+	}
+
+	view_close(&view);
+	if (ret == RET_FILE_IO_ERROR)
+		ret = SCAN_READ_ERROR;
+	if ( (fclose(view.fp) != 0) && (ret == 0) )
+		ret = SCAN_CLOSE_ERROR;
+	scan->ret = ret;
+}
+
+// Store found packets in order of files, so that result is same on any number of threads.
+// return 0 = done, -1 = skip this file, others = error
+static int read_packet_merge(PACKET_SCAN *scan, uint64_t *packet_count, uint64_t *new_packet_count)
+{
+	PAR3_CTX *par3_ctx = scan->par3_ctx;
+	char packet_type[9];
+	uint8_t *packet;
+	int ret;
+	size_t view_size, map_size, index;
+	uint64_t file_offset, packet_size;
+	PACKET_VIEW view;
+
+	if (scan->ret == SCAN_OPEN_ERROR){
+		printf("Failed to open \"%s\", skip to next file.\n", scan->filename);
+		return -1;
+	}
+	if (scan->ret > 0)
+		return scan->ret;
+
+	packet_type[8] = 0;	// Set null string.
+	memset(&view, 0, sizeof(PACKET_VIEW));
+	if (scan->count > 0){
+		view.fp = fopen(scan->filename, "rb");
+		if (view.fp == NULL){
+			printf("Failed to open \"%s\", skip to next file.\n", scan->filename);
+			return -1;
+		}
+		view.file_size = _filelengthi64(_fileno(view.fp));
+	}
+	view_size = view_window_size(par3_ctx);
+
+	ret = 0;
+	for (index = 0; index < scan->count; index++){
+		file_offset = scan->list[index].offset;
+		packet_size = scan->list[index].size;
+		memcpy(packet_type, scan->list[index].head + 40, 8);
+		if (scan->list[index].flag != 0){
+			if (par3_ctx->noise_level >= 1){
+				printf("Warning, packet is too large. size = %"PRIu64", type = %s\n", packet_size, packet_type);
+			}
+			continue;
+		}
+		*packet_count += 1;
+		if (par3_ctx->noise_level >= 3){
+			printf("offset =%6"PRIu64", size =%5"PRIu64", type = %s\n", file_offset, packet_size, packet_type);
 		}
 
+		// Pages of large packet are not read, because only header is referred.
+		if ( (view.data == NULL) || (file_offset < view.offset) || (file_offset + packet_size > view.offset + view.size) ){
+			map_size = view_size;
+			if (map_size < packet_size)
+				map_size = (size_t)packet_size;
+			if (map_size > view.file_size - file_offset)
+				map_size = (size_t)(view.file_size - file_offset);
+			ret = view_map(&view, file_offset, map_size);
+			if (ret != 0)
+				break;
+		}
+		packet = view.data + (file_offset - view.offset);
+
+		// store the found packet
+		ret = add_found_packet(par3_ctx, packet);
+		if (ret == -2){
+			ret = list_found_packet(par3_ctx, packet, scan->filename, file_offset);
+		}
+		if (ret > 0)
+			break;
+		if (ret == 0)
+			*new_packet_count += 1;
+		ret = 0;
+	}
+
+	if (view.fp != NULL){
+		view_close(&view);
+		fclose(view.fp);
+	}
+	if ( (ret == RET_FILE_IO_ERROR) || (scan->ret == SCAN_READ_ERROR) ){
+		printf("Failed to read \"%s\", skip to next file.\n", scan->filename);
+		ret = -1;
+	} else if ( (ret == 0) && (scan->ret == SCAN_CLOSE_ERROR) ){
+		printf("Failed to close \"%s\", skip to next file.\n", scan->filename);
+		ret = -1;
+	}
+
+	return ret;
+}
+
+int read_packet(PAR3_CTX *par3_ctx)
+{
+	char *namez, index_name[_MAX_PATH + 8];
+	int ret, thread_count;
+	size_t namez_len, namez_off, index;
+	uint32_t num, num_first, num_end, round_count, scan_count, index_count, save_count;
+	uint64_t packet_count, new_packet_count;
+	PACKET_SCAN *scan_list, *scan;
+	PACKET_INDEX_FILE *index_file;
+
+	namez = par3_ctx->par_file_name;
+	namez_len = par3_ctx->par_file_name_len;
+
+	// When index is used, all results are kept to write index file.
+	scan_count = 0;
+	for (namez_off = 0; namez_off < namez_len; namez_off += strlen(namez + namez_off) + 1)
+		scan_count++;
+	scan_list = calloc(scan_count + 1, sizeof(PACKET_SCAN));
+	if (scan_list == NULL){
+		perror("Failed to allocate memory for PAR files");
+		return RET_MEMORY_ERROR;
+	}
+	namez_off = 0;
+	for (num = 0; num < scan_count; num++){
+		scan_list[num].par3_ctx = par3_ctx;
+		scan_list[num].filename = namez + namez_off;
 		namez_off += strlen(namez + namez_off) + 1;
 	}
-	free(buf);
-	par3_ctx->work_buf = NULL;
+
+	index_file = NULL;
+	if (par3_ctx->packet_index != 0){
+		sprintf(index_name, "%s.idx", par3_ctx->par_filename);
+		ret = index_load(par3_ctx, index_name, &index_file);
+		if (ret != 0){
+			free(scan_list);
+			return ret;
+		}
+		for (num = 0; num < scan_count; num++){
+			scan = scan_list + num;
+			if (cache_key(scan->filename, &(scan->key)) == 0){
+				scan->index_state = 2;
+				scan->record = index_find(index_file, scan->filename, &(scan->key));
+			}
+		}
+	}
+
+	// Each round has some files for every thread.
+	thread_count = thread_pool_count();
+	round_count = (uint32_t)thread_count * 4;
+
+	ret = 0;
+	for (num_first = 0; (num_first < scan_count) && (ret <= 0); num_first = num_end){
+		num_end = num_first + round_count;
+		if (num_end > scan_count)
+			num_end = scan_count;
+		thread_pool_run(read_packet_scan, scan_list + num_first, (int)(num_end - num_first));
+
+		for (num = num_first; num < num_end; num++){
+			if (ret <= 0){
+				if (par3_ctx->noise_level >= -1){
+					printf("Loading \"%s\".\n", scan_list[num].filename);
+				}
+
+				packet_count = 0;
+				new_packet_count = 0;
+				ret = read_packet_merge(scan_list + num, &packet_count, &new_packet_count);
+				if ( (ret == 0) && (par3_ctx->noise_level >= 0) ){
+					printf("Loaded %"PRIu64" new packets (found %"PRIu64" packets)\n", new_packet_count, packet_count);
+				}
+				if (ret != 0)
+					scan_list[num].index_state = 0;
+			}
+			if (par3_ctx->packet_index == 0){
+				free(scan_list[num].list);
+				scan_list[num].list = NULL;
+			}
+		}
+	}
+
+	// Write index file, when a file was searched or removed.
+	if ( (ret <= 0) && (par3_ctx->packet_index != 0) ){
+		index_count = 0;
+		save_count = 0;
+		for (num = 0; num < scan_count; num++){
+			scan = scan_list + num;
+			if (scan->ret != 0)
+				scan->index_state = 0;
+			for (index = 0; (scan->index_state != 0) && (index < scan->count); index++){
+				if (scan->list[index].flag != 0)
+					scan->index_state = 0;	// Too large packet isn't checked.
+			}
+			if (scan->index_state == 1)
+				index_count++;
+			if (scan->index_state != 0)
+				save_count++;
+		}
+		if (par3_ctx->noise_level >= 1){
+			printf("Packet index was used for %u of %u PAR files\n", index_count, scan_count);
+		}
+		if ( (index_file == NULL) || (index_count < save_count) || (save_count != index_file->record_count) ){
+			// Failure of writing index isn't fatal.
+			index_save(par3_ctx, index_name, scan_list, scan_count);
+		}
+	}
+	index_release(index_file);
+	for (num = 0; num < scan_count; num++)
+		free(scan_list[num].list);
+	free(scan_list);
+	if (ret > 0)
+		return ret;
 
 	if (par3_ctx->noise_level >= 2){
 		printf("\nTotal packet:\n");
@@ -244,6 +998,211 @@ int read_packet(PAR3_CTX *par3_ctx)
 	return 0;
 }
 
+// Recovery Data Packets in a PAR file
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	PAR3_PKT_CTX *list;
+	uint8_t *bad_list;	// 1 = damaged packet
+	uint64_t count;
+} RECV_CHECK;
+
+// Check fingerprint hash of Recovery Data Packets in a PAR file.
+static void check_recovery_task(void *arg, int index)
+{
+	RECV_CHECK *check = (RECV_CHECK *)arg + index;
+	uint8_t *packet, buf_hash[16];
+	size_t view_size, map_size;
+	uint64_t num, file_offset, packet_size;
+	PACKET_VIEW view;
+
+	memset(check->bad_list, 1, (size_t)(check->count));
+	memset(&view, 0, sizeof(PACKET_VIEW));
+	view.fp = fopen(check->list[0].name, "rb");
+	if (view.fp == NULL)
+		return;
+	view.file_size = _filelengthi64(_fileno(view.fp));
+	view_size = view_window_size(check->par3_ctx);
+
+	for (num = 0; num < check->count; num++){
+		file_offset = (uint64_t)(check->list[num].offset);
+		if (file_offset + 48 > view.file_size)
+			continue;
+		if ( (view.data == NULL) || (file_offset < view.offset) || (file_offset + 48 > view.offset + view.size) ){
+			map_size = view_size;
+			if (map_size > view.file_size - file_offset)
+				map_size = (size_t)(view.file_size - file_offset);
+			if (view_map(&view, file_offset, map_size) != 0)
+				continue;
+		}
+		packet = view.data + (file_offset - view.offset);
+		memcpy(&packet_size, packet + 24, 8);
+		if ( (packet_size <= 48) || (packet_size > view.file_size - file_offset) )
+			continue;
+
+		// If packet exceeds window, map the whole packet.
+		if (file_offset + packet_size > view.offset + view.size){
+			map_size = view_size;
+			if (map_size < packet_size)
+				map_size = (size_t)packet_size;
+			if (map_size > view.file_size - file_offset)
+				map_size = (size_t)(view.file_size - file_offset);
+			if (view_map(&view, file_offset, map_size) != 0)
+				continue;
+			packet = view.data;
+		}
+
+		blake3(packet + 24, packet_size - 24, buf_hash);
+		if (memcmp(packet + 8, buf_hash, 16) == 0)
+			check->bad_list[num] = 0;
+	}
+
+	view_close(&view);
+	fclose(view.fp);
+}
+
+// Search all PAR files again, and add undamaged Recovery Data Packets of using PAR3 Sets.
+static int search_recovery_packet(PAR3_CTX *par3_ctx)
+{
+	char *namez;
+	uint8_t *head, *root;
+	int ret;
+	size_t namez_len, namez_off, index, offset;
+	uint32_t num, num_end, round_count;
+	uint64_t packet_size, add_count;
+	PACKET_SCAN *scan_list, *scan;
+
+	namez = par3_ctx->par_file_name;
+	namez_len = par3_ctx->par_file_name_len;
+	root = NULL;
+	if (par3_ctx->root_packet != NULL)
+		root = par3_ctx->root_packet + 8;	// checksum from Root Packet
+
+	round_count = (uint32_t)thread_pool_count() * 4;
+	scan_list = malloc(sizeof(PACKET_SCAN) * round_count);
+	if (scan_list == NULL){
+		perror("Failed to allocate memory for PAR files");
+		return RET_MEMORY_ERROR;
+	}
+
+	ret = 0;
+	add_count = 0;
+	namez_off = 0;
+	while ( (namez_off < namez_len) && (ret == 0) ){
+		memset(scan_list, 0, sizeof(PACKET_SCAN) * round_count);
+		for (num_end = 0; (num_end < round_count) && (namez_off < namez_len); num_end++){
+			scan_list[num_end].par3_ctx = par3_ctx;
+			scan_list[num_end].filename = namez + namez_off;
+			namez_off += strlen(namez + namez_off) + 1;
+		}
+		thread_pool_run(read_packet_scan, scan_list, (int)num_end);
+
+		for (num = 0; num < num_end; num++){
+			scan = scan_list + num;
+			for (index = 0; (ret == 0) && (scan->ret == 0) && (index < scan->count); index++){
+				// Items of Recovery Data Packet are in the stored header.
+				head = scan->list[index].head;
+				if ( (scan->list[index].flag != 0) || (memcmp(head + 40, "PAR REC\0", 8) != 0) )
+					continue;
+				if ( (root != NULL) && (memcmp(head + 48, root, 16) != 0) )
+					continue;
+
+				// InputSetID must be same as one of Start Packets.
+				offset = 0;
+				while (offset < par3_ctx->start_packet_size){
+					if (memcmp(par3_ctx->start_packet + offset + 32, head + 32, 8) == 0)
+						break;
+					memcpy(&packet_size, par3_ctx->start_packet + offset + 24, 8);
+					offset += (size_t)packet_size;
+				}
+				if (offset >= par3_ctx->start_packet_size)
+					continue;
+
+				ret = list_found_packet(par3_ctx, head, scan->filename, scan->list[index].offset);
+				if (ret == 0)
+					add_count++;
+				if (ret < 0)
+					ret = 0;
+			}
+			free(scan->list);
+		}
+	}
+	free(scan_list);
+	if (ret != 0)
+		return ret;
+
+	if (par3_ctx->noise_level >= 1){
+		printf("Found %"PRIu64" other Recovery Data Packets\n", add_count);
+	}
+	return 0;
+}
+
+// Data of Recovery Data Packets is checked, only when recovery blocks are required.
+// When there are damaged packets, PAR files are searched again to find other copies.
+int check_recovery_packet(PAR3_CTX *par3_ctx)
+{
+	uint8_t *bad_list;
+	uint32_t num, check_count;
+	uint64_t index, count, new_count;
+	PAR3_PKT_CTX *list;
+	RECV_CHECK *check_list;
+
+	if (par3_ctx->recv_packet_lazy == 0)
+		return 0;
+	par3_ctx->recv_packet_lazy = 0;
+	list = par3_ctx->recv_packet_list;
+	count = par3_ctx->recv_packet_count;
+	if (count == 0)
+		return 0;
+
+	// Packets in each PAR file are checked on a thread.
+	check_count = 1;
+	for (index = 1; index < count; index++){
+		if (list[index].name != list[index - 1].name)
+			check_count++;
+	}
+	bad_list = malloc((size_t)count);
+	check_list = malloc(sizeof(RECV_CHECK) * check_count);
+	if ( (bad_list == NULL) || (check_list == NULL) ){
+		perror("Failed to allocate memory for Recovery Data Packet");
+		free(bad_list);
+		free(check_list);
+		return RET_MEMORY_ERROR;
+	}
+	num = 0;
+	for (index = 0; index < count; index++){
+		if ( (index > 0) && (list[index].name != list[index - 1].name) )
+			num++;
+		if ( (index == 0) || (list[index].name != list[index - 1].name) ){
+			check_list[num].par3_ctx = par3_ctx;
+			check_list[num].list = list + index;
+			check_list[num].bad_list = bad_list + index;
+			check_list[num].count = 0;
+		}
+		check_list[num].count++;
+	}
+	thread_pool_run(check_recovery_task, check_list, (int)check_count);
+	free(check_list);
+
+	// Remove damaged packets
+	new_count = 0;
+	for (index = 0; index < count; index++){
+		if (bad_list[index] != 0)
+			continue;
+		if (new_count < index)
+			memcpy(list + new_count, list + index, sizeof(PAR3_PKT_CTX));
+		new_count++;
+	}
+	free(bad_list);
+	if (new_count == count)
+		return 0;
+
+	par3_ctx->recv_packet_count = new_count;
+	if (par3_ctx->noise_level >= 1){
+		printf("%"PRIu64" Recovery Data Packets are damaged, and PAR files are searched again.\n", count - new_count);
+	}
+	return search_recovery_packet(par3_ctx);
+}
+
 void show_read_result(PAR3_CTX *par3_ctx, int flag_detail)
 {
 	uint32_t num;
@@ -1,5 +1,6 @@
 
 int read_packet(PAR3_CTX *par3_ctx);
+int check_recovery_packet(PAR3_CTX *par3_ctx);
 
 void show_read_result(PAR3_CTX *par3_ctx, int flag_detail);
 void show_data_size(PAR3_CTX *par3_ctx);
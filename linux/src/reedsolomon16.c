@@ -7,18 +7,17 @@
 
 #include "libpar3.h"
 #include "galois.h"
+#include "reedsolomon.h"
+#include "thread.h"
 
 
 // Gaussian elimination of matrix for Cauchy Reed-Solomon
 int rs16_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count)
 {
 	uint16_t *gf_table, *matrix;
-	int x, y, y_R, y2;
+	int x, y, y_R, ret;
 	int *lost_id, *recv_id;
 	int block_count;
-	int pivot, factor, factor2;
-	int progress_old, progress_now;
-	time_t time_old, time_now;
 	clock_t clock_now;
 
 	if (lost_count == 0)
@@ -64,51 +63,11 @@ int rs16_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count)
 	// Gaussian elimination
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing Reed Solomon matrix:\n");
-		progress_old = 0;
-		time_old = time(NULL);
 		clock_now = clock();
 	}
-	for (y = 0; y < lost_count; y++){
-		// Let pivot value to be 1.
-		pivot = lost_id[y];
-		factor = matrix[block_count * y + pivot];
-		if (factor == 0){
-			printf("Failed to invert matrix\n");
-			return RET_LOGIC_ERROR;
-		}
-		factor = gf16_reciprocal(gf_table, factor);
-		gf16_region_multiply(gf_table, (uint8_t *)(matrix + block_count * y), factor, block_count * 2, NULL, 0);
-
-		// Erase values of same pivot on other rows.
-		for (y2 = 0; y2 < lost_count; y2++){
-			if (y2 == y)
-				continue;
-
-			factor2 = matrix[block_count * y2 + pivot];
-			gf16_region_multiply(gf_table, (uint8_t *)(matrix + block_count * y), factor2, block_count * 2, (uint8_t *)(matrix + block_count * y2), 1);
-
-			// After eliminate the pivot value, store "factor * factor2" value on the pivot.
-			matrix[block_count * y2 + pivot] = gf16_multiply(gf_table, factor, factor2);
-		}
-
-		// After eliminate the pivot columun, store "factor" value on the pivot.
-		matrix[block_count * y + pivot] = factor;
-
-		// Print progress percent
-		if (par3_ctx->noise_level >= 0){
-			time_now = time(NULL);
-			if (time_now != time_old){
-				time_old = time_now;
-				// Complexity is "lost_count * lost_count * block_count".
-				// Because lost_count is 16-bit value, "int" (32-bit signed integer) is enough.
-				progress_now = (y * 1000) / lost_count;
-				if (progress_now != progress_old){
-					progress_old = progress_now;
-					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-				}
-			}
-		}
-	}
+	ret = rs_gaussian_elimination(par3_ctx, lost_count);
+	if (ret != 0)
+		return ret;
 	if (par3_ctx->noise_level >= 0){
 		clock_now = clock() - clock_now;
 		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
@@ -142,23 +101,165 @@ https://en.wikipedia.org/wiki/Cauchy_matrix
 Inverse of Cauchy Matrix
 https://proofwiki.org/wiki/Inverse_of_Cauchy_Matrix
 
+Products are calculated as sum of logarithms, and rows are shared by threads.
+
 */
+
+// Arguments for multi-threading of fast inversion
+typedef struct {
+	uint16_t *gf_table;
+	uint16_t *matrix;
+	int *x, *y, *a, *b, *c, *d;
+	int block_count;
+	int lost_count;
+	int item_first;	// index of the first item in this round
+	int item_step;	// number of items per task
+	int item_count;	// number of items in this round
+} RS16_INVERT_CTX;
+
+// Calculate logarithm of a[i], b[i], c[i], and d[i] for items of a task.
+static void rs16_cauchy_product_task(void *arg, int index)
+{
+	RS16_INVERT_CTX *ctx = arg;
+	uint16_t *galois_log_table;
+	int *x, *y;
+	int i, i_end, j, lost_count;
+	uint32_t sum_a, sum_b, sum_c, sum_d;
+
+	galois_log_table = ctx->gf_table;
+	x = ctx->x;
+	y = ctx->y;
+	lost_count = ctx->lost_count;
+	i = ctx->item_first + ctx->item_step * index;
+	i_end = i + ctx->item_step;
+	if (i_end > ctx->item_first + ctx->item_count)
+		i_end = ctx->item_first + ctx->item_count;
+
+	for (; i < i_end; i++){
+		sum_a = 0;
+		sum_c = 0;
+		for (j = 0; j < lost_count; j++){
+			if (i != j)
+				sum_a += galois_log_table[x[i] ^ x[j]];
+			sum_c += galois_log_table[x[i] ^ y[j]];
+		}
+		ctx->a[i] = (int)(sum_a % 65535);
+		ctx->c[i] = (int)(sum_c % 65535);
+
+		// b[i] and d[i] are used only for lost blocks.
+		if (i < lost_count){
+			sum_b = 0;
+			sum_d = 0;
+			for (j = 0; j < lost_count; j++){
+				if (i != j)
+					sum_b += galois_log_table[y[i] ^ y[j]];
+				sum_d += galois_log_table[y[i] ^ x[j]];
+			}
+			ctx->b[i] = (int)(sum_b % 65535);
+			ctx->d[i] = (int)(sum_d % 65535);
+		}
+	}
+}
+
+// Set elements of matrix for rows of a task.
+static void rs16_cauchy_matrix_task(void *arg, int index)
+{
+	RS16_INVERT_CTX *ctx = arg;
+	uint16_t *galois_log_table, *galois_ilog_table, *row;
+	int *x, *y, *p;
+	int i, i_end, j, k, q, block_count;
+
+	galois_log_table = ctx->gf_table;
+	galois_ilog_table = galois_log_table + 65536;
+	x = ctx->x;
+	y = ctx->y;
+	p = ctx->c;	// log( c[j] / a[j] )
+	block_count = ctx->block_count;
+	i = ctx->item_first + ctx->item_step * index;
+	i_end = i + ctx->item_step;
+	if (i_end > ctx->item_first + ctx->item_count)
+		i_end = ctx->item_first + ctx->item_count;
+
+	for (; i < i_end; i++){
+		q = ctx->d[i] - ctx->b[i];	// log( d[i] / b[i] )
+		if (q < 0)
+			q += 65535;
+		row = ctx->matrix + (size_t)block_count * i;
+
+		// k = (c[j] * d[i]) / (a[j] * b[i] * (x[j] ^ y[i]))
+		for (j = 0; j < block_count; j++){
+			k = p[j] + q - galois_log_table[x[j] ^ y[i]];
+			if (k < 0){
+				k += 65535;
+			} else if (k >= 65535){
+				k -= 65535;
+			}
+			row[ y[j] ] = galois_ilog_table[k];
+		}
+	}
+}
+
+// Run tasks for all items, and print progress between rounds.
+static void rs16_cauchy_run(PAR3_CTX *par3_ctx, RS16_INVERT_CTX *ctx, void (*func)(void *arg, int index),
+				int item_count, int item_cost, int progress_base, int progress_total)
+{
+	int thread_count, max_step, item_end;
+	int progress_old, progress_now;
+	time_t time_old, time_now;
+
+	// Each task should be large enough (at least 64K operations),
+	// but every thread needs a task.
+	thread_count = thread_pool_count();
+	ctx->item_step = 65536 / item_cost + 1;
+	max_step = (item_count + thread_count - 1) / thread_count;
+	if (ctx->item_step > max_step)
+		ctx->item_step = max_step;
+	if (ctx->item_step < 1)
+		ctx->item_step = 1;
+
+	if (par3_ctx->noise_level >= 0){
+		progress_old = 0;
+		time_old = time(NULL);
+	}
+
+	for (ctx->item_first = 0; ctx->item_first < item_count; ctx->item_first = item_end){
+		item_end = ctx->item_first + ctx->item_step * thread_count;
+		if (item_end > item_count)
+			item_end = item_count;
+		ctx->item_count = item_end - ctx->item_first;
+		thread_pool_run(func, ctx, (ctx->item_count + ctx->item_step - 1) / ctx->item_step);
+
+		// Print progress percent
+		if (par3_ctx->noise_level >= 0){
+			time_now = time(NULL);
+			if (time_now != time_old){
+				time_old = time_now;
+				// Complexity is "lost_count * block_count * 2".
+				// Because lost_count is 16-bit value, "int" (32-bit signed integer) is enough.
+				progress_now = ((progress_base + item_end) * 1000) / progress_total;
+				if (progress_now != progress_old){
+					progress_old = progress_now;
+					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+				}
+			}
+		}
+	}
+}
+
 int rs16_invert_matrix_cauchy(PAR3_CTX *par3_ctx, int lost_count)
 {
-	uint16_t *gf_table, *matrix;
+	uint16_t *matrix;
 	int *x, *y, *a, *b, *c, *d;
 	int i, j, k;
 	int *lost_id, *recv_id;
 	int block_count;
-	int progress_old, progress_now;
-	time_t time_old, time_now;
 	clock_t clock_now;
+	RS16_INVERT_CTX ctx;
 
 	if (lost_count == 0)
 		return 0;
 
 	block_count = (int)(par3_ctx->block_count);
-	gf_table = par3_ctx->galois_table;
 	recv_id = par3_ctx->recv_id_list;
 	lost_id = recv_id + lost_count;
 
@@ -184,8 +285,6 @@ int rs16_invert_matrix_cauchy(PAR3_CTX *par3_ctx, int lost_count)
 
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing Reed Solomon matrix:\n");
-		progress_old = 0;
-		time_old = time(NULL);
 		clock_now = clock();
 	}
 
@@ -213,37 +312,20 @@ int rs16_invert_matrix_cauchy(PAR3_CTX *par3_ctx, int lost_count)
 		x[i] = y[i];
 	}
 
-	for (i = 0; i < block_count; i++){
-		a[i] = 1;
-		b[i] = 1;
-		c[i] = 1;
-		d[i] = 1;
-
-		for (j = 0; j < lost_count; j++){
-			if (i != j){
-				a[i] = gf16_multiply(gf_table, a[i], x[i] ^ x[j]);
-				b[i] = gf16_multiply(gf_table, b[i], y[i] ^ y[j]);
-			}
-
-			c[i] = gf16_multiply(gf_table, c[i], x[i] ^ y[j]);
-			d[i] = gf16_multiply(gf_table, d[i], y[i] ^ x[j]);
-		}
-
-		// Print progress percent
-		if (par3_ctx->noise_level >= 0){
-			time_now = time(NULL);
-			if (time_now != time_old){
-				time_old = time_now;
-				// Complexity is "lost_count * block_count * 2".
-				// Because lost_count is 16-bit value, "int" (32-bit signed integer) is enough.
-				progress_now = (i * 1000) / (block_count + lost_count);
-				if (progress_now != progress_old){
-					progress_old = progress_now;
-					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-				}
-			}
-		}
-	}
+	ctx.gf_table = par3_ctx->galois_table;
+	ctx.matrix = matrix;
+	ctx.x = x;
+	ctx.y = y;
+	ctx.a = a;
+	ctx.b = b;
+	ctx.c = c;
+	ctx.d = d;
+	ctx.block_count = block_count;
+	ctx.lost_count = lost_count;
+
+	// a[i], b[i], c[i], d[i] are logarithm of products.
+	rs16_cauchy_run(par3_ctx, &ctx, rs16_cauchy_product_task, block_count, lost_count * 4,
+					0, block_count + lost_count);
 
 /*
 	if (par3_ctx->noise_level >= 3){
@@ -258,52 +340,18 @@ int rs16_invert_matrix_cauchy(PAR3_CTX *par3_ctx, int lost_count)
 			printf(" %4x", x[i]);
 		}
 		printf("\n");
-		printf("a =");
-		for (i = 0; i < block_count; i++){
-			printf(" %4x", a[i]);
-		}
-		printf("\n");
-		printf("b =");
-		for (i = 0; i < block_count; i++){
-			printf(" %4x", b[i]);
-		}
-		printf("\n");
-		printf("c =");
-		for (i = 0; i < block_count; i++){
-			printf(" %4x", c[i]);
-		}
-		printf("\n");
-		printf("d =");
-		for (i = 0; i < block_count; i++){
-			printf(" %4x", d[i]);
-		}
-		printf("\n");
 	}
 */
 
-	for (i = 0; i < lost_count; i++){
-		for (j = 0; j < block_count; j++){
-			k = gf16_multiply(gf_table, a[j], b[i]);
-			k = gf16_reciprocal(gf_table, gf16_multiply(gf_table, k, x[j] ^ y[i]));
-			k = gf16_multiply(gf_table, gf16_multiply(gf_table, c[j], d[i]), k);
-			matrix[ block_count * i + y[j] ] = k;
-		}
-
-		// Print progress percent
-		if (par3_ctx->noise_level >= 0){
-			time_now = time(NULL);
-			if (time_now != time_old){
-				time_old = time_now;
-				// Complexity is "lost_count * block_count * 2".
-				// Because lost_count is 16-bit value, "int" (32-bit signed integer) is enough.
-				progress_now = ((block_count + i) * 1000) / (block_count + lost_count);
-				if (progress_now != progress_old){
-					progress_old = progress_now;
-					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-				}
-			}
-		}
+	// c[j] becomes log( c[j] / a[j] ).
+	for (j = 0; j < block_count; j++){
+		c[j] -= a[j];
+		if (c[j] < 0)
+			c[j] += 65535;
 	}
+
+	rs16_cauchy_run(par3_ctx, &ctx, rs16_cauchy_matrix_task, lost_count, block_count,
+					block_count, block_count + lost_count);
 	if (par3_ctx->noise_level >= 0){
 		clock_now = clock() - clock_now;
 		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
@@ -325,4 +373,3 @@ int rs16_invert_matrix_cauchy(PAR3_CTX *par3_ctx, int lost_count)
 
 	return 0;
 }
-
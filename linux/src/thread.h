@@ -0,0 +1,38 @@
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+// Max number of threads in the pool
+#define MAX_THREAD_COUNT	256
+
+// Number of logical processors
+int thread_cpu_count(void);
+
+// Worker threads, which are started once and reused.
+int thread_pool_start(int thread_count);
+void thread_pool_stop(void);
+int thread_pool_count(void);
+
+// Call func(arg, index) for index = 0 ~ task_count - 1 on all threads.
+// It returns after all tasks were done. When it's called from inside a task,
+// or from a thread other than the one which started the pool, tasks run serially.
+void thread_pool_run(void (*func)(void *arg, int index), void *arg, int task_count);
+
+// A background thread, which prepares data in slots of a ring buffer.
+// It calls func(arg, index, index % slot_count) for index = 0 ~ task_count - 1 in order.
+// When func returns non-zero, later tasks are canceled.
+typedef struct THREAD_RING_CTX THREAD_RING;
+THREAD_RING * thread_ring_start(int (*func)(void *arg, int index, int slot), void *arg, int task_count, int slot_count);
+
+// Wait until the task of index is done, and return the result of func.
+int thread_ring_wait(THREAD_RING *ring, int index);
+
+// Release the slot of index, so that the thread can reuse it.
+void thread_ring_release(THREAD_RING *ring, int index);
+
+// Cancel remaining tasks, and wait until the thread exits.
+void thread_ring_stop(THREAD_RING *ring);
+
+// Elapsed time in seconds, which is used to measure each stage.
+double thread_time(void);
+
+#endif // __THREAD_H__
@@ -10,6 +10,9 @@ int verify_extra_file(PAR3_CTX *par3_ctx, uint32_t *missing_file_count, uint32_t
 int check_complete_file(PAR3_CTX *par3_ctx, char *filename, uint32_t file_id,
 	uint64_t current_size, uint64_t *offset_next);
 
+// Set found slices of a file, which exists in hash cache
+int check_cached_file(PAR3_CTX *par3_ctx, uint32_t file_id, uint64_t current_size, uint8_t *cached_hash);
+
 int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 	uint64_t file_size, uint64_t file_offset, uint64_t *file_damage, uint8_t *file_hash);
 
@@ -25,6 +25,7 @@
 #include "libpar3.h"
 #include "common.h"
 #include "hash.h"
+#include "thread.h"
 
 
 /*
@@ -245,7 +246,7 @@ int check_complete_file(PAR3_CTX *par3_ctx, char *filename, uint32_t file_id,
 					flag_unknown = 1;	// sign of unknown checksum
 				}
 
-				blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
+				blake3_update(&hasher, work_buf, (size_t)block_size);
 				block_index++;
 				slice_index++;
 				chunk_size -= block_size;
@@ -325,7 +326,7 @@ int check_complete_file(PAR3_CTX *par3_ctx, char *filename, uint32_t file_id,
 					fclose(fp);
 					return -5;
 				}
-				blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
+				blake3_update(&hasher, work_buf, (size_t)tail_size);
 				slice_index++;
 				chunk_size -= tail_size;
 				file_offset += tail_size;
@@ -377,7 +378,7 @@ int check_complete_file(PAR3_CTX *par3_ctx, char *filename, uint32_t file_id,
 					return -6;
 				}
 
-				blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
+				blake3_update(&hasher, work_buf, (size_t)tail_size);
 				chunk_size -= tail_size;
 				file_offset += tail_size;
 				if ( (flag_unknown == 0) && (offset_next != NULL) )
@@ -485,53 +486,182 @@ int check_complete_file(PAR3_CTX *par3_ctx, char *filename, uint32_t file_id,
 	return 0;
 }
 
+/*
+When hash cache has the same file, set found slices without reading file data.
+cached_hash = BLAKE3 hash of the file at the last verification
+
+return 0 = complete, -1 = need to read file data
+*/
+int check_cached_file(PAR3_CTX *par3_ctx, uint32_t file_id, uint64_t current_size, uint8_t *cached_hash)
+{
+	uint32_t chunk_index, chunk_num;
+	int64_t block_index;
+	uint64_t block_size, slice_index;
+	uint64_t chunk_size, file_offset;
+	PAR3_FILE_CTX *file_p;
+	PAR3_CHUNK_CTX *chunk_list;
+	PAR3_BLOCK_CTX *block_list;
+	PAR3_SLICE_CTX *slice_list;
+
+	file_p = par3_ctx->input_file_list + file_id;
+	if ( (file_p->size == 0) || (current_size != file_p->size) )
+		return -1;
+	// Unprotected chunks or unknown file hash cannot be compared.
+	if ( (file_p->state & 0x80000000) || (mem_or16(file_p->hash) == 0) )
+		return -1;
+	if (memcmp(cached_hash, file_p->hash, 16) != 0)
+		return -1;
+
+	block_size = par3_ctx->block_size;
+	chunk_list = par3_ctx->chunk_list;
+	block_list = par3_ctx->block_list;
+	slice_list = par3_ctx->slice_list;
+
+	// Every block must have checksum, because it isn't calculated here.
+	chunk_index = file_p->chunk;
+	for (chunk_num = file_p->chunk_num; chunk_num > 0; chunk_num--){
+		chunk_size = chunk_list[chunk_index].size;
+		block_index = chunk_list[chunk_index].block;
+		while (chunk_size >= block_size){
+			if ((block_list[block_index].state & 64) == 0)
+				return -1;
+			block_index++;
+			chunk_size -= block_size;
+		}
+		chunk_index++;
+	}
+
+	if (par3_ctx->noise_level >= 1){
+		printf("Checksum of file was found in hash cache.\n");
+	}
+
+	// Set block info
+	file_offset = 0;
+	chunk_index = file_p->chunk;
+	slice_index = file_p->slice;
+	for (chunk_num = file_p->chunk_num; chunk_num > 0; chunk_num--){
+		chunk_size = chunk_list[chunk_index].size;
+		block_index = chunk_list[chunk_index].block;
+		while (chunk_size >= block_size){
+			slice_list[slice_index].find_name = file_p->name;
+			slice_list[slice_index].find_offset = file_offset;
+			block_list[block_index].state |= 4;
+			slice_index++;
+			block_index++;
+			file_offset += block_size;
+			chunk_size -= block_size;
+		}
+		if (chunk_size >= 40){
+			slice_list[slice_index].find_name = file_p->name;
+			slice_list[slice_index].find_offset = file_offset;
+			block_list[chunk_list[chunk_index].tail_block].state |= 8;
+			slice_index++;
+		}
+		file_offset += chunk_size;
+		chunk_index++;
+	}
+
+	return 0;
+}
+
 #define CHECK_SLIDE_INTERVAL 8
 #define CHECK_SLIDE_RANGE 10
+#define SLIDE_SEGMENT_SIZE (1 << 26)	// 64 MB
+
+// Found slice while slide search
+typedef struct {
+	int64_t slice;		// index of slice
+	uint64_t offset;	// position of the slice in the file
+	int flag;			// 4 = full size block, 8 = chunk tail
+} SLIDE_FIND;
+
+// Large file is split into segments, and they are searched independently.
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	char *filename;
+	uint64_t file_size;
+	uint64_t start, end;	// range of offsets to search slices
+
+	SLIDE_FIND *find_list;	// found slices in this segment
+	int64_t find_count;
+	int64_t find_size;		// number of allocated items
+	uint64_t first_min;		// offset of the first found slice
+	uint64_t last_max;		// end of found slices
+	uint64_t damage_size;	// damaged bytes after the first found slice
+
+	blake3_hasher *hasher;	// When it isn't NULL, this task calculates file hash only.
+	int ret;
+} SLIDE_SEGMENT;
+
+// Add a found slice to the segment.
+static int slide_find_add(SLIDE_SEGMENT *seg, int64_t slice_index, uint64_t offset, int flag)
+{
+	SLIDE_FIND *find_p;
 
-// This checks available slices in the file.
-// This uses pointer of filename, instead of file ID.
-int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
-	uint64_t file_size, uint64_t file_offset, uint64_t *file_damage, uint8_t *file_hash)
+	if (seg->find_count >= seg->find_size){
+		if (seg->find_size == 0){
+			seg->find_size = 64;
+		} else {
+			seg->find_size *= 2;
+		}
+		find_p = realloc(seg->find_list, sizeof(SLIDE_FIND) * seg->find_size);
+		if (find_p == NULL){
+			perror("Failed to re-allocate memory for found slices");
+			return RET_MEMORY_ERROR;
+		}
+		seg->find_list = find_p;
+	}
+
+	find_p = seg->find_list + seg->find_count;
+	find_p->slice = slice_index;
+	find_p->offset = offset;
+	find_p->flag = flag;
+	seg->find_count++;
+
+	return 0;
+}
+
+// This searches slices in a segment of the file.
+// Found slices are stored in the segment, and they are set in slice_list later.
+// crc_list and tail_list are buffers to copy hash index for local usage.
+static int check_damaged_segment(SLIDE_SEGMENT *seg, uint8_t *work_buf,
+	PAR3_CMP_CTX *crc_list, PAR3_CMP_CTX *tail_list, blake3_hasher *hasher)
 {
-	uint8_t *work_buf, buf_hash[16], buf_hash2[16];
+	PAR3_CTX *par3_ctx;
+	char *filename;
+	uint8_t buf_hash[16], buf_hash2[16];
 	int flag_slide, hash_counter;
 	int64_t find_index, block_index, slice_index;
 	int64_t crc_count, tail_count;
+	uint64_t crc_mask, tail_mask, *crc_filter, *tail_filter;
 	int64_t next_offset, next_slice, slice_count;
 	uint64_t block_size, read_size, slide_offset, slide_start;
 	uint64_t crc, crc40, tail_size, temp_crc;
 	uint64_t uniform_start, uniform_end, hash_offset;
 	uint64_t window_mask, *window_table, window_mask40, *window_table40;
-	uint64_t damage_size, find_last, find_min, find_max;
+	uint64_t crc_batch[CRC_SLIDE_BATCH], batch_start, batch_end;
+	uint64_t file_size, file_offset;
+	uint64_t damage_size, find_last, find_min, find_max, first_min;
 	PAR3_BLOCK_CTX *block_list;
 	PAR3_SLICE_CTX *slice_list;
 	PAR3_CHUNK_CTX *chunk_list;
-	PAR3_CMP_CTX *crc_list, *tail_list;
 	FILE *fp;
 	clock_t time_slide, time_limit;
-	blake3_hasher hasher;
 
-	if (filename == NULL){
-		printf("File name is bad.\n");
-		return RET_LOGIC_ERROR;
-	}
-	if (file_offset >= file_size){
-		if (file_damage != NULL)
-			*file_damage = 0;
-		return 0;
-	}
-	if (par3_ctx->noise_level >= 1){
-		printf("current file size = %"PRIu64", start = %"PRIu64", \"%s\"\n", file_size, file_offset, filename);
-	}
+	// Copy variables from segment to local.
+	par3_ctx = seg->par3_ctx;
+	filename = seg->filename;
+	file_size = seg->file_size;
+	file_offset = seg->start;
 
-	// File data till file_offset is available.
+	// Leading damage before the first found slice is counted at merging segments.
 	damage_size = 0;
+	first_min = file_size;
 	find_last = find_max = file_offset;
 
 	// Copy variables from context to local.
 	block_size = par3_ctx->block_size;
 	slice_count = par3_ctx->slice_count;
-	work_buf = par3_ctx->work_buf;
 	block_list = par3_ctx->block_list;
 	slice_list = par3_ctx->slice_list;
 	chunk_list = par3_ctx->chunk_list;
@@ -549,14 +679,19 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 	window_mask40 = par3_ctx->window_mask40;
 	window_table40 = par3_ctx->window_table40;
 
-	// Copy CRC-list for local usage.
+	// Copy hash index of CRC-64 for local usage.
 	crc_count = par3_ctx->crc_count;
-	crc_list = par3_ctx->crc_list + crc_count; // Allocated memory for CRC-list was double size.
-	memcpy(crc_list, par3_ctx->crc_list, sizeof(PAR3_CMP_CTX) * crc_count);
+	crc_mask = par3_ctx->crc_mask;
+	if (crc_count > 0)
+		memcpy(crc_list, par3_ctx->crc_list, sizeof(PAR3_CMP_CTX) * (crc_mask + 1));
 	tail_count = par3_ctx->tail_count;
-	tail_list = par3_ctx->tail_list + tail_count;
-	memcpy(tail_list, par3_ctx->tail_list, sizeof(PAR3_CMP_CTX) * tail_count);
-	// It's possible to remove items from the list, when a slice was found in this file.
+	tail_mask = par3_ctx->tail_mask;
+	if (tail_count > 0)
+		memcpy(tail_list, par3_ctx->tail_list, sizeof(PAR3_CMP_CTX) * (tail_mask + 1));
+	// It's possible to remove items from the index, when a slice was found in this file.
+	// Bitmap filters are shared, because removed items may remain in them.
+	crc_filter = par3_ctx->crc_filter;
+	tail_filter = par3_ctx->tail_filter;
 
 	fp = fopen(filename, "rb");
 	if (fp == NULL){
@@ -583,10 +718,8 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 		return RET_FILE_IO_ERROR;
 	}
 	//printf("file_offset = %"PRIu64", read_size = %"PRIu64"\n", file_offset, read_size);
-	if (file_hash != NULL){
-		blake3_hasher_init(&hasher);
-		blake3_hasher_update(&hasher, work_buf, (size_t)read_size);
-	}
+	if (hasher != NULL)
+		blake3_update(hasher, work_buf, (size_t)read_size);
 
 	// Calculate CRC-64 of the first block.
 	if ( (crc_count > 0) && (read_size >= block_size) )
@@ -596,6 +729,7 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 	//printf("block crc = 0x%016"PRIx64", tail crc = 0x%016"PRIx64"\n", crc, crc40);
 
 	next_offset = -1;
+	next_slice = 0;
 	while (file_offset < file_size){
 		// Prepare to check range of found slices
 		find_min = file_size;
@@ -623,11 +757,10 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							printf("p fu block[%2"PRId64"] : slice[%2"PRId64"] offset = %"PRIu64" + %"PRIu64"\n",
 									block_index, slice_index, file_offset, slide_offset);
 						}
-						if ((block_list[block_index].state & 4) == 0){	// When this block was not found yet.
-							// Store filename & position of this slice for later reading.
-							slice_list[slice_index].find_name = filename;
-							slice_list[slice_index].find_offset = file_offset + slide_offset;
-							block_list[block_index].state |= 4;
+						// Store position of this slice for later reading.
+						if (slide_find_add(seg, slice_index, file_offset + slide_offset, 4) != 0){
+							fclose(fp);
+							return RET_MEMORY_ERROR;
 						}
 						if (find_min > file_offset + slide_offset)
 							find_min = file_offset + slide_offset;
@@ -635,10 +768,11 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							find_max = file_offset + slide_offset + block_size;
 
 						// When CRC and BLAKE3 match, remove this item from crc_list.
-						find_index = cmp_list_search_index(par3_ctx, temp_crc, block_index, crc_list, crc_count);
+						find_index = -1;
+						if (crc_count > 0)
+							find_index = cmp_list_search_index(crc_list, crc_mask, temp_crc, block_index);
 						if (find_index >= 0){
-							if (find_index + 1 < crc_count)
-								memmove(crc_list + find_index, crc_list + find_index + 1, sizeof(PAR3_CMP_CTX) * (crc_count - find_index - 1));
+							cmp_list_remove(crc_list, crc_mask, find_index);
 							crc_count--;
 							//printf("Remove item[%"PRId64"] : block[%"PRIu64"] from crc_list. crc_count = %"PRIu64"\n", find_index, block_index, crc_count);
 						}
@@ -666,11 +800,10 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							printf("p ta block[%2"PRId64"] : slice[%2"PRId64"] offset = %"PRIu64" + %"PRIu64", tail size = %"PRIu64", offset = %"PRIu64"\n",
 									block_index, slice_index, file_offset, slide_offset, tail_size, slice_list[slice_index].tail_offset);
 						}
-						if (slice_list[slice_index].find_name == NULL){	// When this slice was not found yet.
-							// Store filename & position of this slice for later reading.
-							slice_list[slice_index].find_name = filename;
-							slice_list[slice_index].find_offset = file_offset + slide_offset;
-							block_list[block_index].state |= 8;
+						// Store position of this slice for later reading.
+						if (slide_find_add(seg, slice_index, file_offset + slide_offset, 8) != 0){
+							fclose(fp);
+							return RET_MEMORY_ERROR;
 						}
 						if (find_min > file_offset + slide_offset)
 							find_min = file_offset + slide_offset;
@@ -678,10 +811,11 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							find_max = file_offset + slide_offset + tail_size;
 
 						// When CRC and BLAKE3 match, remove this item from tail_list.
-						find_index = cmp_list_search_index(par3_ctx, temp_crc, slice_index, tail_list, tail_count);
+						find_index = -1;
+						if (tail_count > 0)
+							find_index = cmp_list_search_index(tail_list, tail_mask, temp_crc, slice_index);
 						if (find_index >= 0){
-							if (find_index + 1 < tail_count)
-								memmove(tail_list + find_index, tail_list + find_index + 1, sizeof(PAR3_CMP_CTX) * (tail_count - find_index - 1));
+							cmp_list_remove(tail_list, tail_mask, find_index);
 							tail_count--;
 							//printf("Remove item[%"PRId64"] : block[%"PRIu64"] from tail_list. tail_count = %"PRIu64"\n", find_index, block_index, tail_count);
 						}
@@ -715,10 +849,13 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 			hash_offset = 0;
 			time_slide = clock();	// Store starting time of slide search.
 			slide_offset = slide_start;
+			batch_start = batch_end = 0;
 			while ( (slide_offset < block_size) && (file_offset + slide_offset + block_size <= file_size) ){
 				tail_size = 0;
-				// find_index is the first index of the matching CRC-64. There may be multiple items.
-				find_index = cmp_list_search(par3_ctx, crc, crc_list, crc_count);
+				// find_index is position of the first matching CRC-64. There may be multiple items.
+				find_index = -1;
+				if (CMP_FILTER_TEST(crc_filter, crc_mask, crc) != 0)
+					find_index = cmp_list_search(crc_list, crc_mask, crc);
 				while (find_index >= 0){	// When CRC-64 is same.
 					block_index = crc_list[find_index].index;	// index of block
 					if (tail_size == 0){	// When it didn't hash the block data yet.
@@ -737,11 +874,10 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							printf("full block[%2"PRId64"] : slice[%2"PRId64"] offset = %"PRIu64" + %"PRIu64"\n",
 									block_index, slice_index, file_offset, slide_offset);
 						}
-						if ((block_list[block_index].state & 4) == 0){	// When this block was not found yet.
-							// Store filename & position of this slice for later reading.
-							slice_list[slice_index].find_name = filename;
-							slice_list[slice_index].find_offset = file_offset + slide_offset;
-							block_list[block_index].state |= 4;
+						// Store position of this slice for later reading.
+						if (slide_find_add(seg, slice_index, file_offset + slide_offset, 4) != 0){
+							fclose(fp);
+							return RET_MEMORY_ERROR;
 						}
 						if (find_min > file_offset + slide_offset)
 							find_min = file_offset + slide_offset;
@@ -757,8 +893,8 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 						}
 
 						// When CRC and BLAKE3 match, remove this item from crc_list.
-						if (find_index + 1 < crc_count)
-							memmove(crc_list + find_index, crc_list + find_index + 1, sizeof(PAR3_CMP_CTX) * (crc_count - find_index - 1));
+						// Next item may be shifted into the same position.
+						cmp_list_remove(crc_list, crc_mask, find_index);
 						crc_count--;
 						// The same block won't be found in this file anymore.
 						// It may be found in another damaged or extra file.
@@ -769,16 +905,35 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 						find_index++;
 					}
 
-					if (find_index == crc_count)
-						break;
-					if (crc_list[find_index].crc != crc)
-						break;
+					find_index = cmp_list_next(crc_list, crc_mask, crc, find_index);
 				}
 
 				temp_crc = crc;	// Save previous CRC-64 to compare later
-				crc = window_mask ^ crc_slide_byte(window_mask ^ crc,
-						work_buf[slide_offset + block_size], work_buf[slide_offset], window_table);
 				slide_offset++;
+				if (slide_offset < batch_end){
+					// Skip offsets, which are rejected by bitmap filter.
+					slide_offset = batch_start + crc_slide_scan(crc_batch, (size_t)(slide_offset - batch_start),
+							(size_t)(batch_end - batch_start), crc_filter, crc_mask);
+					if (slide_offset >= batch_end)
+						slide_offset = batch_end - 1;
+					crc = crc_batch[slide_offset - batch_start];
+					temp_crc = crc_batch[slide_offset - batch_start - 1];
+				} else {
+					crc = window_mask ^ crc_slide_byte(window_mask ^ crc,
+							work_buf[slide_offset - 1 + block_size], work_buf[slide_offset - 1], window_table);
+
+					// Slide next range of offsets at once, till the first offset of next block.
+					batch_start = slide_offset;
+					batch_end = block_size + 1;
+					if (batch_end > file_size - file_offset - block_size + 1)
+						batch_end = file_size - file_offset - block_size + 1;
+					if (batch_end > batch_start + CRC_SLIDE_BATCH)
+						batch_end = batch_start + CRC_SLIDE_BATCH;
+					if (batch_end > batch_start + 1){
+						crc_slide_batch(work_buf + batch_start, block_size, (size_t)(batch_end - batch_start),
+								crc, crc_batch, window_mask, window_table);
+					}
+				}
 
 				if (hash_counter >= CHECK_SLIDE_INTERVAL){	// Check freeze after sliding several bytes each.
 					// When hashing over than 8 times per 1 KB range.
@@ -841,11 +996,14 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 			hash_offset = 0;
 			time_slide = clock();	// Store starting time of slide search.
 			slide_offset = slide_start;
+			batch_start = batch_end = 0;
 			while ( (slide_offset < block_size) && (file_offset + slide_offset + 40 <= file_size) ){
 				// Because CRC-64 for chunk tails is a range of the first 40-bytes, total data may be different.
 				tail_size = 0;
-				// find_index is the first index of the matching CRC-64. There may be multiple items.
-				find_index = cmp_list_search(par3_ctx, crc40, tail_list, tail_count);
+				// find_index is position of the first matching CRC-64. There may be multiple items.
+				find_index = -1;
+				if (CMP_FILTER_TEST(tail_filter, tail_mask, crc40) != 0)
+					find_index = cmp_list_search(tail_list, tail_mask, crc40);
 				while (find_index >= 0){	// When CRC-64 is same.
 					slice_index = tail_list[find_index].index;	// index of slice
 					if (tail_size != slice_list[slice_index].size){
@@ -877,11 +1035,10 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 							printf("tail block[%2"PRIu64"] : slice[%2"PRId64"] offset = %"PRIu64" + %"PRIu64", tail size = %"PRIu64", offset = %"PRIu64"\n",
 									block_index, slice_index, file_offset, slide_offset, tail_size, slice_list[slice_index].tail_offset);
 						}
-						if (slice_list[slice_index].find_name == NULL){	// When this slice was not found yet.
-							// Store filename & position of this slice for later reading.
-							slice_list[slice_index].find_name = filename;
-							slice_list[slice_index].find_offset = file_offset + slide_offset;
-							block_list[block_index].state |= 8;
+						// Store position of this slice for later reading.
+						if (slide_find_add(seg, slice_index, file_offset + slide_offset, 8) != 0){
+							fclose(fp);
+							return RET_MEMORY_ERROR;
 						}
 						if (find_min > file_offset + slide_offset)
 							find_min = file_offset + slide_offset;
@@ -895,8 +1052,8 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 						}
 
 						// When CRC and BLAKE3 match, remove this item from tail_list.
-						if (find_index + 1 < tail_count)
-							memmove(tail_list + find_index, tail_list + find_index + 1, sizeof(PAR3_CMP_CTX) * (tail_count - find_index - 1));
+						// Next item may be shifted into the same position.
+						cmp_list_remove(tail_list, tail_mask, find_index);
 						tail_count--;
 						//printf("Remove item[%"PRId64"] : block[%"PRIu64"] from tail_list. tail_count = %"PRIu64"\n", find_index, block_index, tail_count);
 
@@ -904,16 +1061,35 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 						find_index++;
 					}
 
-					if (find_index == tail_count)
-						break;
-					if (tail_list[find_index].crc != crc40)
-						break;
+					find_index = cmp_list_next(tail_list, tail_mask, crc40, find_index);
 				}
 
 				temp_crc = crc40;	// Save previous CRC-64 to compare later
-				crc40 = window_mask40 ^ crc_slide_byte(window_mask40 ^ crc40,
-						work_buf[slide_offset + 40], work_buf[slide_offset], window_table40);
 				slide_offset++;
+				if (slide_offset < batch_end){
+					// Skip offsets, which are rejected by bitmap filter.
+					slide_offset = batch_start + crc_slide_scan(crc_batch, (size_t)(slide_offset - batch_start),
+							(size_t)(batch_end - batch_start), tail_filter, tail_mask);
+					if (slide_offset >= batch_end)
+						slide_offset = batch_end - 1;
+					crc40 = crc_batch[slide_offset - batch_start];
+					temp_crc = crc_batch[slide_offset - batch_start - 1];
+				} else {
+					crc40 = window_mask40 ^ crc_slide_byte(window_mask40 ^ crc40,
+							work_buf[slide_offset - 1 + 40], work_buf[slide_offset - 1], window_table40);
+
+					// Slide next range of offsets at once, till the first offset of next block.
+					batch_start = slide_offset;
+					batch_end = block_size + 1;
+					if (batch_end > file_size - file_offset - 40 + 1)
+						batch_end = file_size - file_offset - 40 + 1;
+					if (batch_end > batch_start + CRC_SLIDE_BATCH)
+						batch_end = batch_start + CRC_SLIDE_BATCH;
+					if (batch_end > batch_start + 1){
+						crc_slide_batch(work_buf + batch_start, 40, (size_t)(batch_end - batch_start),
+								crc40, crc_batch, window_mask40, window_table40);
+					}
+				}
 
 				if (hash_counter >= CHECK_SLIDE_INTERVAL){	// Check freeze after sliding several bytes each.
 					// When hashing over than 8 times in 8 KB range. (average >= 1 time / 1 KB)
@@ -947,15 +1123,20 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 		//printf("block crc = 0x%016"PRIx64", tail crc = 0x%016"PRIx64"\n", crc, crc40);
 
 		// Check range of found slices
-		if ( (find_min < file_size) && (find_min > find_last) )
-			damage_size += find_min - find_last;
+		if (find_min < file_size){
+			if (first_min == file_size){	// The first found slice in this segment
+				first_min = find_min;
+			} else if (find_min > find_last){
+				damage_size += find_min - find_last;
+			}
+		}
 		find_last = find_max;
 		//printf("file_offset = %"PRIu64", find_min = %"PRIu64", find_max %"PRIu64", damage_size = %"PRIu64"\n",
 		//		file_offset, find_min, find_max, damage_size);
 
 		// Read next block on second position.
 		file_offset += block_size;
-		if (file_offset >= file_size){
+		if (file_offset >= seg->end){
 			//printf("file_offset = %"PRIu64", file_size = %"PRIu64", EOF\n", file_offset, file_size);
 			break;
 		}
@@ -977,8 +1158,8 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 				fclose(fp);
 				return RET_FILE_IO_ERROR;
 			}
-			if (file_hash != NULL)
-				blake3_hasher_update(&hasher, work_buf + block_size, (size_t)read_size);
+			if (hasher != NULL)
+				blake3_update(hasher, work_buf + block_size, (size_t)read_size);
 		}
 
 
@@ -993,17 +1174,216 @@ int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
 		}
 	}
 
-	// Check the last damaged area in this file
-	if (find_max < file_size)
-		damage_size += file_size - find_max;
-	if (file_damage != NULL)
-		*file_damage = damage_size;
+	seg->first_min = first_min;
+	seg->last_max = find_max;
+	seg->damage_size = damage_size;
 
 	if (fclose(fp) != 0){
 		perror("Failed to close input file");
 		return RET_FILE_IO_ERROR;
 	}
 
+	return 0;
+}
+
+// Calculate hash of whole file.
+static int hash_whole_file(char *filename, uint64_t file_size, blake3_hasher *hasher)
+{
+	uint8_t *buf;
+	size_t read_size;
+	uint64_t file_offset;
+	FILE *fp;
+
+	buf = malloc(1 << 20);
+	if (buf == NULL){
+		perror("Failed to allocate memory for file hash");
+		return RET_MEMORY_ERROR;
+	}
+	fp = fopen(filename, "rb");
+	if (fp == NULL){
+		perror("Failed to open input file");
+		free(buf);
+		return RET_FILE_IO_ERROR;
+	}
+
+	for (file_offset = 0; file_offset < file_size; file_offset += read_size){
+		read_size = 1 << 20;
+		if (read_size > file_size - file_offset)
+			read_size = (size_t)(file_size - file_offset);
+		if (fread(buf, 1, read_size, fp) != read_size){
+			perror("Failed to read input file");
+			fclose(fp);
+			free(buf);
+			return RET_FILE_IO_ERROR;
+		}
+		blake3_update(hasher, buf, read_size);
+	}
+
+	free(buf);
+	if (fclose(fp) != 0){
+		perror("Failed to close input file");
+		return RET_FILE_IO_ERROR;
+	}
+
+	return 0;
+}
+
+// Search slices in a segment with own buffers.
+static void check_damaged_task(void *arg, int index)
+{
+	SLIDE_SEGMENT *seg;
+	PAR3_CTX *par3_ctx;
+	PAR3_CMP_CTX *crc_list, *tail_list;
+	uint8_t *work_buf;
+	uint64_t crc_size, tail_size;
+
+	seg = (SLIDE_SEGMENT *)arg + index;
+	if (seg->hasher != NULL){
+		seg->ret = hash_whole_file(seg->filename, seg->file_size, seg->hasher);
+		return;
+	}
+
+	par3_ctx = seg->par3_ctx;
+	crc_size = 0;
+	if (par3_ctx->crc_count > 0)
+		crc_size = par3_ctx->crc_mask + 1;
+	tail_size = 0;
+	if (par3_ctx->tail_count > 0)
+		tail_size = par3_ctx->tail_mask + 1;
+	crc_list = malloc(sizeof(PAR3_CMP_CTX) * (crc_size + tail_size) + par3_ctx->block_size * 2);
+	if (crc_list == NULL){
+		perror("Failed to allocate memory for slide search");
+		seg->ret = RET_MEMORY_ERROR;
+		return;
+	}
+	tail_list = crc_list + crc_size;
+	work_buf = (uint8_t *)(tail_list + tail_size);
+
+	seg->ret = check_damaged_segment(seg, work_buf, crc_list, tail_list, NULL);
+	free(crc_list);
+}
+
+// This checks available slices in the file.
+// This uses pointer of filename, instead of file ID.
+int check_damaged_file(PAR3_CTX *par3_ctx, char *filename,
+	uint64_t file_size, uint64_t file_offset, uint64_t *file_damage, uint8_t *file_hash)
+{
+	int ret;
+	int64_t i, j, segment_count;
+	uint64_t block_size, segment_size, damage_size, find_last, block_index;
+	PAR3_BLOCK_CTX *block_list;
+	PAR3_SLICE_CTX *slice_list;
+	PAR3_CMP_CTX *crc_list, *tail_list;
+	SLIDE_SEGMENT *seg;
+	SLIDE_FIND *find_p;
+	blake3_hasher hasher;
+
+	if (filename == NULL){
+		printf("File name is bad.\n");
+		return RET_LOGIC_ERROR;
+	}
+	if (file_offset >= file_size){
+		if (file_damage != NULL)
+			*file_damage = 0;
+		return 0;
+	}
+	if (par3_ctx->noise_level >= 1){
+		printf("current file size = %"PRIu64", start = %"PRIu64", \"%s\"\n", file_size, file_offset, filename);
+	}
+
+	// Segment size is a multiple of block size, and doesn't depend on number of threads.
+	// Then, found slices are same on any PC.
+	block_size = par3_ctx->block_size;
+	segment_size = (SLIDE_SEGMENT_SIZE + block_size - 1) / block_size * block_size;
+	segment_count = (file_size - file_offset + segment_size - 1) / segment_size;
+	if (segment_count > 0x7FFFFFFF){
+		printf("Too many segments for slide search.\n");
+		return RET_LOGIC_ERROR;
+	}
+
+	// One more item may be used to calculate file hash.
+	seg = calloc(segment_count + 1, sizeof(SLIDE_SEGMENT));
+	if (seg == NULL){
+		perror("Failed to allocate memory for slide search");
+		return RET_MEMORY_ERROR;
+	}
+	for (i = 0; i < segment_count; i++){
+		seg[i].par3_ctx = par3_ctx;
+		seg[i].filename = filename;
+		seg[i].file_size = file_size;
+		seg[i].start = file_offset + segment_size * i;
+		seg[i].end = seg[i].start + segment_size;
+		if (seg[i].end > file_size)
+			seg[i].end = file_size;
+	}
+	if (file_hash != NULL)
+		blake3_hasher_init(&hasher);
+
+	if (segment_count == 1){
+		// Allocated memory for hash index was double size.
+		crc_list = NULL;
+		if (par3_ctx->crc_count > 0)
+			crc_list = par3_ctx->crc_list + par3_ctx->crc_mask + 1;
+		tail_list = NULL;
+		if (par3_ctx->tail_count > 0)
+			tail_list = par3_ctx->tail_list + par3_ctx->tail_mask + 1;
+		ret = check_damaged_segment(seg, par3_ctx->work_buf, crc_list, tail_list,
+				(file_hash != NULL) ? &hasher : NULL);
+	} else {
+		if (file_hash != NULL){
+			seg[segment_count].filename = filename;
+			seg[segment_count].file_size = file_size;
+			seg[segment_count].hasher = &hasher;
+		}
+		thread_pool_run(check_damaged_task, seg, (int)segment_count + ((file_hash != NULL) ? 1 : 0));
+		ret = seg[segment_count].ret;
+	}
+
+	// Merge found slices in order of segments.
+	// The first found position of each block is used for later reading.
+	block_list = par3_ctx->block_list;
+	slice_list = par3_ctx->slice_list;
+	damage_size = 0;
+	find_last = file_offset;	// File data till file_offset is available.
+	for (i = 0; i < segment_count; i++){
+		if ( (ret == 0) && (seg[i].ret != 0) )
+			ret = seg[i].ret;
+		find_p = seg[i].find_list;
+		for (j = 0; (ret == 0) && (j < seg[i].find_count); j++){
+			block_index = slice_list[find_p[j].slice].block;
+			if (find_p[j].flag == 4){
+				if ((block_list[block_index].state & 4) != 0)	// When this block was found already.
+					continue;
+			} else {
+				if (slice_list[find_p[j].slice].find_name != NULL)	// When this slice was found already.
+					continue;
+			}
+			// Store filename & position of this slice for later reading.
+			slice_list[find_p[j].slice].find_name = filename;
+			slice_list[find_p[j].slice].find_offset = find_p[j].offset;
+			block_list[block_index].state |= find_p[j].flag;
+		}
+		free(find_p);
+
+		// Check range of found slices
+		if (seg[i].first_min < file_size){
+			if (seg[i].first_min > find_last)
+				damage_size += seg[i].first_min - find_last;
+			damage_size += seg[i].damage_size;
+			if (find_last < seg[i].last_max)
+				find_last = seg[i].last_max;
+		}
+	}
+	free(seg);
+	if (ret != 0)
+		return ret;
+
+	// Check the last damaged area in this file
+	if (find_last < file_size)
+		damage_size += file_size - find_last;
+	if (file_damage != NULL)
+		*file_damage = damage_size;
+
 	// Calculate file hash to compare with misnamed files.
 	if (file_hash != NULL)
 		blake3_hasher_finalize(&hasher, file_hash, 16);
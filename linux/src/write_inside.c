@@ -26,8 +26,7 @@
 int insert_space_zip(PAR3_CTX *par3_ctx, int footer_size, int repeat_count)
 {
 	uint8_t *buf_p, *common_packet, packet_header[88];
-	uint8_t gf_size;
-	int galois_poly, ret;
+	int ret;
 	uint64_t block_count, block_index;
 	uint64_t each_count, each_max;
 	size_t block_size, region_size;
@@ -39,8 +38,6 @@ int insert_space_zip(PAR3_CTX *par3_ctx, int footer_size, int repeat_count)
 
 	block_count = par3_ctx->recovery_block_count;
 	block_size = par3_ctx->block_size;
-	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	common_packet = par3_ctx->common_packet;
 	common_packet_size = par3_ctx->common_packet_size;
 	region_size = (block_size + 4 + 3) & ~3;
@@ -105,24 +102,17 @@ int insert_space_zip(PAR3_CTX *par3_ctx, int footer_size, int repeat_count)
 
 		// When there is enough memory to keep all recovery blocks, recovery blocks were created already.
 		if (par3_ctx->ecc_method & 0x8000){
+			// Calculate checksum of packet here.
+			blake3_hasher_init(&hasher);
+			blake3_hasher_update(&hasher, packet_header + 24, 24 + 40);
+
 			// Check parity of recovery block to confirm that calculation was correct.
-			if (gf_size == 2){
-				ret = gf16_region_check_parity(galois_poly, buf_p, region_size);
-			} else if (gf_size == 1){
-				ret = gf8_region_check_parity(galois_poly, buf_p, region_size);
-			} else {
-				ret = region_check_parity(buf_p, region_size);
-			}
+			ret = region_check_parity_hash(par3_ctx, buf_p, region_size, block_size, NULL, &hasher);
 			if (ret != 0){
 				printf("Parity of recovery block[%"PRIu64"] is different.\n", block_index);
 				fclose(fp);
 				return RET_LOGIC_ERROR;
 			}
-
-			// Calculate checksum of packet here.
-			blake3_hasher_init(&hasher);
-			blake3_hasher_update(&hasher, packet_header + 24, 24 + 40);
-			blake3_hasher_update(&hasher, buf_p, block_size);
 			blake3_hasher_finalize(&hasher, packet_header + 8, 16);
 
 			// Write packet header and recovery data on file.
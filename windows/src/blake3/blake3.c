@@ -561,6 +561,108 @@ void blake3_hasher_update(blake3_hasher *self, const void *input,
   }
 }
 
+// Extension for par3cmdline: hash complete subtrees on threads.
+//
+// Subtrees of the same power-of-2 size are compressed independently, and their
+// chaining values are pushed onto the stack in order, just as update() would
+// do after merging. None of them can be the root, because there are always at
+// least two of them in the whole input. So the result is the same as
+// blake3_hasher_update() on any number of threads.
+#define PARALLEL_MIN_SUBTREE_LEN (1 << 18)
+#define PARALLEL_MAX_TASKS 256
+
+typedef struct {
+  const uint8_t *input;
+  size_t subtree_len;
+  const uint32_t *key;
+  uint64_t chunk_counter;
+  uint8_t flags;
+  uint8_t cvs[PARALLEL_MAX_TASKS * BLAKE3_OUT_LEN];
+} parallel_subtrees;
+
+static void parallel_subtree_task(void *arg, int index) {
+  parallel_subtrees *job = (parallel_subtrees *)arg;
+  uint64_t subtree_chunks = job->subtree_len / BLAKE3_CHUNK_LEN;
+  uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+  compress_subtree_to_parent_node(
+      job->input + job->subtree_len * (size_t)index, job->subtree_len,
+      job->key, job->chunk_counter + subtree_chunks * (uint64_t)index,
+      job->flags, cv_pair);
+  output_t output = parent_output(cv_pair, job->key, job->flags);
+  output_chaining_value(&output, &job->cvs[BLAKE3_OUT_LEN * index]);
+}
+
+void blake3_hasher_update_parallel(
+    blake3_hasher *self, const void *input, size_t input_len,
+    void (*run_tasks)(void (*func)(void *arg, int index), void *arg, int count),
+    int max_tasks) {
+  const uint8_t *input_bytes = (const uint8_t *)input;
+
+  if (max_tasks > PARALLEL_MAX_TASKS) {
+    max_tasks = PARALLEL_MAX_TASKS;
+  }
+  if (max_tasks < 2 || input_len / 2 < PARALLEL_MIN_SUBTREE_LEN) {
+    blake3_hasher_update(self, input, input_len);
+    return;
+  }
+
+  // Each task hashes a subtree of 2^n chunks.
+  size_t subtree_len = round_down_to_power_of_2(input_len / (size_t)max_tasks);
+  if (subtree_len < PARALLEL_MIN_SUBTREE_LEN) {
+    subtree_len = PARALLEL_MIN_SUBTREE_LEN;
+  }
+
+  // The first subtree must start at a multiple of its size.
+  uint64_t count_so_far = self->chunk.chunk_counter * BLAKE3_CHUNK_LEN +
+                          chunk_state_len(&self->chunk);
+  size_t head_len =
+      (size_t)((subtree_len - (count_so_far & (subtree_len - 1))) &
+               (subtree_len - 1));
+  if (input_len - head_len < 2 * subtree_len) {
+    blake3_hasher_update(self, input, input_len);
+    return;
+  }
+  if (head_len > 0) {
+    blake3_hasher_update(self, input_bytes, head_len);
+    input_bytes += head_len;
+    input_len -= head_len;
+  }
+
+  // update() keeps the last full chunk until more input comes.
+  if (chunk_state_len(&self->chunk) == BLAKE3_CHUNK_LEN) {
+    output_t output = chunk_state_output(&self->chunk);
+    uint8_t chunk_cv[BLAKE3_OUT_LEN];
+    output_chaining_value(&output, chunk_cv);
+    hasher_push_cv(self, chunk_cv, self->chunk.chunk_counter);
+    chunk_state_reset(&self->chunk, self->key, self->chunk.chunk_counter + 1);
+  }
+
+  parallel_subtrees job;
+  job.subtree_len = subtree_len;
+  job.key = self->key;
+  job.flags = self->chunk.flags;
+  uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+  while (input_len >= 2 * subtree_len) {
+    size_t count = input_len / subtree_len;
+    if (count > PARALLEL_MAX_TASKS) {
+      count = PARALLEL_MAX_TASKS;
+    }
+    job.input = input_bytes;
+    job.chunk_counter = self->chunk.chunk_counter;
+    run_tasks(parallel_subtree_task, &job, (int)count);
+
+    for (size_t i = 0; i < count; i++) {
+      hasher_push_cv(self, &job.cvs[BLAKE3_OUT_LEN * i],
+                     self->chunk.chunk_counter);
+      self->chunk.chunk_counter += subtree_chunks;
+    }
+    input_bytes += subtree_len * count;
+    input_len -= subtree_len * count;
+  }
+
+  blake3_hasher_update(self, input_bytes, input_len);
+}
+
 void blake3_hasher_finalize(const blake3_hasher *self, uint8_t *out,
                             size_t out_len) {
   blake3_hasher_finalize_seek(self, 0, out, out_len);
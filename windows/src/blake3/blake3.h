@@ -53,6 +53,14 @@ void blake3_hasher_finalize_seek(const blake3_hasher *self, uint64_t seek,
                                  uint8_t *out, size_t out_len);
 void blake3_hasher_reset(blake3_hasher *self);
 
+// Extension for par3cmdline: same as blake3_hasher_update(), but large input
+// is split into subtrees, which are hashed by run_tasks(func, arg, count).
+// It must call func(arg, index) for index = 0 ~ count - 1 in any order.
+void blake3_hasher_update_parallel(
+    blake3_hasher *self, const void *input, size_t input_len,
+    void (*run_tasks)(void (*func)(void *arg, int index), void *arg, int count),
+    int max_tasks);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,8 +56,7 @@ int recover_lost_block(PAR3_CTX *par3_ctx, char *temp_path, int lost_count)
 	char *name_prev, *file_name;
 	uint8_t *work_buf, buf_tail[40];
 	uint8_t *block_data;
-	uint8_t gf_size;
-	int galois_poly, *lost_id, *recv_id;
+	int *lost_id, *recv_id;
 	int block_count, block_index;
 	int lost_index, ret;
 	int progress_old, progress_now, progress_step;
@@ -83,8 +82,6 @@ int recover_lost_block(PAR3_CTX *par3_ctx, char *temp_path, int lost_count)
 	file_count = par3_ctx->input_file_count;
 	block_size = par3_ctx->block_size;
 	block_count = (int)(par3_ctx->block_count);
-	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	gf_table = par3_ctx->galois_table;
 	matrix = par3_ctx->matrix;
 	recv_id = par3_ctx->recv_id_list;
@@ -302,13 +299,7 @@ int recover_lost_block(PAR3_CTX *par3_ctx, char *temp_path, int lost_count)
 			}
 
 			// Calculate parity bytes in the region
-			if (gf_size == 2){
-				gf16_region_create_parity(galois_poly, work_buf, region_size);
-			} else if (gf_size == 1){
-				gf8_region_create_parity(galois_poly, work_buf, region_size);
-			} else {
-				region_create_parity(work_buf, region_size);
-			}
+			region_create_parity_crc(par3_ctx, work_buf, region_size, 0, 0);
 
 			// Recover (multiple & add to) lost input blocks
 			rs_recover_one_all(par3_ctx, block_index, lost_count);
@@ -388,13 +379,7 @@ int recover_lost_block(PAR3_CTX *par3_ctx, char *temp_path, int lost_count)
 		memset(work_buf + block_size, 0, region_size - block_size);
 
 		// Calculate parity bytes in the region
-		if (gf_size == 2){
-			gf16_region_create_parity(galois_poly, work_buf, region_size);
-		} else if (gf_size == 1){
-			gf8_region_create_parity(galois_poly, work_buf, region_size);
-		} else {
-			region_create_parity(work_buf, region_size);
-		}
+		region_create_parity_crc(par3_ctx, work_buf, region_size, 0, 0);
 
 		// Recover (multiple & add to) lost input blocks
 		rs_recover_one_all(par3_ctx, lost_id[lost_index], lost_count);
@@ -433,13 +418,7 @@ int recover_lost_block(PAR3_CTX *par3_ctx, char *temp_path, int lost_count)
 		work_buf = block_data + region_size * lost_index;
 
 		// Check parity of recovered block to confirm that calculation was correct.
-		if (gf_size == 2){
-			ret = gf16_region_check_parity(galois_poly, work_buf, region_size);
-		} else if (gf_size == 1){
-			ret = gf8_region_check_parity(galois_poly, work_buf, region_size);
-		} else {
-			ret = region_check_parity(work_buf, region_size);
-		}
+		ret = region_check_parity_hash(par3_ctx, work_buf, region_size, 0, NULL, NULL);
 		if (ret != 0){
 			printf("Parity of recovered block[%d] is different.\n", block_index);
 			if (fp_write != NULL)
@@ -626,7 +605,7 @@ int recover_lost_block_split(PAR3_CTX *par3_ctx, char *temp_path, uint64_t lost_
 	uint8_t buf_tail[40];
 	uint8_t *block_data, *buf_p;
 	uint8_t gf_size;
-	int galois_poly, *recv_id;
+	int *recv_id;
 	int ret;
 	int progress_old, progress_now;
 	uint32_t split_count;
@@ -660,7 +639,6 @@ int recover_lost_block_split(PAR3_CTX *par3_ctx, char *temp_path, uint64_t lost_
 	block_count = par3_ctx->block_count;
 	max_recovery_block = par3_ctx->max_recovery_block;
 	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	gf_table = par3_ctx->galois_table;
 	matrix = par3_ctx->matrix;
 	recv_id = par3_ctx->recv_id_list;
@@ -921,22 +899,8 @@ int recover_lost_block_split(PAR3_CTX *par3_ctx, char *temp_path, uint64_t lost_
 				memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
 				// No need to calculate CRC of reading block, because it will check recovered block later.
 
-				if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
-					if (gf_size == 2){
-						leo_region_create_parity(buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
-				} else {
-					// Calculate parity bytes in the region
-					if (gf_size == 2){
-						gf16_region_create_parity(galois_poly, buf_p, region_size);
-					} else if (gf_size == 1){
-						gf8_region_create_parity(galois_poly, buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
-				}
+				// Calculate parity bytes in the region
+				region_create_parity_crc(par3_ctx, buf_p, region_size, 0, 0);
 			}
 
 			// Print progress percent
@@ -1009,23 +973,8 @@ int recover_lost_block_split(PAR3_CTX *par3_ctx, char *temp_path, uint64_t lost_
 			}
 			memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
 
-			if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
-				// Because GF Multiplication doesn't work on FFT, it does XOR only.
-				if (gf_size == 2){
-					leo_region_create_parity(buf_p, region_size);
-				} else {
-					region_create_parity(buf_p, region_size);
-				}
-			} else {
-				// Calculate parity bytes in the region
-				if (gf_size == 2){
-					gf16_region_create_parity(galois_poly, buf_p, region_size);
-				} else if (gf_size == 1){
-					gf8_region_create_parity(galois_poly, buf_p, region_size);
-				} else {
-					region_create_parity(buf_p, region_size);
-				}
-			}
+			// Calculate parity bytes in the region
+			region_create_parity_crc(par3_ctx, buf_p, region_size, 0, 0);
 
 			// Print progress percent
 			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
@@ -1070,7 +1019,7 @@ if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
 			rs_recover_all(par3_ctx, region_size, (int)lost_count, progress_total, progress_step);
 
 		} else if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
-			ret = leo_decode(region_size,
+			ret = rs_leo_decode(par3_ctx, region_size,
 							(uint32_t)block_count, (uint32_t)max_recovery_block, work_count,
 							original_data, recovery_data, work_data);
 			if (ret != 0){
@@ -1098,21 +1047,7 @@ if (par3_ctx->ecc_method & 8){	// FFT based Reed-Solomon Codes
 		for (block_index = 0; block_index < block_count; block_index++){
 			if ((block_list[block_index].state & (4 | 16)) == 0){	// This input block was not complete.
 				// Check parity of recovered block to confirm that calculation was correct.
-				if (par3_ctx->ecc_method & 8){
-					if (gf_size == 2){
-						ret = leo_region_check_parity(buf_p, region_size);
-					} else {
-						ret = region_check_parity(buf_p, region_size);
-					}
-				} else {
-					if (gf_size == 2){
-						ret = gf16_region_check_parity(galois_poly, buf_p, region_size);
-					} else if (gf_size == 1){
-						ret = gf8_region_check_parity(galois_poly, buf_p, region_size);
-					} else {
-						ret = region_check_parity(buf_p, region_size);
-					}
-				}
+				ret = region_check_parity_hash(par3_ctx, buf_p, region_size, 0, NULL, NULL);
 				if (ret != 0){
 					printf("Parity of recovered block[%"PRIu64"] is different.\n", block_index);
 					return RET_LOGIC_ERROR;
@@ -1341,7 +1276,6 @@ int recover_lost_block_cohort(PAR3_CTX *par3_ctx, char *temp_path)
 	uint8_t *block_data, *buf_p;
 	uint8_t gf_size;
 	uint8_t *packet_checksum;
-	int galois_poly;
 	int ret;
 	int progress_old, progress_now;
 	uint32_t split_count;
@@ -1378,7 +1312,6 @@ int recover_lost_block_cohort(PAR3_CTX *par3_ctx, char *temp_path)
 	block_size = par3_ctx->block_size;
 	block_count = par3_ctx->block_count;
 	gf_size = par3_ctx->gf_size;
-	galois_poly = par3_ctx->galois_poly;
 	gf_table = par3_ctx->galois_table;
 	matrix = par3_ctx->matrix;
 	lost_id = par3_ctx->recv_id_list;
@@ -1766,11 +1699,8 @@ int recover_lost_block_cohort(PAR3_CTX *par3_ctx, char *temp_path)
 					memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
 					// No need to calculate CRC of reading block, because it will check recovered block later.
 
-					if (gf_size == 2){
-						leo_region_create_parity(buf_p, region_size);
-					} else {
-						region_create_parity(buf_p, region_size);
-					}
+					// Calculate parity bytes in the region
+					region_create_parity_crc(par3_ctx, buf_p, region_size, 0, 0);
 				}
 
 				// Print progress percent
@@ -1857,11 +1787,8 @@ int recover_lost_block_cohort(PAR3_CTX *par3_ctx, char *temp_path)
 				}
 				memset(buf_p + part_size, 0, region_size - part_size);	// Zero fill rest bytes
 
-				if (gf_size == 2){
-					leo_region_create_parity(buf_p, region_size);
-				} else {
-					region_create_parity(buf_p, region_size);
-				}
+				// Calculate parity bytes in the region
+				region_create_parity_crc(par3_ctx, buf_p, region_size, 0, 0);
 
 				// Print progress percent
 				if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
@@ -1913,7 +1840,7 @@ fclose(fp2);
 */
 
 			// Recover lost input blocks
-			ret = leo_decode(region_size,
+			ret = rs_leo_decode(par3_ctx, region_size,
 							(uint32_t)block_count2, (uint32_t)max_recovery_block2, work_count,
 							original_data, recovery_data, work_data);
 			if (ret != 0){
@@ -1951,11 +1878,7 @@ printf("\n recover ok, progress = %"PRIu64" / %"PRIu64"\n", progress_step, progr
 			for (block_index = cohort_index; block_index < block_count; block_index += cohort_count){
 				if ((block_list[block_index].state & (4 | 16)) == 0){	// This input block was not complete.
 					// Check parity of recovered block to confirm that calculation was correct.
-					if (gf_size == 2){
-						ret = leo_region_check_parity(buf_p, region_size);
-					} else {
-						ret = region_check_parity(buf_p, region_size);
-					}
+					ret = region_check_parity_hash(par3_ctx, buf_p, region_size, 0, NULL, NULL);
 					if (ret != 0){
 						printf("Parity of recovered block[%"PRIu64"] is different.\n", block_index);
 						return RET_LOGIC_ERROR;
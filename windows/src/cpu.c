@@ -0,0 +1,136 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cpu.h"
+
+#ifdef CPU_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+static void cpuid(uint32_t out[4], uint32_t id, uint32_t sid)
+{
+#ifdef _MSC_VER
+	__cpuidex((int *)out, id, sid);
+#elif defined(__i386__)
+	__asm__ __volatile__("movl %%ebx, %1\n"
+						"cpuid\n"
+						"xchgl %1, %%ebx\n"
+						: "=a"(out[0]), "=r"(out[1]), "=c"(out[2]), "=d"(out[3])
+						: "a"(id), "c"(sid));
+#else
+	__asm__ __volatile__("cpuid\n"
+						: "=a"(out[0]), "=b"(out[1]), "=c"(out[2]), "=d"(out[3])
+						: "a"(id), "c"(sid));
+#endif
+}
+
+// Registers enabled by OS
+static uint64_t xgetbv(void)
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ __volatile__("xgetbv\n" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static int cpu_detect(void)
+{
+	uint32_t regs[4];
+	uint64_t mask;
+	int flag = 0;
+
+	cpuid(regs, 0, 0);
+	if (regs[0] < 1)
+		return 0;
+	cpuid(regs, 1, 0);
+	if (regs[2] & (1 << 9))
+		flag |= CPU_SSSE3;
+	if ( (regs[2] & (1 << 1)) && (regs[2] & (1 << 19)) )	// PCLMULQDQ and SSE4.1
+		flag |= CPU_PCLMUL;
+
+	// AVX2 and AVX-512 require OS support of YMM and ZMM registers.
+	if ( ((regs[2] & (1 << 27)) == 0) || ((regs[2] & (1 << 28)) == 0) )
+		return flag;
+	mask = xgetbv();
+	if ((mask & 6) != 6)
+		return flag;
+
+	cpuid(regs, 0, 0);
+	if (regs[0] < 7)
+		return flag;
+	cpuid(regs, 7, 0);
+	if (regs[1] & (1 << 5))
+		flag |= CPU_AVX2;
+	if ( ((mask & 0xE0) == 0xE0) && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) )	// AVX512F and AVX512BW
+		flag |= CPU_AVX512BW;
+
+	return flag;
+}
+
+#else
+
+static int cpu_detect(void)
+{
+	return 0;
+}
+
+#endif
+
+static int cpu_flag = -1;
+
+// Return supported features, which are checked only once.
+int cpu_feature(void)
+{
+	if (cpu_flag < 0)
+		cpu_flag = cpu_detect();
+
+	return cpu_flag;
+}
+
+// Stop using some features, when their kernels don't work.
+void cpu_feature_disable(int flag)
+{
+	cpu_flag = cpu_feature() & ~flag;
+}
+
+// Return names of selected kernels.
+const char * cpu_feature_name(void)
+{
+	static char text[64];
+	int flag;
+	char *gf, *leo, *crc;
+
+	flag = cpu_feature();
+	if (flag & CPU_AVX512BW){
+		gf = "AVX-512BW";
+	} else if (flag & CPU_AVX2){
+		gf = "AVX2";
+	} else if (flag & CPU_SSSE3){
+		gf = "SSSE3";
+	} else {
+		gf = "scalar";
+	}
+
+	// Leopard-RS supports AVX2 at most.
+	if (flag & CPU_AVX2){
+		leo = "AVX2";
+	} else if (flag & CPU_SSSE3){
+		leo = "SSSE3";
+	} else {
+		leo = "scalar";
+	}
+
+	if (flag & CPU_PCLMUL){
+		crc = "PCLMULQDQ";
+	} else {
+		crc = "scalar";
+	}
+
+	snprintf(text, sizeof(text), "GF = %s, Leopard = %s, CRC = %s", gf, leo, crc);
+	return text;
+}
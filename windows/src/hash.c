@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,7 +8,10 @@
 
 #include "blake3/blake3.h"
 #include "libpar3.h"
+#include "cpu.h"
+#include "galois.h"
 #include "hash.h"
+#include "thread.h"
 
 
 /*
@@ -43,12 +47,11 @@ Fast CRCs are from;
 */
 
 // Fast CRC function, which calculates 4 bytes per loop.
-uint64_t crc64(const uint8_t *buf, size_t size, uint64_t crc)
+// This updates CRC-64 without bit flipping.
+static uint64_t crc64_update(const uint8_t *buf, size_t size, uint64_t crc)
 {
 	uint64_t A;
 
-	crc = ~crc;	// bit flipping at first
-
 	// calculate each byte until 4-bytes alignment
 	while ((size > 0) && (((size_t)buf) & 3)){
 		A = crc ^ (*buf++);
@@ -79,37 +82,186 @@ uint64_t crc64(const uint8_t *buf, size_t size, uint64_t crc)
 		size--;
 	}
 
-	return ~crc;	// bit flipping again
+	return crc;
 }
 
-// This updates CRC-64 of zeros without bit flipping.
-static uint64_t crc64_update_zero(size_t size, uint64_t crc)
+/*
+Folding by carry-less multiplication is from;
+[2] Vinodh Gopal, Erdinc Ozturk, et al., Fast CRC Computation for Generic
+Polynomials Using PCLMULQDQ Instruction, Intel, December 2009.
+
+Input is folded to 128-bit, and the remainder is reduced by the scalar function.
+Because bits are reflected, each constant is "x^(n-1) mod P" (bit reversed),
+and the product is shifted by 1 bit.
+*/
+#ifdef CPU_X86
+#define CRC64_SIMD
+#include <immintrin.h>
+
+// Fold 128-bit value by distance of "k".
+static TARGET_PCLMUL __m128i crc64_fold(__m128i a, __m128i k)
 {
-	uint64_t A;
+	return _mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x00), _mm_clmulepi64_si128(a, k, 0x11));
+}
 
-	// calculate 4-bytes per loop
-	while (size >= 4){
-		A = crc << 32;
+// Return number of processed bytes. It processes 64 bytes per loop.
+static TARGET_PCLMUL size_t crc64_pclmul(const uint8_t *buf, size_t size, uint64_t *crc)
+{
+	__m128i x0, x1, x2, x3, k128, k256, k384, k512;
+	uint8_t buf_tail[16];
+	size_t i;
 
-		// Below is same as this line;
-		// crc = (crc >> 32) ^ A ^ (A >> 1) ^ (A >> 3) ^ (A >> 4);
-		A = A ^ (A >> 1);
-		crc = (crc >> 32) ^ A ^ (A >> 3);
+	if (size < 64)
+		return 0;
 
-		size -= 4;
+	// Low 64-bit is "x^(n+63) mod P" for the first half, and high 64-bit is "x^(n-1) mod P".
+	k128 = _mm_set_epi64x(0xF500000000000001, 0x6B70000000000001);
+	k256 = _mm_set_epi64x(0xA011000000000001, 0x1B1AB00000000001);
+	k384 = _mm_set_epi64x(0xE145150000000001, 0x76DB6C7000000001);
+	k512 = _mm_set_epi64x(0xB100010100000001, 0x01B001B1B0000001);
+
+	// CRC is added to the first 8 bytes.
+	x0 = _mm_xor_si128(_mm_loadu_si128((__m128i *)buf), _mm_set_epi64x(0, (long long)(*crc)));
+	x1 = _mm_loadu_si128((__m128i *)(buf + 16));
+	x2 = _mm_loadu_si128((__m128i *)(buf + 32));
+	x3 = _mm_loadu_si128((__m128i *)(buf + 48));
+	for (i = 64; i + 64 <= size; i += 64){
+		x0 = _mm_xor_si128(crc64_fold(x0, k512), _mm_loadu_si128((__m128i *)(buf + i)));
+		x1 = _mm_xor_si128(crc64_fold(x1, k512), _mm_loadu_si128((__m128i *)(buf + i + 16)));
+		x2 = _mm_xor_si128(crc64_fold(x2, k512), _mm_loadu_si128((__m128i *)(buf + i + 32)));
+		x3 = _mm_xor_si128(crc64_fold(x3, k512), _mm_loadu_si128((__m128i *)(buf + i + 48)));
 	}
 
-	while (size > 0){
-		A = crc << 56;
-		crc = (crc >> 8) ^ A ^ (A >> 1) ^ (A >> 3) ^ (A >> 4);
-		size--;
+	// Fold 4 values into one.
+	x3 = _mm_xor_si128(x3, crc64_fold(x0, k384));
+	x3 = _mm_xor_si128(x3, crc64_fold(x1, k256));
+	x3 = _mm_xor_si128(x3, crc64_fold(x2, k128));
+	for (; i + 16 <= size; i += 16){
+		x3 = _mm_xor_si128(crc64_fold(x3, k128), _mm_loadu_si128((__m128i *)(buf + i)));
 	}
 
-	return crc;
+	// Reduce the last 128-bit.
+	_mm_storeu_si128((__m128i *)buf_tail, x3);
+	*crc = crc64_update(buf_tail, 16, 0);
+
+	return i;
+}
+
+// Compare result of SIMD version to scalar version.
+// It returns 1 for SIMD, and -1 for scalar.
+static int crc64_self_test(void)
+{
+	uint8_t buf[1024 + 16];
+	uint64_t crc, crc_simd;
+	size_t i, offset, size;
+
+	if ((cpu_feature() & CPU_PCLMUL) == 0)
+		return -1;
+
+	crc = 1;
+	for (i = 0; i < sizeof(buf); i++){
+		crc = crc * 6364136223846793005 + 1442695040888963407;
+		buf[i] = (uint8_t)(crc >> 56);
+	}
+
+	for (offset = 0; offset < 16; offset += 5){
+		for (size = 64; size <= 1024; size += 61){
+			crc = crc64_update(buf + offset, size, ~(uint64_t)size);
+			crc_simd = ~(uint64_t)size;
+			i = crc64_pclmul(buf + offset, size, &crc_simd);
+			crc_simd = crc64_update(buf + offset + i, size - i, crc_simd);
+			if (crc_simd != crc){
+				printf("CRC-64 kernel (PCLMULQDQ) failed self-test, using scalar.\n");
+				cpu_feature_disable(CPU_PCLMUL);
+				return -1;
+			}
+		}
+	}
+
+	return 1;
+}
+
+// 0 = not tested yet, 1 = SIMD, -1 = scalar
+static int crc64_kernel = 0;
+#endif
+
+// CRC-64-ISO
+uint64_t crc64(const uint8_t *buf, size_t size, uint64_t crc)
+{
+	crc = ~crc;	// bit flipping at first
+
+#ifdef CRC64_SIMD
+	if (size >= 128){
+		size_t i;
+
+		if (crc64_kernel == 0)
+			crc64_kernel = crc64_self_test();
+		if (crc64_kernel > 0){
+			i = crc64_pclmul(buf, size, &crc);
+			buf += i;
+			size -= i;
+		}
+	}
+#endif
+	crc = crc64_update(buf, size, crc);
+
+	return ~crc;	// bit flipping again
+}
+
+/*
+Adding zeros to CRC is multiplication by "x^(8n) mod P".
+This is same method as crc32_combine() in zlib.
+Because bits are reflected, x^0 is the highest bit, and x^1 is next.
+*/
+
+// Return "a * b mod P".
+static uint64_t crc64_multiply(uint64_t a, uint64_t b)
+{
+	uint64_t m, p;
+
+	p = 0;
+	for (m = (uint64_t)1 << 63; m != 0; m >>= 1){
+		if (a & m){
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		// b = b * x mod P
+		if (b & 1){
+			b = (b >> 1) ^ 0xD800000000000000;
+		} else {
+			b >>= 1;
+		}
+	}
+
+	return p;
+}
+
+// Return "x^(8n) mod P" by square-and-multiply.
+static uint64_t crc64_x8n(uint64_t n)
+{
+	uint64_t p, s;
+
+	p = (uint64_t)1 << 63;	// x^0
+	s = (uint64_t)1 << 55;	// x^8
+	while (n > 0){
+		if (n & 1)
+			p = crc64_multiply(s, p);
+		s = crc64_multiply(s, s);
+		n >>= 1;
+	}
+
+	return p;
+}
+
+// This updates CRC-64 of zeros without bit flipping.
+static uint64_t crc64_update_zero(uint64_t size, uint64_t crc)
+{
+	return crc64_multiply(crc, crc64_x8n(size));
 }
 
 // Updates CRC-64 with zeros
-uint64_t crc64_zero(size_t size, uint64_t crc)
+uint64_t crc64_zero(uint64_t size, uint64_t crc)
 {
 	crc = ~crc;	// bit flipping at first
 
@@ -118,11 +270,21 @@ uint64_t crc64_zero(size_t size, uint64_t crc)
 	return ~crc;	// bit flipping again
 }
 
+// Return CRC-64 of joined data (A + B) from CRC-64 of each data.
+// Data A and B can be calculated independently.
+uint64_t crc64_combine(uint64_t crc_a, uint64_t crc_b, uint64_t size_b)
+{
+	return crc64_multiply(crc_a, crc64_x8n(size_b)) ^ crc_b;
+}
+
 // This return window_mask.
 static uint64_t init_slide_window(uint64_t window_size, uint64_t window_table[256])
 {
 	int i;
-	uint64_t rr, window_mask;
+	uint64_t rr, window_mask, window_x8n;
+
+	// Multiplier to slide over the window
+	window_x8n = crc64_x8n(window_size);
 
 	window_table[0] = 0; // This is always 0.
 	for (i = 1; i < 256; i++){
@@ -130,10 +292,10 @@ static uint64_t init_slide_window(uint64_t window_size, uint64_t window_table[25
 		rr = i;
 		rr = rr << 56;
 		rr = rr ^ (rr >> 1) ^ (rr >> 3) ^ (rr >> 4);
-		window_table[i] = crc64_update_zero(window_size, rr);
+		window_table[i] = crc64_multiply(rr, window_x8n);
 	}
 
-	window_mask = crc64_update_zero(window_size, ~0) ^ (~0);
+	window_mask = crc64_multiply(~0, window_x8n) ^ (~0);
 	//printf("window_mask = 0x%016I64X, 0x%016I64X\n", window_mask, rr);
 
 	return window_mask;
@@ -166,21 +328,217 @@ uint64_t crc_slide_byte(uint64_t crc, uint8_t byteNew, uint8_t byteOld, uint64_t
 	return crc ^ window_table[byteOld];
 }
 
+// Calculate CRC-64 of sliding windows at "count" offsets at once.
+// crc_list[i] = CRC-64 of buf[i] ~ buf[i + window_size - 1], and crc is CRC-64 at offset 0.
+// Sliding a window is a serial chain of shifts, so it's split into 4 independent lanes.
+// Each lane starts from CRC-64 of the window at its offset, which is derived from
+// the first window by: crc(B + N) = crc(A + B + N) ^ crc(A) * x^(8 * window_size)
+void crc_slide_batch(const uint8_t *buf, uint64_t window_size, size_t count, uint64_t crc,
+		uint64_t *crc_list, uint64_t window_mask, uint64_t window_table[256])
+{
+	size_t i, lane_size, offset;
+	uint64_t c0, c1, c2, c3, window_x8n;
+
+	// Short range isn't worth to split.
+	lane_size = count / 4;
+	if (lane_size < 64){
+		for (i = 0; i + 1 < count; i++){
+			crc_list[i] = crc;
+			crc = window_mask ^ crc_slide_byte(window_mask ^ crc, buf[i + window_size], buf[i], window_table);
+		}
+		if (count > 0)
+			crc_list[i] = crc;
+		return;
+	}
+
+	// Set CRC-64 at starting offset of each lane.
+	window_x8n = 0;
+	if (lane_size * 2 < window_size)
+		window_x8n = crc64_x8n(window_size);
+	c0 = crc;
+	for (i = 1; i < 4; i++){
+		offset = lane_size * i;
+		if (offset * 2 < window_size){
+			crc = crc64(buf + window_size, offset, c0);
+			crc ^= crc64_multiply(crc64(buf, offset, 0), window_x8n);
+		} else {	// When the window is small, calculating directly is faster.
+			crc = crc64(buf + offset, (size_t)window_size, 0);
+		}
+		if (i == 1){
+			c1 = crc;
+		} else if (i == 2){
+			c2 = crc;
+		} else {
+			c3 = crc;
+		}
+	}
 
-// Compare CRC-64 values
-static int compare_crc( const void *arg1, const void *arg2 )
+	c0 ^= window_mask;
+	c1 ^= window_mask;
+	c2 ^= window_mask;
+	c3 ^= window_mask;
+	for (i = 0; ; i++){
+		crc_list[i] = window_mask ^ c0;
+		crc_list[lane_size + i] = window_mask ^ c1;
+		crc_list[lane_size * 2 + i] = window_mask ^ c2;
+		crc_list[lane_size * 3 + i] = window_mask ^ c3;
+		if (i + 1 == lane_size)
+			break;
+		c0 = crc_slide_byte(c0, buf[i + window_size], buf[i], window_table);
+		c1 = crc_slide_byte(c1, buf[lane_size + i + window_size], buf[lane_size + i], window_table);
+		c2 = crc_slide_byte(c2, buf[lane_size * 2 + i + window_size], buf[lane_size * 2 + i], window_table);
+		c3 = crc_slide_byte(c3, buf[lane_size * 3 + i + window_size], buf[lane_size * 3 + i], window_table);
+	}
+
+	// The last lane continues till the end.
+	for (offset = lane_size * 4 - 1; offset + 1 < count; offset++){
+		c3 = crc_slide_byte(c3, buf[offset + window_size], buf[offset], window_table);
+		crc_list[offset + 1] = window_mask ^ c3;
+	}
+}
+
+// Return the first candidate offset in CRC-64 of sliding windows, from "offset" till "count".
+// Candidate may be in the hash index, or is same as previous CRC-64 (uniform data).
+// When there is no candidate, return "count".
+size_t crc_slide_scan(const uint64_t *crc_list, size_t offset, size_t count, const uint64_t *filter, uint64_t mask)
 {
-	PAR3_CMP_CTX *cmp1_p, *cmp2_p;
+	uint64_t crc;
 
-	cmp1_p = ( PAR3_CMP_CTX * ) arg1;
-	cmp2_p = ( PAR3_CMP_CTX * ) arg2;
+	while (offset < count){
+		crc = crc_list[offset];
+		if (CMP_FILTER_TEST(filter, mask, crc) != 0)
+			break;
+		if ( (offset > 0) && (crc == crc_list[offset - 1]) )
+			break;
+		offset++;
+	}
 
-	if (cmp1_p->crc < cmp2_p->crc)
-		return -1;
-	if (cmp1_p->crc > cmp2_p->crc)
-		return 1;
+	return offset;
+}
 
-	return 0;
+
+/*
+Hash index of CRC-64 for blocks and chunk tails
+
+It's open addressing with linear probing. Items of same CRC-64 are stored
+in a run of slots from the home position, and the run ends at an empty slot.
+Because table size is at least double of items, there is always an empty slot.
+
+A bitmap filter is put in front of the hash index. It has 16 bits per slot
+(32 bits per item at least), and rejects most CRC-64 of slide search by
+testing one bit. The bitmap fits in cache, while the table may not.
+Removed items keep their bits, because the filter is only a hint.
+*/
+
+// Return table size for the number of items.
+uint64_t cmp_list_size(uint64_t count)
+{
+	uint64_t size;
+
+	size = 16;
+	while (size < count * 2)
+		size *= 2;
+
+	return size;
+}
+
+// Make all slots empty.
+void cmp_list_clear(PAR3_CMP_CTX *cmp_list, uint64_t size)
+{
+	uint64_t i;
+
+	for (i = 0; i < size; i++)
+		cmp_list[i].index = CMP_LIST_EMPTY;
+}
+
+// Home position of CRC-64
+static uint64_t cmp_list_home(uint64_t crc, uint64_t mask)
+{
+	return (crc ^ (crc >> 32)) & mask;
+}
+
+// Add new item.
+void cmp_list_add(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, uint64_t index)
+{
+	uint64_t i;
+
+	i = cmp_list_home(crc, mask);
+	while (cmp_list[i].index != CMP_LIST_EMPTY)
+		i = (i + 1) & mask;
+
+	cmp_list[i].crc = crc;
+	cmp_list[i].index = index;
+}
+
+// Set bit of CRC-64 in bitmap filter.
+void cmp_filter_add(uint64_t *filter, uint64_t mask, uint64_t crc)
+{
+	crc &= CMP_FILTER_MASK(mask);
+	filter[crc >> 6] |= (uint64_t)1 << (crc & 63);
+}
+
+// Return position of the next item, which has the same CRC-64.
+// It searches from the position (including it) until an empty slot.
+// When no match, return -1
+int64_t cmp_list_next(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, int64_t position)
+{
+	uint64_t i;
+
+	i = (uint64_t)position & mask;
+	while (cmp_list[i].index != CMP_LIST_EMPTY){
+		if (cmp_list[i].crc == crc)
+			return (int64_t)i;
+		i = (i + 1) & mask;
+	}
+
+	return -1;
+}
+
+// Return position of the first item, which has the same CRC-64.
+// When no match, return -1
+int64_t cmp_list_search(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc)
+{
+	return cmp_list_next(cmp_list, mask, crc, (int64_t)cmp_list_home(crc, mask));
+}
+
+// Return position of the item, which has the same CRC-64 and index.
+// When no match, return -1
+int64_t cmp_list_search_index(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, uint64_t index)
+{
+	int64_t position;
+
+	position = cmp_list_search(cmp_list, mask, crc);
+	while (position >= 0){
+		if (cmp_list[position].index == index)
+			return position;
+		position = cmp_list_next(cmp_list, mask, crc, position + 1);
+	}
+
+	return -1;
+}
+
+// Remove the item at the position.
+// Following items in the run are shifted back, so there is no deleted mark.
+// Items after the position may move into the position, but items never move before it.
+void cmp_list_remove(PAR3_CMP_CTX *cmp_list, uint64_t mask, int64_t position)
+{
+	uint64_t hole, i, home;
+
+	hole = (uint64_t)position;
+	i = hole;
+	while (1){
+		i = (i + 1) & mask;
+		if (cmp_list[i].index == CMP_LIST_EMPTY)
+			break;
+
+		// An item can move into the hole, when the hole is between its home and it.
+		home = cmp_list_home(cmp_list[i].crc, mask);
+		if ( ((i - home) & mask) >= ((i - hole) & mask) ){
+			cmp_list[hole] = cmp_list[i];
+			hole = i;
+		}
+	}
+	cmp_list[hole].index = CMP_LIST_EMPTY;
 }
 
 // Compare CRC-64 of blocks
@@ -188,282 +546,227 @@ static int compare_crc( const void *arg1, const void *arg2 )
 // When no match, return -1 ~ -2. When fingerprint hash was calculated, return -3.
 int64_t crc_list_compare(PAR3_CTX *par3_ctx, uint64_t crc, uint8_t *buf, uint8_t hash[16])
 {
-	uint64_t count, index;
-	PAR3_CMP_CTX cmp_key, *cmp_p, *cmp2_p;
+	int64_t position;
+	PAR3_CMP_CTX *crc_list;
 	PAR3_BLOCK_CTX *block_list;
 
-	count = par3_ctx->crc_count;
-	if (count == 0)
+	if (par3_ctx->crc_count == 0)
 		return -1;
+	if (CMP_FILTER_TEST(par3_ctx->crc_filter, par3_ctx->crc_mask, crc) == 0)
+		return -2;
 
-	// Binary search
-	cmp_key.crc = crc;
-	cmp_p = (PAR3_CMP_CTX *)bsearch( &cmp_key, par3_ctx->crc_list, (size_t)count, sizeof(PAR3_CMP_CTX), compare_crc );
-	if (cmp_p == NULL)
+	crc_list = par3_ctx->crc_list;
+	position = cmp_list_search(crc_list, par3_ctx->crc_mask, crc);
+	if (position < 0)
 		return -2;
 
+	// Check all items of same CRC-64
 	block_list = par3_ctx->block_list;
-	blake3(buf, par3_ctx->block_size, hash);
-	if (memcmp(hash, block_list[cmp_p->index].hash, 16) == 0)
-		return cmp_p->index;
-
-	// Search lower items of same CRC-64
-	cmp2_p = cmp_p;
-	index = cmp_p - par3_ctx->crc_list;
-	while (index > 0){
-		cmp2_p--;
-		if (cmp2_p->crc != crc)
-			break;
-		if (memcmp(hash, block_list[cmp2_p->index].hash, 16) == 0)
-			return cmp2_p->index;
-		index--;
+	if (buf != NULL)	// When buf is NULL, hash was calculated already.
+		blake3(buf, par3_ctx->block_size, hash);
+	while (position >= 0){
+		if (memcmp(hash, block_list[crc_list[position].index].hash, 16) == 0)
+			return crc_list[position].index;
+		position = cmp_list_next(crc_list, par3_ctx->crc_mask, crc, position + 1);
 	}
 
-	// Search higher items of same CRC-64
-	cmp2_p = cmp_p;
-	index = cmp_p - par3_ctx->crc_list;
-	while (index + 1 < count){
-		cmp2_p++;
-		if (cmp2_p->crc != crc)
-			break;
-		if (memcmp(hash, block_list[cmp2_p->index].hash, 16) == 0)
-			return cmp2_p->index;
-		index++;
+	return -3;
+}
+
+// Allocate hash index for maximum items.
+int crc_list_alloc(PAR3_CTX *par3_ctx, uint64_t count)
+{
+	uint64_t size;
+
+	// Bitmap filter follows the table in the same memory.
+	size = cmp_list_size(count);
+	par3_ctx->crc_list = malloc(sizeof(PAR3_CMP_CTX) * size + sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+	if (par3_ctx->crc_list == NULL){
+		perror("Failed to allocate memory for comparison of CRC-64");
+		return RET_MEMORY_ERROR;
 	}
+	cmp_list_clear(par3_ctx->crc_list, size);
+	par3_ctx->crc_filter = (uint64_t *)(par3_ctx->crc_list + size);
+	memset(par3_ctx->crc_filter, 0, sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+	par3_ctx->crc_mask = size - 1;
+	par3_ctx->crc_count = 0;	// There is no item yet.
 
-	return -3;
+	return 0;
 }
 
-// Add new crc in list and sort items.
+// Add new crc in hash index.
 void crc_list_add(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index)
 {
-	uint64_t count;
+	cmp_list_add(par3_ctx->crc_list, par3_ctx->crc_mask, crc, index);
+	cmp_filter_add(par3_ctx->crc_filter, par3_ctx->crc_mask, crc);
+	par3_ctx->crc_count++;
+}
 
-	count = par3_ctx->crc_count;
+// Return index of slice with same chunk tail, or -1.
+int64_t tail_map_compare(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t tail_size, uint8_t hash[16])
+{
+	int64_t position;
+	PAR3_CMP_CTX *tail_list;
+	PAR3_SLICE_CTX *slice_p;
+	PAR3_CHUNK_CTX *chunk_p;
 
-	// Add new item.
-	par3_ctx->crc_list[count].crc = crc;
-	par3_ctx->crc_list[count].index = index;
-	count++;
+	if (par3_ctx->tail_map_count == 0)
+		return -1;
 
-	// Quick sort items.
-	qsort( (void *)(par3_ctx->crc_list), (size_t)count, sizeof(PAR3_CMP_CTX), compare_crc );
+	tail_list = par3_ctx->tail_map_list;
+	position = cmp_list_search(tail_list, par3_ctx->tail_map_mask, crc);
+	while (position >= 0){
+		slice_p = par3_ctx->slice_list + tail_list[position].index;
+		chunk_p = par3_ctx->chunk_list + slice_p->chunk;
+		if ( (slice_p->size == tail_size) && (memcmp(hash, chunk_p->tail_hash, 16) == 0) )
+			return tail_list[position].index;
+		position = cmp_list_next(tail_list, par3_ctx->tail_map_mask, crc, position + 1);
+	}
 
-	par3_ctx->crc_count = count;
+	return -1;
 }
 
-// Make list of crc for seaching full size blocks and chunk tails.
+// Add slice of new chunk tail in hash index. Index grows, when it's half full.
+int tail_map_add(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index)
+{
+	uint64_t size, i;
+	PAR3_CMP_CTX *old_list, *new_list;
+
+	if (par3_ctx->tail_map_list == NULL){
+		par3_ctx->tail_map_count = 0;
+		par3_ctx->tail_map_mask = 0;
+	}
+	if ( (par3_ctx->tail_map_list == NULL) || ((par3_ctx->tail_map_count + 1) * 2 > par3_ctx->tail_map_mask + 1) ){
+		size = cmp_list_size(par3_ctx->tail_map_count * 2 + 1);
+		new_list = malloc(sizeof(PAR3_CMP_CTX) * size);
+		if (new_list == NULL){
+			perror("Failed to allocate memory for comparison of chunk tails");
+			return RET_MEMORY_ERROR;
+		}
+		cmp_list_clear(new_list, size);
+		old_list = par3_ctx->tail_map_list;
+		if (old_list != NULL){
+			for (i = 0; i <= par3_ctx->tail_map_mask; i++){
+				if (old_list[i].index != CMP_LIST_EMPTY)
+					cmp_list_add(new_list, size - 1, old_list[i].crc, old_list[i].index);
+			}
+			free(old_list);
+		}
+		par3_ctx->tail_map_list = new_list;
+		par3_ctx->tail_map_mask = size - 1;
+	}
+
+	cmp_list_add(par3_ctx->tail_map_list, par3_ctx->tail_map_mask, crc, index);
+	par3_ctx->tail_map_count++;
+	return 0;
+}
+
+// Make hash index of crc for seaching full size blocks and chunk tails.
+// Allocated memory is double size for local copy, and bitmap filter follows.
 int crc_list_make(PAR3_CTX *par3_ctx)
 {
-	uint64_t full_count, tail_count, index;
-	uint64_t block_size, block_count, chunk_count, slice_count;
+	uint64_t full_count, tail_count, index, size;
+	uint64_t block_size, block_count, slice_count;
 	PAR3_BLOCK_CTX *block_p;
 	PAR3_CHUNK_CTX *chunk_list;
 	PAR3_SLICE_CTX *slice_p;
 	PAR3_CMP_CTX *crc_list, *tail_list;
 
-	if (par3_ctx->block_count == 0){
-		par3_ctx->crc_count = 0;
-		par3_ctx->tail_count = 0;
+	par3_ctx->crc_count = 0;
+	par3_ctx->tail_count = 0;
+	if (par3_ctx->block_count == 0)
 		return 0;
-	}
 
-	// Allocate list of CRC-64 (double size for local copy)
 	block_count = par3_ctx->block_count;
-	crc_list = malloc(sizeof(PAR3_CMP_CTX) * block_count * 2);
-	if (crc_list == NULL){
-		perror("Failed to allocate memory for comparison of CRC-64");
-		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->crc_list = crc_list;
-
-	// At this time, number of tails is unknown.
-	// When a chunk size is multiple of block size, the chunk has no tail.
-	chunk_count = par3_ctx->chunk_count;
-	tail_list = malloc(sizeof(PAR3_CMP_CTX) * chunk_count * 2);
-	if (tail_list == NULL){
-		perror("Failed to allocate memory for comparison of CRC-64");
-		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->tail_list = tail_list;
-
-	full_count = 0;
-	tail_count = 0;
 	block_p = par3_ctx->block_list;
 	chunk_list = par3_ctx->chunk_list;
 	slice_count = par3_ctx->slice_count;
 	slice_p = par3_ctx->slice_list;
 	block_size = par3_ctx->block_size;
 
-	// Find block of full size data, and set CRC of the block.
+	// Count blocks of full size data, and chunk tails.
+	full_count = 0;
 	for (index = 0; index < block_count; index++){
 		// Even if checksum doesn't exist, the block is included.
-		if (block_p->state & 1){
-			crc_list[full_count].crc = block_p->crc;
-			crc_list[full_count].index = index;
+		if (block_p[index].state & 1)
 			full_count++;
-		}
-
-		block_p++;
 	}
-
-	// Find slice for chunk tail, and set CRC of the chunk.
+	tail_count = 0;
 	for (index = 0; index < slice_count; index++){
-		if (slice_p->size < block_size){	// This slice is a chunk tail.
-			tail_list[tail_count].crc = chunk_list[slice_p->chunk].tail_crc;
-			tail_list[tail_count].index = index;
+		if (slice_p[index].size < block_size)	// This slice is a chunk tail.
 			tail_count++;
-		}
-
-		slice_p++;
 	}
 
-	// Re-allocate memory for actual number of CRC-64
-	if (full_count < block_count){
-		if (full_count > 0){
-			crc_list = realloc(par3_ctx->crc_list, sizeof(PAR3_CMP_CTX) * full_count * 2);
-			if (crc_list == NULL){
-				perror("Failed to re-allocate memory for comparison of CRC-64");
-				return RET_MEMORY_ERROR;
-			}
-			par3_ctx->crc_list = crc_list;
-		} else {
-			free(par3_ctx->crc_list);
-			par3_ctx->crc_list = NULL;
+	// Set CRC of full size blocks.
+	if (full_count > 0){
+		size = cmp_list_size(full_count);
+		crc_list = malloc(sizeof(PAR3_CMP_CTX) * size * 2 + sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+		if (crc_list == NULL){
+			perror("Failed to allocate memory for comparison of CRC-64");
+			return RET_MEMORY_ERROR;
 		}
-	}
-	if (tail_count < chunk_count){
-		if (tail_count > 0){
-			tail_list = realloc(par3_ctx->tail_list, sizeof(PAR3_CMP_CTX) * tail_count * 2);
-			if (tail_list == NULL){
-				perror("Failed to re-allocate memory for comparison of CRC-64");
-				return RET_MEMORY_ERROR;
+		par3_ctx->crc_list = crc_list;
+		par3_ctx->crc_mask = size - 1;
+		par3_ctx->crc_filter = (uint64_t *)(crc_list + size * 2);
+		cmp_list_clear(crc_list, size);
+		memset(par3_ctx->crc_filter, 0, sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+		for (index = 0; index < block_count; index++){
+			if (block_p[index].state & 1){
+				cmp_list_add(crc_list, size - 1, block_p[index].crc, index);
+				cmp_filter_add(par3_ctx->crc_filter, size - 1, block_p[index].crc);
 			}
-			par3_ctx->tail_list = tail_list;
-		} else {
-			free(par3_ctx->tail_list);
-			par3_ctx->tail_list = NULL;
 		}
+		par3_ctx->crc_count = full_count;
 	}
 
-	// Quick sort items.
-	if (full_count > 1){
-		// CRC for full size block
-		qsort( (void *)crc_list, (size_t)full_count, sizeof(PAR3_CMP_CTX), compare_crc );
-	}
-	if (tail_count > 1){
-		// CRC for chunk tail
-		qsort( (void *)tail_list, (size_t)tail_count, sizeof(PAR3_CMP_CTX), compare_crc );
+	// Set CRC of chunk tails.
+	if (tail_count > 0){
+		size = cmp_list_size(tail_count);
+		tail_list = malloc(sizeof(PAR3_CMP_CTX) * size * 2 + sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+		if (tail_list == NULL){
+			perror("Failed to allocate memory for comparison of CRC-64");
+			return RET_MEMORY_ERROR;
+		}
+		par3_ctx->tail_list = tail_list;
+		par3_ctx->tail_mask = size - 1;
+		par3_ctx->tail_filter = (uint64_t *)(tail_list + size * 2);
+		cmp_list_clear(tail_list, size);
+		memset(par3_ctx->tail_filter, 0, sizeof(uint64_t) * CMP_FILTER_SIZE(size));
+		for (index = 0; index < slice_count; index++){
+			if (slice_p[index].size < block_size){
+				cmp_list_add(tail_list, size - 1, chunk_list[slice_p[index].chunk].tail_crc, index);
+				cmp_filter_add(par3_ctx->tail_filter, size - 1, chunk_list[slice_p[index].chunk].tail_crc);
+			}
+		}
+		par3_ctx->tail_count = tail_count;
 	}
 
-	par3_ctx->crc_count = full_count;
-	par3_ctx->tail_count = tail_count;
-
 	return 0;
 }
 
-// Replace crc of a block, and sort again.
+// Replace crc of a block.
 void crc_list_replace(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index)
 {
-	int64_t i, count;
+	uint64_t i, mask;
 	PAR3_CMP_CTX *crc_list;
 
 	if ( (par3_ctx->crc_list == NULL) || (par3_ctx->crc_count == 0) )
 		return;
 
 	crc_list = par3_ctx->crc_list;
-	count = par3_ctx->crc_count;
+	mask = par3_ctx->crc_mask;
 
-	// Search the item and replace the value.
-	for (i = 0; i < count; i++){
+	// Because previous CRC-64 is unknown, search the item from all slots.
+	for (i = 0; i <= mask; i++){
 		if (crc_list[i].index == index){
-			crc_list[i].crc = crc;
-			i = -1;
+			cmp_list_remove(crc_list, mask, (int64_t)i);
+			cmp_list_add(crc_list, mask, crc, index);
+			cmp_filter_add(par3_ctx->crc_filter, mask, crc);
 			break;
 		}
 	}
-
-	if ( (count > 1) && (i == -1) ){
-		// Quick sort items.
-		qsort( (void *)crc_list, (size_t)count, sizeof(PAR3_CMP_CTX), compare_crc );
-	}
 }
 
-// Compare CRC-64 of blocks or chunk tails
-// Return index of the first item, which has the same CRC-64.
-// When no match, return -1 ~ -2
-int64_t cmp_list_search(PAR3_CTX *par3_ctx, uint64_t crc, PAR3_CMP_CTX *cmp_list, int64_t count)
-{
-	int64_t index;
-	PAR3_CMP_CTX cmp_key, *cmp_p;
-
-	if (count == 0)
-		return -1;
-
-	// Binary search
-	cmp_key.crc = crc;
-	cmp_p = (PAR3_CMP_CTX *)bsearch( &cmp_key, cmp_list, (size_t)count, sizeof(PAR3_CMP_CTX), compare_crc );
-	if (cmp_p == NULL)
-		return -2;
-
-	// Search lower items of same CRC-64
-	index = cmp_p - cmp_list;
-	while (index > 0){
-		cmp_p--;
-		if (cmp_p->crc != crc)
-			break;
-		index--;
-	}
-
-	return index;
-}
-
-// Compare CRC-64 of blocks or chunk tails
-// When no match, return -1 ~ -3
-int64_t cmp_list_search_index(PAR3_CTX *par3_ctx, uint64_t crc, int64_t id, PAR3_CMP_CTX *cmp_list, int64_t count)
-{
-	int64_t index;
-	PAR3_CMP_CTX cmp_key, *cmp_p, *cmp2_p;
-
-	if (count == 0)
-		return -1;
-
-	// Binary search
-	cmp_key.crc = crc;
-	cmp_p = (PAR3_CMP_CTX *)bsearch( &cmp_key, cmp_list, (size_t)count, sizeof(PAR3_CMP_CTX), compare_crc );
-	if (cmp_p == NULL)
-		return -2;
-
-	// Search lower items of same CRC-64
-	cmp2_p = cmp_p;
-	index = cmp_p - cmp_list;
-	if (cmp_p->index == id)
-		return index;
-	while (index > 0){
-		cmp2_p--;
-		if (cmp2_p->crc != crc)
-			break;
-		if (cmp2_p->index == id)
-			return index;
-		index--;
-	}
-
-	// Search higher items of same CRC-64
-	cmp2_p = cmp_p;
-	index = cmp_p - cmp_list;
-	while (index + 1 < count){
-		cmp2_p++;
-		if (cmp2_p->crc != crc)
-			break;
-		if (cmp2_p->index == id)
-			return index;
-		index++;
-	}
-
-	return -3;
-}
-
-
 /*
 This BLAKE3 code is non-SIMD subset of portable version from below;
 https://github.com/BLAKE3-team/BLAKE3
@@ -481,80 +784,114 @@ void blake3(const uint8_t *buf, size_t size, uint8_t *hash)
 	blake3_hasher hasher;
 	blake3_hasher_init(&hasher);
 
-	blake3_hasher_update(&hasher, buf, size);
+	blake3_update(&hasher, buf, size);
 
 	// Finalize the hash.
 	blake3_hasher_finalize(&hasher, hash, 16);
 }
 
-
-// Create parity bytes in the region
-void region_create_parity(uint8_t *buf, size_t region_size)
+// Update hasher with large data on threads.
+// Subtrees of BLAKE3 are hashed independently, so the result is same as serial update.
+// Inside a task of thread pool, it works serially.
+void blake3_update(void *hasher, const uint8_t *buf, size_t size)
 {
-	uint32_t sum;
+	int thread_count;
 
-	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
-		sum ^= *((uint32_t *)buf);
+	thread_count = thread_pool_count();
+	if (thread_count > 1){
+		blake3_hasher_update_parallel(hasher, buf, size, thread_pool_run, thread_count * 4);
+	} else {
+		blake3_hasher_update(hasher, buf, size);
+	}
+}
 
-		region_size -= 4;
-		buf += 4;
+// State of BLAKE3 hasher is large (1.9 KB) for its stack of chaining values.
+// When the total data size is known, the stack needs only a few entries.
+// This returns size of packed state to hash "data_size" bytes.
+size_t blake3_state_size(uint64_t data_size)
+{
+	size_t depth;
+	uint64_t chunk_count;
+
+	// Because of lazy merging, entries in the stack are one more than bits of chunk count.
+	depth = 1;
+	chunk_count = (data_size + BLAKE3_CHUNK_LEN - 1) / BLAKE3_CHUNK_LEN;
+	while (chunk_count > 0){
+		depth++;
+		chunk_count >>= 1;
 	}
+	if (depth > BLAKE3_MAX_DEPTH + 1)
+		depth = BLAKE3_MAX_DEPTH + 1;
 
-	// Parity is saved at the last 4-bytes.
-	((uint32_t *)buf)[0] = sum;
+	// Align to 8 bytes
+	return (offsetof(blake3_hasher, cv_stack) + depth * BLAKE3_OUT_LEN + 7) & ~7;
 }
 
-// Check parity bytes in the region
-int region_check_parity(uint8_t *buf, size_t region_size)
+// Copy used part of hasher to packed state.
+void blake3_state_save(uint8_t *state, const void *hasher)
 {
-	uint32_t sum;
+	const blake3_hasher *self = hasher;
 
-	// XOR all block data to 4 bytes
-	sum = 0;
-	while (region_size > 4){
+	memcpy(state, self, offsetof(blake3_hasher, cv_stack) + self->cv_stack_len * BLAKE3_OUT_LEN);
+}
+
+// Restore hasher from packed state.
+void blake3_state_load(void *hasher, const uint8_t *state)
+{
+	blake3_hasher *self = hasher;
+
+	memcpy(self, state, offsetof(blake3_hasher, cv_stack));
+	memcpy(self->cv_stack, state + offsetof(blake3_hasher, cv_stack), self->cv_stack_len * BLAKE3_OUT_LEN);
+}
+
+
+// XOR 4-byte words in the region to parity
+static uint32_t region_xor_parity(uint32_t sum, uint8_t *buf, size_t size)
+{
+	while (size >= 4){
 		sum ^= *((uint32_t *)buf);
 
-		region_size -= 4;
+		size -= 4;
 		buf += 4;
 	}
 
+	return sum;
+}
+
+// Create parity bytes in the region
+void region_create_parity(uint8_t *buf, size_t region_size)
+{
 	// Parity is saved at the last 4-bytes.
-	if (((uint32_t *)buf)[0] != sum)
+	((uint32_t *)(buf + region_size - 4))[0] = region_xor_parity(0, buf, region_size - 4);
+}
+
+// Check parity bytes in the region
+int region_check_parity(uint8_t *buf, size_t region_size)
+{
+	// Parity is saved at the last 4-bytes.
+	if (((uint32_t *)(buf + region_size - 4))[0] != region_xor_parity(0, buf, region_size - 4))
 		return 1;
 
 	return 0;
 }
 
 
-// Create parity bytes in the region for Leopard-RS (ALTMAP)
-// region_size must be multiple of 64.
-void leo_region_create_parity(uint8_t *buf, size_t region_size)
+// XOR 64-byte units to parity, and move them to ALTMAP.
+// At the end of region, parity is saved at the last 4-bytes.
+static uint32_t leo_region_create_chunk(uint32_t sum, uint8_t *buf, size_t size, int is_end)
 {
 	uint8_t temp_buf[64];
 	size_t i;
-	uint32_t sum;
 
-	// XOR all block data to 4 bytes.
-	sum = 0;
-	while (region_size >= 64){
-		if (region_size == 64){	// Parity is saved at the last 4-bytes.
-			for (i = 0; i < 60; i += 4){
-				sum ^= *((uint32_t *)buf);
-				buf += 4;
-			}
-			((uint32_t *)buf)[0] = sum;
-			buf += 4;
+	while (size >= 64){
+		if ( (is_end != 0) && (size == 64) ){	// Parity is saved at the last 4-bytes.
+			sum = region_xor_parity(sum, buf, 60);
+			((uint32_t *)(buf + 60))[0] = sum;
 		} else {
-			for (i = 0; i < 64; i += 4){
-				sum ^= *((uint32_t *)buf);
-				buf += 4;
-			}
+			sum = region_xor_parity(sum, buf, 64);
 		}
 
 		// move to ALTMAP
-		buf -= 64;
 		for (i = 0; i < 32; i++){
 			temp_buf[i     ] = buf[i * 2    ];
 			temp_buf[i + 32] = buf[i * 2 + 1];
@@ -562,20 +899,20 @@ void leo_region_create_parity(uint8_t *buf, size_t region_size)
 		memcpy(buf, temp_buf, 64);
 
 		buf += 64;
-		region_size -= 64;
+		size -= 64;
 	}
+
+	return sum;
 }
 
-// Check parity bytes in the region for Leopard-RS (ALTMAP)
-int leo_region_check_parity(uint8_t *buf, size_t region_size)
+// Return 64-byte units from ALTMAP, and XOR them to parity.
+// At the end of region, parity is compared with the last 4-bytes.
+static int leo_region_check_chunk(uint32_t *sum, uint8_t *buf, size_t size, int is_end)
 {
 	uint8_t temp_buf[64];
 	size_t i;
-	uint32_t sum;
 
-	// XOR all block data to 4 bytes.
-	sum = 0;
-	while (region_size >= 64){
+	while (size >= 64){
 		// return from ALTMAP
 		for (i = 0; i < 32; i++){
 			temp_buf[i * 2    ] = buf[i     ];
@@ -583,26 +920,36 @@ int leo_region_check_parity(uint8_t *buf, size_t region_size)
 		}
 		memcpy(buf, temp_buf, 64);
 
-		if (region_size == 64){	// Parity is saved at the last 4-bytes.
-			for (i = 0; i < 60; i += 4){
-				sum ^= *((uint32_t *)buf);
-				buf += 4;
-			}
-			if (((uint32_t *)buf)[0] != sum)
+		if ( (is_end != 0) && (size == 64) ){	// Parity is saved at the last 4-bytes.
+			*sum = region_xor_parity(*sum, buf, 60);
+			if (((uint32_t *)(buf + 60))[0] != *sum)
 				return 1;
 		} else {
-			for (i = 0; i < 64; i += 4){
-				sum ^= *((uint32_t *)buf);
-				buf += 4;
-			}
+			*sum = region_xor_parity(*sum, buf, 64);
 		}
 
-		region_size -= 64;
+		buf += 64;
+		size -= 64;
 	}
 
 	return 0;
 }
 
+// Create parity bytes in the region for Leopard-RS (ALTMAP)
+// region_size must be multiple of 64.
+void leo_region_create_parity(uint8_t *buf, size_t region_size)
+{
+	leo_region_create_chunk(0, buf, region_size, 1);
+}
+
+// Check parity bytes in the region for Leopard-RS (ALTMAP)
+int leo_region_check_parity(uint8_t *buf, size_t region_size)
+{
+	uint32_t sum = 0;
+
+	return leo_region_check_chunk(&sum, buf, region_size, 1);
+}
+
 // Restore region bytes from ALTMAP for Leopard-RS
 void leo_region_restore(uint8_t *buf, size_t region_size)
 {
@@ -622,3 +969,102 @@ void leo_region_restore(uint8_t *buf, size_t region_size)
 	}
 }
 
+
+// Size of chunk to calculate parity and checksum at once.
+// It must be multiple of 64 for Leopard-RS, and should fit in L1 cache.
+#define PARITY_CHUNK_SIZE	16384
+
+// Update parity of Cauchy Reed-Solomon or XOR
+static uint32_t region_parity_chunk(PAR3_CTX *par3_ctx, uint32_t sum, uint8_t *buf, size_t size)
+{
+	if ((par3_ctx->ecc_method & 8) == 0){	// Cauchy Reed-Solomon Codes
+		if (par3_ctx->gf_size == 2){
+			return gf16_region_parity(par3_ctx->galois_poly, sum, buf, size);
+		} else if (par3_ctx->gf_size == 1){
+			return gf8_region_parity(par3_ctx->galois_poly, sum, buf, size);
+		}
+	}
+
+	// Because GF Multiplication doesn't work on FFT, it does XOR only.
+	return region_xor_parity(sum, buf, size);
+}
+
+// Create parity bytes in the region, and calculate CRC-64 of the first data_size bytes.
+// It processes small chunks, so that reading block data from memory happens only once.
+uint64_t region_create_parity_crc(PAR3_CTX *par3_ctx, uint8_t *buf, size_t region_size, size_t data_size, uint64_t crc)
+{
+	size_t offset, chunk_size, hash_size;
+	uint32_t sum;
+	int is_end, is_leo;
+
+	is_leo = (par3_ctx->ecc_method & 8) && (par3_ctx->gf_size == 2);
+	sum = 0;
+	for (offset = 0; offset < region_size; offset += chunk_size){
+		chunk_size = region_size - offset;
+		if (chunk_size > PARITY_CHUNK_SIZE)
+			chunk_size = PARITY_CHUNK_SIZE;
+		is_end = (offset + chunk_size == region_size);
+
+		// CRC must be calculated before moving to ALTMAP.
+		if (data_size > offset){
+			hash_size = data_size - offset;
+			if (hash_size > chunk_size)
+				hash_size = chunk_size;
+			crc = crc64(buf + offset, hash_size, crc);
+		}
+
+		if (is_leo){
+			sum = leo_region_create_chunk(sum, buf + offset, chunk_size, is_end);
+		} else if (is_end){	// Parity is saved at the last 4-bytes.
+			sum = region_parity_chunk(par3_ctx, sum, buf + offset, chunk_size - 4);
+			((uint32_t *)(buf + region_size - 4))[0] = sum;
+		} else {
+			sum = region_parity_chunk(par3_ctx, sum, buf + offset, chunk_size);
+		}
+	}
+
+	return crc;
+}
+
+// Check parity bytes in the region, and calculate CRC-64 or BLAKE3 of the first data_size bytes.
+// It processes small chunks, so that reading block data from memory happens only once.
+int region_check_parity_hash(PAR3_CTX *par3_ctx, uint8_t *buf, size_t region_size, size_t data_size, uint64_t *crc, void *hasher)
+{
+	size_t offset, chunk_size, hash_size;
+	uint32_t sum;
+	int is_end, is_leo;
+
+	is_leo = (par3_ctx->ecc_method & 8) && (par3_ctx->gf_size == 2);
+	sum = 0;
+	for (offset = 0; offset < region_size; offset += chunk_size){
+		chunk_size = region_size - offset;
+		if (chunk_size > PARITY_CHUNK_SIZE)
+			chunk_size = PARITY_CHUNK_SIZE;
+		is_end = (offset + chunk_size == region_size);
+
+		if (is_leo){
+			if (leo_region_check_chunk(&sum, buf + offset, chunk_size, is_end) != 0)
+				return 1;
+		} else if (is_end){	// Parity is saved at the last 4-bytes.
+			sum = region_parity_chunk(par3_ctx, sum, buf + offset, chunk_size - 4);
+			if (((uint32_t *)(buf + region_size - 4))[0] != sum)
+				return 1;
+		} else {
+			sum = region_parity_chunk(par3_ctx, sum, buf + offset, chunk_size);
+		}
+
+		// Checksum must be calculated after returning from ALTMAP.
+		if (data_size > offset){
+			hash_size = data_size - offset;
+			if (hash_size > chunk_size)
+				hash_size = chunk_size;
+			if (crc != NULL)
+				*crc = crc64(buf + offset, hash_size, *crc);
+			if (hasher != NULL)
+				blake3_hasher_update(hasher, buf + offset, hash_size);
+		}
+	}
+
+	return 0;
+}
+
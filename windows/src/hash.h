@@ -1,24 +1,53 @@
 
 // CRC-64-ISO
 uint64_t crc64(const uint8_t *buf, size_t size, uint64_t crc);
-uint64_t crc64_zero(size_t size, uint64_t crc);
+uint64_t crc64_zero(uint64_t size, uint64_t crc);
+uint64_t crc64_combine(uint64_t crc_a, uint64_t crc_b, uint64_t size_b);
 
 // table setup for slide window search
 void init_crc_slide_table(PAR3_CTX *par3_ctx, int flag_usage);
 uint64_t crc_slide_byte(uint64_t crc, uint8_t byteNew, uint8_t byteOld, uint64_t window_table[256]);
+#define CRC_SLIDE_BATCH	4096	// number of offsets to slide at once
+void crc_slide_batch(const uint8_t *buf, uint64_t window_size, size_t count, uint64_t crc,
+		uint64_t *crc_list, uint64_t window_mask, uint64_t window_table[256]);
+size_t crc_slide_scan(const uint64_t *crc_list, size_t offset, size_t count, const uint64_t *filter, uint64_t mask);
+
+// hash index to search CRC-64
+#define CMP_LIST_EMPTY	0xFFFFFFFFFFFFFFFF	// index of empty slot
+
+uint64_t cmp_list_size(uint64_t count);
+void cmp_list_clear(PAR3_CMP_CTX *cmp_list, uint64_t size);
+void cmp_list_add(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, uint64_t index);
+int64_t cmp_list_next(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, int64_t position);
+int64_t cmp_list_search(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc);
+int64_t cmp_list_search_index(PAR3_CMP_CTX *cmp_list, uint64_t mask, uint64_t crc, uint64_t index);
+void cmp_list_remove(PAR3_CMP_CTX *cmp_list, uint64_t mask, int64_t position);
+
+// bitmap filter in front of hash index, 16 bits per slot
+#define CMP_FILTER_SIZE(size)	((size) / 4)	// number of 64-bit words for table size
+#define CMP_FILTER_MASK(mask)	(((mask) << 4) | 15)
+#define CMP_FILTER_TEST(filter, mask, crc)	\
+	((filter)[((crc) & CMP_FILTER_MASK(mask)) >> 6] & ((uint64_t)1 << ((crc) & 63)))
+
+void cmp_filter_add(uint64_t *filter, uint64_t mask, uint64_t crc);
 
-// for sort and search CRC-64
 int64_t crc_list_compare(PAR3_CTX *par3_ctx, uint64_t crc, uint8_t *buf, uint8_t hash[16]);
+int crc_list_alloc(PAR3_CTX *par3_ctx, uint64_t count);
 void crc_list_add(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index);
+int64_t tail_map_compare(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t tail_size, uint8_t hash[16]);
+int tail_map_add(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index);
 int crc_list_make(PAR3_CTX *par3_ctx);
 void crc_list_replace(PAR3_CTX *par3_ctx, uint64_t crc, uint64_t index);
 
-int64_t cmp_list_search(PAR3_CTX *par3_ctx, uint64_t crc, PAR3_CMP_CTX *cmp_list, int64_t count);
-int64_t cmp_list_search_index(PAR3_CTX *par3_ctx, uint64_t crc, int64_t id, PAR3_CMP_CTX *cmp_list, int64_t count);
-
 
 // BLAKE3
 void blake3(const uint8_t *buf, size_t size, uint8_t *hash);
+void blake3_update(void *hasher, const uint8_t *buf, size_t size);
+
+// packed state of BLAKE3 hasher (blake3_hasher), while hashing "data_size" bytes
+size_t blake3_state_size(uint64_t data_size);
+void blake3_state_save(uint8_t *state, const void *hasher);
+void blake3_state_load(void *hasher, const uint8_t *state);
 
 
 // parity bytes in the region
@@ -30,3 +59,8 @@ void leo_region_create_parity(uint8_t *buf, size_t region_size);
 int leo_region_check_parity(uint8_t *buf, size_t region_size);
 void leo_region_restore(uint8_t *buf, size_t region_size);
 
+// parity bytes and checksum of block data at once, while each chunk is in cache
+// When crc or hasher (blake3_hasher) is NULL, it isn't calculated.
+uint64_t region_create_parity_crc(PAR3_CTX *par3_ctx, uint8_t *buf, size_t region_size, size_t data_size, uint64_t crc);
+int region_check_parity_hash(PAR3_CTX *par3_ctx, uint8_t *buf, size_t region_size, size_t data_size, uint64_t *crc, void *hasher);
+
@@ -69,6 +69,8 @@ bool CpuHasSSSE3 = false;
 
 #define CPUID_EBX_AVX2    0x00000020
 #define CPUID_ECX_SSSE3   0x00000200
+#define CPUID_ECX_OSXSAVE 0x08000000
+#define CPUID_ECX_AVX     0x10000000
 
 static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 {
@@ -107,6 +109,20 @@ static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 #endif
 }
 
+#ifdef LEO_TRY_AVX2
+// Check that OS saves YMM registers
+static bool _os_has_ymm()
+{
+#if defined(_MSC_VER)
+    return (_xgetbv(0) & 6) == 6;
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & 6) == 6;
+#endif
+}
+#endif // LEO_TRY_AVX2
+
 #elif defined(LEO_USE_SSE2NEON)
 bool CpuHasSSSE3 = true;
 #endif // defined(LEO_TARGET_MOBILE)
@@ -136,8 +152,12 @@ void InitializeCPUArch()
     CpuHasSSSE3 = ((cpu_info[2] & CPUID_ECX_SSSE3) != 0);
 
 #if defined(LEO_TRY_AVX2)
-    _cpuid(cpu_info, 7);
-    CpuHasAVX2 = ((cpu_info[1] & CPUID_EBX_AVX2) != 0);
+    const unsigned int avx_mask = CPUID_ECX_OSXSAVE | CPUID_ECX_AVX;
+    if ((cpu_info[2] & avx_mask) == avx_mask && _os_has_ymm())
+    {
+        _cpuid(cpu_info, 7);
+        CpuHasAVX2 = ((cpu_info[1] & CPUID_EBX_AVX2) != 0);
+    }
 #endif // LEO_TRY_AVX2
 
 #ifndef LEO_USE_SSSE3_OPT
@@ -154,6 +174,36 @@ void InitializeCPUArch()
 //------------------------------------------------------------------------------
 // XOR Memory
 
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void xor_mem_avx2(
+    void * LEO_RESTRICT vx, const void * LEO_RESTRICT vy,
+    uint64_t bytes)
+{
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(vx);
+    const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(vy);
+    while (bytes >= 128)
+    {
+        const LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        const LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        const LEO_M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
+        const LEO_M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+        _mm256_storeu_si256(x32 + 2, x2);
+        _mm256_storeu_si256(x32 + 3, x3);
+        x32 += 4, y32 += 4;
+        bytes -= 128;
+    };
+    if (bytes > 0)
+    {
+        const LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        const LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+    }
+}
+#endif // LEO_TRY_AVX2
+
 void xor_mem(
     void * LEO_RESTRICT vx, const void * LEO_RESTRICT vy,
     uint64_t bytes)
@@ -161,28 +211,7 @@ void xor_mem(
 #if defined(LEO_TRY_AVX2)
     if (CpuHasAVX2)
     {
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(vx);
-        const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(vy);
-        while (bytes >= 128)
-        {
-            const LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            const LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            const LEO_M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
-            const LEO_M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-            _mm256_storeu_si256(x32 + 2, x2);
-            _mm256_storeu_si256(x32 + 3, x3);
-            x32 += 4, y32 += 4;
-            bytes -= 128;
-        };
-        if (bytes > 0)
-        {
-            const LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            const LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-        }
+        xor_mem_avx2(vx, vy, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -206,6 +235,46 @@ void xor_mem(
 
 #ifdef LEO_M1_OPT
 
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void xor_mem_2to1_avx2(
+    void * LEO_RESTRICT x,
+    const void * LEO_RESTRICT y,
+    const void * LEO_RESTRICT z,
+    uint64_t bytes)
+{
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
+    const LEO_M256 * LEO_RESTRICT z32 = reinterpret_cast<const LEO_M256 *>(z);
+    while (bytes >= 128)
+    {
+        LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32), _mm256_loadu_si256(y32));
+        x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
+        LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
+        LEO_M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
+        x2 = _mm256_xor_si256(x2, _mm256_loadu_si256(z32 + 2));
+        LEO_M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
+        x3 = _mm256_xor_si256(x3, _mm256_loadu_si256(z32 + 3));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+        _mm256_storeu_si256(x32 + 2, x2);
+        _mm256_storeu_si256(x32 + 3, x3);
+        x32 += 4, y32 += 4, z32 += 4;
+        bytes -= 128;
+    };
+
+    if (bytes > 0)
+    {
+        LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
+        LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+    }
+}
+#endif // LEO_TRY_AVX2
+
 void xor_mem_2to1(
     void * LEO_RESTRICT x,
     const void * LEO_RESTRICT y,
@@ -215,37 +284,7 @@ void xor_mem_2to1(
 #if defined(LEO_TRY_AVX2)
     if (CpuHasAVX2)
     {
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
-        const LEO_M256 * LEO_RESTRICT z32 = reinterpret_cast<const LEO_M256 *>(z);
-        while (bytes >= 128)
-        {
-            LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32), _mm256_loadu_si256(y32));
-            x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
-            LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
-            LEO_M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
-            x2 = _mm256_xor_si256(x2, _mm256_loadu_si256(z32 + 2));
-            LEO_M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
-            x3 = _mm256_xor_si256(x3, _mm256_loadu_si256(z32 + 3));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-            _mm256_storeu_si256(x32 + 2, x2);
-            _mm256_storeu_si256(x32 + 3, x3);
-            x32 += 4, y32 += 4, z32 += 4;
-            bytes -= 128;
-        };
-
-        if (bytes > 0)
-        {
-            LEO_M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
-            LEO_M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-        }
-
+        xor_mem_2to1_avx2(x, y, z, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -276,6 +315,84 @@ void xor_mem_2to1(
 
 #ifdef LEO_USE_VECTOR4_OPT
 
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void xor_mem4_avx2(
+    void * LEO_RESTRICT vx_0, const void * LEO_RESTRICT vy_0,
+    void * LEO_RESTRICT vx_1, const void * LEO_RESTRICT vy_1,
+    void * LEO_RESTRICT vx_2, const void * LEO_RESTRICT vy_2,
+    void * LEO_RESTRICT vx_3, const void * LEO_RESTRICT vy_3,
+    uint64_t bytes)
+{
+    LEO_M256 * LEO_RESTRICT       x32_0 = reinterpret_cast<LEO_M256 *>      (vx_0);
+    const LEO_M256 * LEO_RESTRICT y32_0 = reinterpret_cast<const LEO_M256 *>(vy_0);
+    LEO_M256 * LEO_RESTRICT       x32_1 = reinterpret_cast<LEO_M256 *>      (vx_1);
+    const LEO_M256 * LEO_RESTRICT y32_1 = reinterpret_cast<const LEO_M256 *>(vy_1);
+    LEO_M256 * LEO_RESTRICT       x32_2 = reinterpret_cast<LEO_M256 *>      (vx_2);
+    const LEO_M256 * LEO_RESTRICT y32_2 = reinterpret_cast<const LEO_M256 *>(vy_2);
+    LEO_M256 * LEO_RESTRICT       x32_3 = reinterpret_cast<LEO_M256 *>      (vx_3);
+    const LEO_M256 * LEO_RESTRICT y32_3 = reinterpret_cast<const LEO_M256 *>(vy_3);
+    while (bytes >= 128)
+    {
+        const LEO_M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
+        const LEO_M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
+        const LEO_M256 x2_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 2), _mm256_loadu_si256(y32_0 + 2));
+        const LEO_M256 x3_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 3), _mm256_loadu_si256(y32_0 + 3));
+        _mm256_storeu_si256(x32_0, x0_0);
+        _mm256_storeu_si256(x32_0 + 1, x1_0);
+        _mm256_storeu_si256(x32_0 + 2, x2_0);
+        _mm256_storeu_si256(x32_0 + 3, x3_0);
+        x32_0 += 4, y32_0 += 4;
+        const LEO_M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
+        const LEO_M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
+        const LEO_M256 x2_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 2), _mm256_loadu_si256(y32_1 + 2));
+        const LEO_M256 x3_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 3), _mm256_loadu_si256(y32_1 + 3));
+        _mm256_storeu_si256(x32_1, x0_1);
+        _mm256_storeu_si256(x32_1 + 1, x1_1);
+        _mm256_storeu_si256(x32_1 + 2, x2_1);
+        _mm256_storeu_si256(x32_1 + 3, x3_1);
+        x32_1 += 4, y32_1 += 4;
+        const LEO_M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
+        const LEO_M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
+        const LEO_M256 x2_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 2), _mm256_loadu_si256(y32_2 + 2));
+        const LEO_M256 x3_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 3), _mm256_loadu_si256(y32_2 + 3));
+        _mm256_storeu_si256(x32_2, x0_2);
+        _mm256_storeu_si256(x32_2 + 1, x1_2);
+        _mm256_storeu_si256(x32_2 + 2, x2_2);
+        _mm256_storeu_si256(x32_2 + 3, x3_2);
+        x32_2 += 4, y32_2 += 4;
+        const LEO_M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
+        const LEO_M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
+        const LEO_M256 x2_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 2), _mm256_loadu_si256(y32_3 + 2));
+        const LEO_M256 x3_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 3), _mm256_loadu_si256(y32_3 + 3));
+        _mm256_storeu_si256(x32_3,     x0_3);
+        _mm256_storeu_si256(x32_3 + 1, x1_3);
+        _mm256_storeu_si256(x32_3 + 2, x2_3);
+        _mm256_storeu_si256(x32_3 + 3, x3_3);
+        x32_3 += 4, y32_3 += 4;
+        bytes -= 128;
+    }
+    if (bytes > 0)
+    {
+        const LEO_M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
+        const LEO_M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
+        const LEO_M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
+        const LEO_M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
+        _mm256_storeu_si256(x32_0, x0_0);
+        _mm256_storeu_si256(x32_0 + 1, x1_0);
+        _mm256_storeu_si256(x32_1, x0_1);
+        _mm256_storeu_si256(x32_1 + 1, x1_1);
+        const LEO_M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
+        const LEO_M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
+        const LEO_M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
+        const LEO_M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
+        _mm256_storeu_si256(x32_2,     x0_2);
+        _mm256_storeu_si256(x32_2 + 1, x1_2);
+        _mm256_storeu_si256(x32_3,     x0_3);
+        _mm256_storeu_si256(x32_3 + 1, x1_3);
+    }
+}
+#endif // LEO_TRY_AVX2
+
 void xor_mem4(
     void * LEO_RESTRICT vx_0, const void * LEO_RESTRICT vy_0,
     void * LEO_RESTRICT vx_1, const void * LEO_RESTRICT vy_1,
@@ -286,73 +403,7 @@ void xor_mem4(
 #if defined(LEO_TRY_AVX2)
     if (CpuHasAVX2)
     {
-        LEO_M256 * LEO_RESTRICT       x32_0 = reinterpret_cast<LEO_M256 *>      (vx_0);
-        const LEO_M256 * LEO_RESTRICT y32_0 = reinterpret_cast<const LEO_M256 *>(vy_0);
-        LEO_M256 * LEO_RESTRICT       x32_1 = reinterpret_cast<LEO_M256 *>      (vx_1);
-        const LEO_M256 * LEO_RESTRICT y32_1 = reinterpret_cast<const LEO_M256 *>(vy_1);
-        LEO_M256 * LEO_RESTRICT       x32_2 = reinterpret_cast<LEO_M256 *>      (vx_2);
-        const LEO_M256 * LEO_RESTRICT y32_2 = reinterpret_cast<const LEO_M256 *>(vy_2);
-        LEO_M256 * LEO_RESTRICT       x32_3 = reinterpret_cast<LEO_M256 *>      (vx_3);
-        const LEO_M256 * LEO_RESTRICT y32_3 = reinterpret_cast<const LEO_M256 *>(vy_3);
-        while (bytes >= 128)
-        {
-            const LEO_M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
-            const LEO_M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
-            const LEO_M256 x2_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 2), _mm256_loadu_si256(y32_0 + 2));
-            const LEO_M256 x3_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 3), _mm256_loadu_si256(y32_0 + 3));
-            _mm256_storeu_si256(x32_0, x0_0);
-            _mm256_storeu_si256(x32_0 + 1, x1_0);
-            _mm256_storeu_si256(x32_0 + 2, x2_0);
-            _mm256_storeu_si256(x32_0 + 3, x3_0);
-            x32_0 += 4, y32_0 += 4;
-            const LEO_M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
-            const LEO_M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
-            const LEO_M256 x2_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 2), _mm256_loadu_si256(y32_1 + 2));
-            const LEO_M256 x3_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 3), _mm256_loadu_si256(y32_1 + 3));
-            _mm256_storeu_si256(x32_1, x0_1);
-            _mm256_storeu_si256(x32_1 + 1, x1_1);
-            _mm256_storeu_si256(x32_1 + 2, x2_1);
-            _mm256_storeu_si256(x32_1 + 3, x3_1);
-            x32_1 += 4, y32_1 += 4;
-            const LEO_M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
-            const LEO_M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
-            const LEO_M256 x2_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 2), _mm256_loadu_si256(y32_2 + 2));
-            const LEO_M256 x3_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 3), _mm256_loadu_si256(y32_2 + 3));
-            _mm256_storeu_si256(x32_2, x0_2);
-            _mm256_storeu_si256(x32_2 + 1, x1_2);
-            _mm256_storeu_si256(x32_2 + 2, x2_2);
-            _mm256_storeu_si256(x32_2 + 3, x3_2);
-            x32_2 += 4, y32_2 += 4;
-            const LEO_M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
-            const LEO_M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
-            const LEO_M256 x2_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 2), _mm256_loadu_si256(y32_3 + 2));
-            const LEO_M256 x3_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 3), _mm256_loadu_si256(y32_3 + 3));
-            _mm256_storeu_si256(x32_3,     x0_3);
-            _mm256_storeu_si256(x32_3 + 1, x1_3);
-            _mm256_storeu_si256(x32_3 + 2, x2_3);
-            _mm256_storeu_si256(x32_3 + 3, x3_3);
-            x32_3 += 4, y32_3 += 4;
-            bytes -= 128;
-        }
-        if (bytes > 0)
-        {
-            const LEO_M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
-            const LEO_M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
-            const LEO_M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
-            const LEO_M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
-            _mm256_storeu_si256(x32_0, x0_0);
-            _mm256_storeu_si256(x32_0 + 1, x1_0);
-            _mm256_storeu_si256(x32_1, x0_1);
-            _mm256_storeu_si256(x32_1 + 1, x1_1);
-            const LEO_M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
-            const LEO_M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
-            const LEO_M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
-            const LEO_M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
-            _mm256_storeu_si256(x32_2,     x0_2);
-            _mm256_storeu_si256(x32_2 + 1, x1_2);
-            _mm256_storeu_si256(x32_3,     x0_3);
-            _mm256_storeu_si256(x32_3 + 1, x1_3);
-        }
+        xor_mem4_avx2(vx_0, vy_0, vx_1, vy_1, vx_2, vy_2, vx_3, vy_3, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -249,7 +249,9 @@
     #define LEO_TARGET_MOBILE
 #endif // ANDROID
 
-#if defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900)
+// GCC and Clang compile AVX2 code per function, and it's selected at runtime.
+#if defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900) || \
+    ((defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)))
     #define LEO_TRY_AVX2 /* 256-bit */
     #include <immintrin.h>
     #define LEO_ALIGN_BYTES 32
@@ -257,6 +259,15 @@
     #define LEO_ALIGN_BYTES 16
 #endif // __AVX2__
 
+// Function attributes to enable instruction sets without global compiler flags
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define LEO_TARGET_AVX2 __attribute__((target("avx2")))
+    #define LEO_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+    #define LEO_TARGET_AVX2
+    #define LEO_TARGET_SSSE3
+#endif
+
 #if !defined(LEO_TARGET_MOBILE)
     // Note: MSVC currently only supports SSSE3 but not AVX2
     #include <tmmintrin.h> // SSSE3: _mm_shuffle_epi8
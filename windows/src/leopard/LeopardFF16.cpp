@@ -439,10 +439,11 @@ static void InitializeMultiplyTables()
 #if defined(LEO_TRY_AVX2)
             if (CpuHasAVX2)
             {
-                _mm256_storeu_si256((LEO_M256*)&Multiply256LUT[log_m].Lo[i],
-                    _mm256_broadcastsi128_si256(value_lo));
-                _mm256_storeu_si256((LEO_M256*)&Multiply256LUT[log_m].Hi[i],
-                    _mm256_broadcastsi128_si256(value_hi));
+                // Same value in both 128-bit lanes, which doesn't require AVX2 instructions.
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Lo[i], value_lo);
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Lo[i] + 1, value_lo);
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Hi[i], value_hi);
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Hi[i] + 1, value_hi);
             }
 #endif // LEO_TRY_AVX2
         }
@@ -450,36 +451,44 @@ static void InitializeMultiplyTables()
 }
 
 
-static void mul_mem(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void mul_mem_avx2(
     void * LEO_RESTRICT x, const void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        LEO_MUL_TABLES_256(0, log_m);
+    LEO_MUL_TABLES_256(0, log_m);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_MUL_256_LS(x_ptr, y_ptr) { \
-            const LEO_M256 data_lo = _mm256_loadu_si256(y_ptr); \
-            const LEO_M256 data_hi = _mm256_loadu_si256(y_ptr + 1); \
-            LEO_M256 prod_lo, prod_hi; \
-            LEO_MUL_256(data_lo, data_hi, 0); \
-            _mm256_storeu_si256(x_ptr, prod_lo); \
-            _mm256_storeu_si256(x_ptr + 1, prod_hi); }
+        const LEO_M256 data_lo = _mm256_loadu_si256(y_ptr); \
+        const LEO_M256 data_hi = _mm256_loadu_si256(y_ptr + 1); \
+        LEO_M256 prod_lo, prod_hi; \
+        LEO_MUL_256(data_lo, data_hi, 0); \
+        _mm256_storeu_si256(x_ptr, prod_lo); \
+        _mm256_storeu_si256(x_ptr + 1, prod_hi); }
 
-            LEO_MUL_256_LS(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_MUL_256_LS(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+static LEO_TARGET_SSSE3 void mul_mem(
+    void * LEO_RESTRICT x, const void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        mul_mem_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -625,42 +634,50 @@ static void FFTInitialize()
         {1-5, 1'-5', 1-1', 5-5'},
 */
 
-// 2-way butterfly
-static void IFFT_DIT2(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT2_avx2(
     void * LEO_RESTRICT x, void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        LEO_MUL_TABLES_256(0, log_m);
+    LEO_MUL_TABLES_256(0, log_m);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_IFFTB_256(x_ptr, y_ptr) { \
-            LEO_M256 x_lo = _mm256_loadu_si256(x_ptr); \
-            LEO_M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
-            LEO_M256 y_lo = _mm256_loadu_si256(y_ptr); \
-            LEO_M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
-            y_lo = _mm256_xor_si256(y_lo, x_lo); \
-            y_hi = _mm256_xor_si256(y_hi, x_hi); \
-            _mm256_storeu_si256(y_ptr, y_lo); \
-            _mm256_storeu_si256(y_ptr + 1, y_hi); \
-            LEO_MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
-            _mm256_storeu_si256(x_ptr, x_lo); \
-            _mm256_storeu_si256(x_ptr + 1, x_hi); }
-
-            LEO_IFFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        LEO_M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        LEO_M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        LEO_M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr, y_lo); \
+        _mm256_storeu_si256(y_ptr + 1, y_hi); \
+        LEO_MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr, x_lo); \
+        _mm256_storeu_si256(x_ptr + 1, x_hi); }
+
+        LEO_IFFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+// 2-way butterfly
+static LEO_TARGET_SSSE3 void IFFT_DIT2(
+    void * LEO_RESTRICT x, void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT2_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -705,8 +722,8 @@ static void IFFT_DIT2(
 }
 
 
-// 4-way butterfly
-static void IFFT_DIT4(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT4_avx2(
     uint64_t bytes,
     void** work,
     unsigned dist,
@@ -714,71 +731,83 @@ static void IFFT_DIT4(
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
+    LEO_MUL_TABLES_256(01, log_m01);
+    LEO_MUL_TABLES_256(23, log_m23);
+    LEO_MUL_TABLES_256(02, log_m02);
 
-#if defined(LEO_TRY_AVX2)
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-    if (CpuHasAVX2)
-    {
-        LEO_MUL_TABLES_256(01, log_m01);
-        LEO_MUL_TABLES_256(23, log_m23);
-        LEO_MUL_TABLES_256(02, log_m02);
+    LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
+    LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
+    LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
+    LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    do
+    {
+        LEO_M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+        LEO_M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+        LEO_M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+        LEO_M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+
+        // First layer:
+        work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+        work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+        if (log_m01 != kModulus)
+            LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+
+        LEO_M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+        LEO_M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+        LEO_M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+        LEO_M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+        work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+        work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+        if (log_m23 != kModulus)
+            LEO_MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+
+        // Second layer:
+        work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+        work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+        work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+        work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+        if (log_m02 != kModulus)
+        {
+            LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+            LEO_MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+        }
 
-        LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
-        LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
-        LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
-        LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
+        _mm256_storeu_si256(work0, work_reg_lo_0);
+        _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
+        _mm256_storeu_si256(work1, work_reg_lo_1);
+        _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
+        _mm256_storeu_si256(work2, work_reg_lo_2);
+        _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
+        _mm256_storeu_si256(work3, work_reg_lo_3);
+        _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
 
-        do
-        {
-            LEO_M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
-            LEO_M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
-            LEO_M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
-            LEO_M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
-
-            // First layer:
-            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
-            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
-            if (log_m01 != kModulus)
-                LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
-
-            LEO_M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
-            LEO_M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
-            LEO_M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
-            LEO_M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
-
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
-            if (log_m23 != kModulus)
-                LEO_MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
-
-            // Second layer:
-            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
-            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
-            if (log_m02 != kModulus)
-            {
-                LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
-                LEO_MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
-            }
+        work0 += 2, work1 += 2, work2 += 2, work3 += 2;
 
-            _mm256_storeu_si256(work0, work_reg_lo_0);
-            _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
-            _mm256_storeu_si256(work1, work_reg_lo_1);
-            _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
-            _mm256_storeu_si256(work2, work_reg_lo_2);
-            _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
-            _mm256_storeu_si256(work3, work_reg_lo_3);
-            _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
-            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+// 4-way butterfly
+static LEO_TARGET_SSSE3 void IFFT_DIT4(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
 
-            bytes -= 64;
-        } while (bytes > 0);
+#if defined(LEO_TRY_AVX2)
 
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT4_avx2(bytes, work, dist, log_m01, log_m23, log_m02);
         return;
     }
 
@@ -1079,42 +1108,50 @@ static void IFFT_DIT_Decoder(
         {4-6, 5-7, 4-5, 6-7},
 */
 
-// 2-way butterfly
-static void FFT_DIT2(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void FFT_DIT2_avx2(
     void * LEO_RESTRICT x, void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        LEO_MUL_TABLES_256(0, log_m);
+    LEO_MUL_TABLES_256(0, log_m);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_FFTB_256(x_ptr, y_ptr) { \
-            LEO_M256 x_lo = _mm256_loadu_si256(x_ptr); \
-            LEO_M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
-            LEO_M256 y_lo = _mm256_loadu_si256(y_ptr); \
-            LEO_M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
-            LEO_MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
-            _mm256_storeu_si256(x_ptr, x_lo); \
-            _mm256_storeu_si256(x_ptr + 1, x_hi); \
-            y_lo = _mm256_xor_si256(y_lo, x_lo); \
-            y_hi = _mm256_xor_si256(y_hi, x_hi); \
-            _mm256_storeu_si256(y_ptr, y_lo); \
-            _mm256_storeu_si256(y_ptr + 1, y_hi); }
-
-            LEO_FFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        LEO_M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        LEO_M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        LEO_M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        LEO_MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr, x_lo); \
+        _mm256_storeu_si256(x_ptr + 1, x_hi); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr, y_lo); \
+        _mm256_storeu_si256(y_ptr + 1, y_hi); }
+
+        LEO_FFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+// 2-way butterfly
+static LEO_TARGET_SSSE3 void FFT_DIT2(
+    void * LEO_RESTRICT x, void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        FFT_DIT2_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -1159,8 +1196,8 @@ static void FFT_DIT2(
 }
 
 
-// 4-way butterfly
-static void FFT_DIT4(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void FFT_DIT4_avx2(
     uint64_t bytes,
     void** work,
     unsigned dist,
@@ -1168,71 +1205,83 @@ static void FFT_DIT4(
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
+    LEO_MUL_TABLES_256(01, log_m01);
+    LEO_MUL_TABLES_256(23, log_m23);
+    LEO_MUL_TABLES_256(02, log_m02);
 
-#if defined(LEO_TRY_AVX2)
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-    if (CpuHasAVX2)
-    {
-        LEO_MUL_TABLES_256(01, log_m01);
-        LEO_MUL_TABLES_256(23, log_m23);
-        LEO_MUL_TABLES_256(02, log_m02);
+    LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
+    LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
+    LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
+    LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
-
-        LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
-        LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
-        LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
-        LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
-
-        do
+    do
+    {
+        LEO_M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+        LEO_M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+        LEO_M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+        LEO_M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+        LEO_M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+        LEO_M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+        LEO_M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+        LEO_M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+        // First layer:
+        if (log_m02 != kModulus)
         {
-            LEO_M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
-            LEO_M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
-            LEO_M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
-            LEO_M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
-            LEO_M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
-            LEO_M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
-            LEO_M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
-            LEO_M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
-
-            // First layer:
-            if (log_m02 != kModulus)
-            {
-                LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
-                LEO_MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
-            }
-            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
-            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
-
-            // Second layer:
-            if (log_m01 != kModulus)
-                LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
-            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
-            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
-
-            _mm256_storeu_si256(work0, work_reg_lo_0);
-            _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
-            _mm256_storeu_si256(work1, work_reg_lo_1);
-            _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
-
-            if (log_m23 != kModulus)
-                LEO_MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
-
-            _mm256_storeu_si256(work2, work_reg_lo_2);
-            _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
-            _mm256_storeu_si256(work3, work_reg_lo_3);
-            _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
+            LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+            LEO_MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+        }
+        work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+        work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+        work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+        work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+
+        // Second layer:
+        if (log_m01 != kModulus)
+            LEO_MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+        work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+        work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+
+        _mm256_storeu_si256(work0, work_reg_lo_0);
+        _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
+        _mm256_storeu_si256(work1, work_reg_lo_1);
+        _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
+
+        if (log_m23 != kModulus)
+            LEO_MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+        work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+        work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+
+        _mm256_storeu_si256(work2, work_reg_lo_2);
+        _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
+        _mm256_storeu_si256(work3, work_reg_lo_3);
+        _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
+
+        work0 += 2, work1 += 2, work2 += 2, work3 += 2;
 
-            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
-            bytes -= 64;
-        } while (bytes > 0);
+// 4-way butterfly
+static LEO_TARGET_SSSE3 void FFT_DIT4(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
 
+#if defined(LEO_TRY_AVX2)
+
+    if (CpuHasAVX2)
+    {
+        FFT_DIT4_avx2(bytes, work, dist, log_m01, log_m23, log_m02);
         return;
     }
 
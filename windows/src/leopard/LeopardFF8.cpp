@@ -399,8 +399,9 @@ static void InitializeMultiplyTables()
 #if defined(LEO_TRY_AVX2)
             if (CpuHasAVX2)
             {
-                _mm256_storeu_si256((LEO_M256*)&Multiply256LUT[log_m].Value[i],
-                    _mm256_broadcastsi128_si256(value));
+                // Same value in both 128-bit lanes, which doesn't require AVX2 instructions.
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Value[i], value);
+                _mm_storeu_si128((LEO_M128*)&Multiply256LUT[log_m].Value[i] + 1, value);
             }
 #endif // LEO_TRY_AVX2
         }
@@ -408,39 +409,47 @@ static void InitializeMultiplyTables()
 }
 
 
-static void mul_mem(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void mul_mem_avx2(
     void * LEO_RESTRICT x, const void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+    const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    const LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<const LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_MUL_256(x_ptr, y_ptr) { \
-            LEO_M256 data = _mm256_loadu_si256(y_ptr); \
-            LEO_M256 lo = _mm256_and_si256(data, clr_mask); \
-            lo = _mm256_shuffle_epi8(table_lo_y, lo); \
-            LEO_M256 hi = _mm256_srli_epi64(data, 4); \
-            hi = _mm256_and_si256(hi, clr_mask); \
-            hi = _mm256_shuffle_epi8(table_hi_y, hi); \
-            _mm256_storeu_si256(x_ptr, _mm256_xor_si256(lo, hi)); }
-
-            LEO_MUL_256(x32 + 1, y32 + 1);
-            LEO_MUL_256(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_M256 data = _mm256_loadu_si256(y_ptr); \
+        LEO_M256 lo = _mm256_and_si256(data, clr_mask); \
+        lo = _mm256_shuffle_epi8(table_lo_y, lo); \
+        LEO_M256 hi = _mm256_srli_epi64(data, 4); \
+        hi = _mm256_and_si256(hi, clr_mask); \
+        hi = _mm256_shuffle_epi8(table_hi_y, hi); \
+        _mm256_storeu_si256(x_ptr, _mm256_xor_si256(lo, hi)); }
+
+        LEO_MUL_256(x32 + 1, y32 + 1);
+        LEO_MUL_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+static LEO_TARGET_SSSE3 void mul_mem(
+    void * LEO_RESTRICT x, const void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        mul_mem_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -591,39 +600,47 @@ static void FFTInitialize()
         {1-5, 1'-5', 1-1', 5-5'},
 */
 
-// 2-way butterfly
-static void IFFT_DIT2(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT2_avx2(
     void * LEO_RESTRICT x, void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+    const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_IFFTB_256(x_ptr, y_ptr) { \
-            LEO_M256 x_data = _mm256_loadu_si256(x_ptr); \
-            LEO_M256 y_data = _mm256_loadu_si256(y_ptr); \
-            y_data = _mm256_xor_si256(y_data, x_data); \
-            _mm256_storeu_si256(y_ptr, y_data); \
-            LEO_MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
-            _mm256_storeu_si256(x_ptr, x_data); }
+        LEO_M256 x_data = _mm256_loadu_si256(x_ptr); \
+        LEO_M256 y_data = _mm256_loadu_si256(y_ptr); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        _mm256_storeu_si256(y_ptr, y_data); \
+        LEO_MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
+        _mm256_storeu_si256(x_ptr, x_data); }
 
-            LEO_IFFTB_256(x32 + 1, y32 + 1);
-            LEO_IFFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_IFFTB_256(x32 + 1, y32 + 1);
+        LEO_IFFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+// 2-way butterfly
+static LEO_TARGET_SSSE3 void IFFT_DIT2(
+    void * LEO_RESTRICT x, void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT2_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -666,8 +683,8 @@ static void IFFT_DIT2(
 }
 
 
-// 4-way butterfly
-static void IFFT_DIT4(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT4_avx2(
     uint64_t bytes,
     void** work,
     unsigned dist,
@@ -675,61 +692,73 @@ static void IFFT_DIT4(
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
+    const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
 
-#if defined(LEO_TRY_AVX2)
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-    if (CpuHasAVX2)
+    LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
+    LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
+    LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
+    LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
+
+    do
     {
-        const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+        // First layer:
+        LEO_M256 work0_reg = _mm256_loadu_si256(work0);
+        LEO_M256 work1_reg = _mm256_loadu_si256(work1);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+        work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+        if (log_m01 != kModulus)
+            LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
 
-        LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
-        LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
-        LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
-        LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
+        LEO_M256 work2_reg = _mm256_loadu_si256(work2);
+        LEO_M256 work3_reg = _mm256_loadu_si256(work3);
 
-        do
-        {
-            // First layer:
-            LEO_M256 work0_reg = _mm256_loadu_si256(work0);
-            LEO_M256 work1_reg = _mm256_loadu_si256(work1);
-
-            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
-                LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
+        work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+        if (log_m23 != kModulus)
+            LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
 
-            LEO_M256 work2_reg = _mm256_loadu_si256(work2);
-            LEO_M256 work3_reg = _mm256_loadu_si256(work3);
+        // Second layer:
+        work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+        work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+        if (log_m02 != kModulus)
+        {
+            LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
+            LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
+        }
 
-            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
-                LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
+        _mm256_storeu_si256(work0, work0_reg);
+        _mm256_storeu_si256(work1, work1_reg);
+        _mm256_storeu_si256(work2, work2_reg);
+        _mm256_storeu_si256(work3, work3_reg);
+        work0++, work1++, work2++, work3++;
 
-            // Second layer:
-            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
-            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
-            {
-                LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
-                LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
-            }
+        bytes -= 32;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
-            _mm256_storeu_si256(work0, work0_reg);
-            _mm256_storeu_si256(work1, work1_reg);
-            _mm256_storeu_si256(work2, work2_reg);
-            _mm256_storeu_si256(work3, work3_reg);
-            work0++, work1++, work2++, work3++;
+// 4-way butterfly
+static LEO_TARGET_SSSE3 void IFFT_DIT4(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
 
-            bytes -= 32;
-        } while (bytes > 0);
+#if defined(LEO_TRY_AVX2)
 
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT4_avx2(bytes, work, dist, log_m01, log_m23, log_m02);
         return;
     }
 
@@ -816,46 +845,55 @@ static void IFFT_DIT4(
 }
 
 
-// {x_out, y_out} ^= IFFT_DIT2( {x_in, y_in} )
-static void IFFT_DIT2_xor(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT2_xor_avx2(
     void * LEO_RESTRICT x_in, void * LEO_RESTRICT y_in,
     void * LEO_RESTRICT x_out, void * LEO_RESTRICT y_out,
     const ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+    const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        const LEO_M256 * LEO_RESTRICT x32_in = reinterpret_cast<const LEO_M256 *>(x_in);
-        const LEO_M256 * LEO_RESTRICT y32_in = reinterpret_cast<const LEO_M256 *>(y_in);
-        LEO_M256 * LEO_RESTRICT x32_out = reinterpret_cast<LEO_M256 *>(x_out);
-        LEO_M256 * LEO_RESTRICT y32_out = reinterpret_cast<LEO_M256 *>(y_out);
+    const LEO_M256 * LEO_RESTRICT x32_in = reinterpret_cast<const LEO_M256 *>(x_in);
+    const LEO_M256 * LEO_RESTRICT y32_in = reinterpret_cast<const LEO_M256 *>(y_in);
+    LEO_M256 * LEO_RESTRICT x32_out = reinterpret_cast<LEO_M256 *>(x_out);
+    LEO_M256 * LEO_RESTRICT y32_out = reinterpret_cast<LEO_M256 *>(y_out);
 
-        do
-        {
+    do
+    {
 #define LEO_IFFTB_256_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
-            LEO_M256 x_data_out = _mm256_loadu_si256(x_ptr_out); \
-            LEO_M256 y_data_out = _mm256_loadu_si256(y_ptr_out); \
-            LEO_M256 x_data_in = _mm256_loadu_si256(x_ptr_in); \
-            LEO_M256 y_data_in = _mm256_loadu_si256(y_ptr_in); \
-            y_data_in = _mm256_xor_si256(y_data_in, x_data_in); \
-            y_data_out = _mm256_xor_si256(y_data_out, y_data_in); \
-            _mm256_storeu_si256(y_ptr_out, y_data_out); \
-            LEO_MULADD_256(x_data_in, y_data_in, table_lo_y, table_hi_y); \
-            x_data_out = _mm256_xor_si256(x_data_out, x_data_in); \
-            _mm256_storeu_si256(x_ptr_out, x_data_out); }
-
-            LEO_IFFTB_256_XOR(x32_in + 1, y32_in + 1, x32_out + 1, y32_out + 1);
-            LEO_IFFTB_256_XOR(x32_in, y32_in, x32_out, y32_out);
-            y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
+        LEO_M256 x_data_out = _mm256_loadu_si256(x_ptr_out); \
+        LEO_M256 y_data_out = _mm256_loadu_si256(y_ptr_out); \
+        LEO_M256 x_data_in = _mm256_loadu_si256(x_ptr_in); \
+        LEO_M256 y_data_in = _mm256_loadu_si256(y_ptr_in); \
+        y_data_in = _mm256_xor_si256(y_data_in, x_data_in); \
+        y_data_out = _mm256_xor_si256(y_data_out, y_data_in); \
+        _mm256_storeu_si256(y_ptr_out, y_data_out); \
+        LEO_MULADD_256(x_data_in, y_data_in, table_lo_y, table_hi_y); \
+        x_data_out = _mm256_xor_si256(x_data_out, x_data_in); \
+        _mm256_storeu_si256(x_ptr_out, x_data_out); }
+
+        LEO_IFFTB_256_XOR(x32_in + 1, y32_in + 1, x32_out + 1, y32_out + 1);
+        LEO_IFFTB_256_XOR(x32_in, y32_in, x32_out, y32_out);
+        y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+// {x_out, y_out} ^= IFFT_DIT2( {x_in, y_in} )
+static LEO_TARGET_SSSE3 void IFFT_DIT2_xor(
+    void * LEO_RESTRICT x_in, void * LEO_RESTRICT y_in,
+    void * LEO_RESTRICT x_out, void * LEO_RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT2_xor_avx2(x_in, y_in, x_out, y_out, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -906,8 +944,8 @@ static void IFFT_DIT2_xor(
 }
 
 
-// xor_result ^= IFFT_DIT4(work)
-static void IFFT_DIT4_xor(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void IFFT_DIT4_xor_avx2(
     uint64_t bytes,
     void** work_in,
     void** xor_out,
@@ -916,72 +954,85 @@ static void IFFT_DIT4_xor(
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
-
-#if defined(LEO_TRY_AVX2)
+    const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    const LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<const LEO_M256 *>(work_in[0]);
+    const LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<const LEO_M256 *>(work_in[dist]);
+    const LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<const LEO_M256 *>(work_in[dist * 2]);
+    const LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<const LEO_M256 *>(work_in[dist * 3]);
+    LEO_M256 * LEO_RESTRICT xor0 = reinterpret_cast<LEO_M256 *>(xor_out[0]);
+    LEO_M256 * LEO_RESTRICT xor1 = reinterpret_cast<LEO_M256 *>(xor_out[dist]);
+    LEO_M256 * LEO_RESTRICT xor2 = reinterpret_cast<LEO_M256 *>(xor_out[dist * 2]);
+    LEO_M256 * LEO_RESTRICT xor3 = reinterpret_cast<LEO_M256 *>(xor_out[dist * 3]);
 
-    if (CpuHasAVX2)
+    do
     {
-        const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
-
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
-
-        const LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<const LEO_M256 *>(work_in[0]);
-        const LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<const LEO_M256 *>(work_in[dist]);
-        const LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<const LEO_M256 *>(work_in[dist * 2]);
-        const LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<const LEO_M256 *>(work_in[dist * 3]);
-        LEO_M256 * LEO_RESTRICT xor0 = reinterpret_cast<LEO_M256 *>(xor_out[0]);
-        LEO_M256 * LEO_RESTRICT xor1 = reinterpret_cast<LEO_M256 *>(xor_out[dist]);
-        LEO_M256 * LEO_RESTRICT xor2 = reinterpret_cast<LEO_M256 *>(xor_out[dist * 2]);
-        LEO_M256 * LEO_RESTRICT xor3 = reinterpret_cast<LEO_M256 *>(xor_out[dist * 3]);
-
-        do
+        // First layer:
+        LEO_M256 work0_reg = _mm256_loadu_si256(work0);
+        LEO_M256 work1_reg = _mm256_loadu_si256(work1);
+        work0++, work1++;
+
+        work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+        if (log_m01 != kModulus)
+            LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
+
+        LEO_M256 work2_reg = _mm256_loadu_si256(work2);
+        LEO_M256 work3_reg = _mm256_loadu_si256(work3);
+        work2++, work3++;
+
+        work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+        if (log_m23 != kModulus)
+            LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
+
+        // Second layer:
+        work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+        work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+        if (log_m02 != kModulus)
         {
-            // First layer:
-            LEO_M256 work0_reg = _mm256_loadu_si256(work0);
-            LEO_M256 work1_reg = _mm256_loadu_si256(work1);
-            work0++, work1++;
-
-            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
-                LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
-
-            LEO_M256 work2_reg = _mm256_loadu_si256(work2);
-            LEO_M256 work3_reg = _mm256_loadu_si256(work3);
-            work2++, work3++;
+            LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
+            LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
+        }
 
-            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
-                LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
+        work0_reg = _mm256_xor_si256(work0_reg, _mm256_loadu_si256(xor0));
+        work1_reg = _mm256_xor_si256(work1_reg, _mm256_loadu_si256(xor1));
+        work2_reg = _mm256_xor_si256(work2_reg, _mm256_loadu_si256(xor2));
+        work3_reg = _mm256_xor_si256(work3_reg, _mm256_loadu_si256(xor3));
 
-            // Second layer:
-            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
-            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
-            {
-                LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
-                LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
-            }
+        _mm256_storeu_si256(xor0, work0_reg);
+        _mm256_storeu_si256(xor1, work1_reg);
+        _mm256_storeu_si256(xor2, work2_reg);
+        _mm256_storeu_si256(xor3, work3_reg);
+        xor0++, xor1++, xor2++, xor3++;
 
-            work0_reg = _mm256_xor_si256(work0_reg, _mm256_loadu_si256(xor0));
-            work1_reg = _mm256_xor_si256(work1_reg, _mm256_loadu_si256(xor1));
-            work2_reg = _mm256_xor_si256(work2_reg, _mm256_loadu_si256(xor2));
-            work3_reg = _mm256_xor_si256(work3_reg, _mm256_loadu_si256(xor3));
+        bytes -= 32;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
-            _mm256_storeu_si256(xor0, work0_reg);
-            _mm256_storeu_si256(xor1, work1_reg);
-            _mm256_storeu_si256(xor2, work2_reg);
-            _mm256_storeu_si256(xor3, work3_reg);
-            xor0++, xor1++, xor2++, xor3++;
+// xor_result ^= IFFT_DIT4(work)
+static LEO_TARGET_SSSE3 void IFFT_DIT4_xor(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
 
-            bytes -= 32;
-        } while (bytes > 0);
+#if defined(LEO_TRY_AVX2)
 
+    if (CpuHasAVX2)
+    {
+        IFFT_DIT4_xor_avx2(bytes, work_in, xor_out, dist, log_m01, log_m23, log_m02);
         return;
     }
 
@@ -1315,39 +1366,47 @@ static void IFFT_DIT_Decoder(
         {4-6, 5-7, 4-5, 6-7},
 */
 
-// 2-way butterfly
-static void FFT_DIT2(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void FFT_DIT2_avx2(
     void * LEO_RESTRICT x, void * LEO_RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+    const LEO_M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const LEO_M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
-        LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
+    LEO_M256 * LEO_RESTRICT x32 = reinterpret_cast<LEO_M256 *>(x);
+    LEO_M256 * LEO_RESTRICT y32 = reinterpret_cast<LEO_M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define LEO_FFTB_256(x_ptr, y_ptr) { \
-            LEO_M256 y_data = _mm256_loadu_si256(y_ptr); \
-            LEO_M256 x_data = _mm256_loadu_si256(x_ptr); \
-            LEO_MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
-            y_data = _mm256_xor_si256(y_data, x_data); \
-            _mm256_storeu_si256(x_ptr, x_data); \
-            _mm256_storeu_si256(y_ptr, y_data); }
+        LEO_M256 y_data = _mm256_loadu_si256(y_ptr); \
+        LEO_M256 x_data = _mm256_loadu_si256(x_ptr); \
+        LEO_MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        _mm256_storeu_si256(x_ptr, x_data); \
+        _mm256_storeu_si256(y_ptr, y_data); }
 
-            LEO_FFTB_256(x32 + 1, y32 + 1);
-            LEO_FFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        LEO_FFTB_256(x32 + 1, y32 + 1);
+        LEO_FFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
+// 2-way butterfly
+static LEO_TARGET_SSSE3 void FFT_DIT2(
+    void * LEO_RESTRICT x, void * LEO_RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        FFT_DIT2_avx2(x, y, log_m, bytes);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -1390,8 +1449,8 @@ static void FFT_DIT2(
 }
 
 
-// 4-way butterfly
-static void FFT_DIT4(
+#if defined(LEO_TRY_AVX2)
+static LEO_TARGET_AVX2 void FFT_DIT4_avx2(
     uint64_t bytes,
     void** work,
     unsigned dist,
@@ -1399,61 +1458,73 @@ static void FFT_DIT4(
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
+    const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
 
-#if defined(LEO_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const LEO_M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const LEO_M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const LEO_M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const LEO_M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const LEO_M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const LEO_M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+    const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        const LEO_M256 clr_mask = _mm256_set1_epi8(0x0f);
+    LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
+    LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
+    LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
+    LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
 
-        LEO_M256 * LEO_RESTRICT work0 = reinterpret_cast<LEO_M256 *>(work[0]);
-        LEO_M256 * LEO_RESTRICT work1 = reinterpret_cast<LEO_M256 *>(work[dist]);
-        LEO_M256 * LEO_RESTRICT work2 = reinterpret_cast<LEO_M256 *>(work[dist * 2]);
-        LEO_M256 * LEO_RESTRICT work3 = reinterpret_cast<LEO_M256 *>(work[dist * 3]);
+    do
+    {
+        LEO_M256 work0_reg = _mm256_loadu_si256(work0);
+        LEO_M256 work2_reg = _mm256_loadu_si256(work2);
+        LEO_M256 work1_reg = _mm256_loadu_si256(work1);
+        LEO_M256 work3_reg = _mm256_loadu_si256(work3);
 
-        do
+        // First layer:
+        if (log_m02 != kModulus)
         {
-            LEO_M256 work0_reg = _mm256_loadu_si256(work0);
-            LEO_M256 work2_reg = _mm256_loadu_si256(work2);
-            LEO_M256 work1_reg = _mm256_loadu_si256(work1);
-            LEO_M256 work3_reg = _mm256_loadu_si256(work3);
+            LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
+            LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
+        }
+        work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+        work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
 
-            // First layer:
-            if (log_m02 != kModulus)
-            {
-                LEO_MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
-                LEO_MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
-            }
-            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
-            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+        // Second layer:
+        if (log_m01 != kModulus)
+            LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
+        work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
 
-            // Second layer:
-            if (log_m01 != kModulus)
-                LEO_MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
-            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+        _mm256_storeu_si256(work0, work0_reg);
+        _mm256_storeu_si256(work1, work1_reg);
+        work0++, work1++;
 
-            _mm256_storeu_si256(work0, work0_reg);
-            _mm256_storeu_si256(work1, work1_reg);
-            work0++, work1++;
+        if (log_m23 != kModulus)
+            LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
+        work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
 
-            if (log_m23 != kModulus)
-                LEO_MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
-            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+        _mm256_storeu_si256(work2, work2_reg);
+        _mm256_storeu_si256(work3, work3_reg);
+        work2++, work3++;
 
-            _mm256_storeu_si256(work2, work2_reg);
-            _mm256_storeu_si256(work3, work3_reg);
-            work2++, work3++;
+        bytes -= 32;
+    } while (bytes > 0);
+}
+#endif // LEO_TRY_AVX2
 
-            bytes -= 32;
-        } while (bytes > 0);
+// 4-way butterfly
+static LEO_TARGET_SSSE3 void FFT_DIT4(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+#ifdef LEO_INTERLEAVE_BUTTERFLY4_OPT
 
+#if defined(LEO_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        FFT_DIT4_avx2(bytes, work, dist, log_m01, log_m23, log_m02);
         return;
     }
 #endif // LEO_TRY_AVX2
@@ -33,6 +33,9 @@
 
 #include "libpar3.h"
 #include "common.h"
+#include "map.h"
+#include "cache.h"
+#include "packet.h"
 
 
 #ifdef __linux__
@@ -1091,6 +1094,8 @@ int par_search(PAR3_CTX *par3_ctx, char *base_name, int flag_other)
 // This function releases all allocated memory.
 void par3_release(PAR3_CTX *par3_ctx)
 {
+	cache_release(par3_ctx);
+	release_packet_registry(par3_ctx);
 	if (par3_ctx->input_file_name){
 		free(par3_ctx->input_file_name);
 		par3_ctx->input_file_name = NULL;
@@ -1146,6 +1151,17 @@ void par3_release(PAR3_CTX *par3_ctx)
 	if (par3_ctx->crc_list){
 		free(par3_ctx->crc_list);
 		par3_ctx->crc_list = NULL;
+		par3_ctx->crc_filter = NULL;
+	}
+	if (par3_ctx->tail_list){
+		free(par3_ctx->tail_list);
+		par3_ctx->tail_list = NULL;
+		par3_ctx->tail_filter = NULL;
+	}
+	if (par3_ctx->tail_map_list){
+		free(par3_ctx->tail_map_list);
+		par3_ctx->tail_map_list = NULL;
+		par3_ctx->tail_map_count = 0;
 	}
 
 	if (par3_ctx->creator_packet){
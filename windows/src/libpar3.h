@@ -135,6 +135,9 @@ typedef struct {
 							// FAT Permissions Packet: 0x10000 = LastWriteTimestamp
 	uint32_t search_limit;	// how long time to slide search (milli second)
 	uint64_t memory_limit;	// how much memory to use (byte)
+	int thread_count;		// how many threads to use
+	char hash_cache_force;	// 'F' = ignore cached checksums, and calculate again
+	char packet_index;		// 'I' = keep positions of packets in index file
 
 	// For CRC-64 as rolling hash
 	uint64_t window_table[256];		// slide window search for block size
@@ -143,10 +146,17 @@ typedef struct {
 	uint64_t window_mask40;
 
 	uint8_t *work_buf;		// Working buffer for temporary usage
-	PAR3_CMP_CTX *crc_list;	// List of CRC-64 for slide window search
-	uint64_t crc_count;		// Number of CRC-64 in the list
+	PAR3_CMP_CTX *crc_list;	// Hash index of CRC-64 for slide window search
+	uint64_t crc_count;		// Number of CRC-64 in the index
+	uint64_t crc_mask;		// Number of slots - 1
+	uint64_t *crc_filter;	// Bitmap filter in front of the index
 	PAR3_CMP_CTX *tail_list;
 	uint64_t tail_count;
+	uint64_t tail_mask;
+	uint64_t *tail_filter;
+	PAR3_CMP_CTX *tail_map_list;	// Hash index of chunk tails while mapping input files
+	uint64_t tail_map_count;
+	uint64_t tail_map_mask;
 
 	uint8_t set_id[8];	// InputSetID
 	uint8_t attribute;	// attributes in Root Packet
@@ -180,6 +190,8 @@ typedef struct {
 
 	char base_path[_MAX_PATH];
 	char par_filename[_MAX_PATH];
+	char hash_cache_name[_MAX_PATH];	// File to keep checksums of input files
+	void *hash_cache;		// Loaded cache of checksums
 
 	uint64_t total_file_size;
 	uint64_t max_file_size;
@@ -252,6 +264,8 @@ typedef struct {
 	uint64_t data_packet_count;
 	PAR3_PKT_CTX *recv_packet_list;	// List of Recovery Data Packets
 	uint64_t recv_packet_count;
+	int recv_packet_lazy;			// 1 = data of Recovery Data Packets isn't checked yet
+	void *packet_registry;			// Hash index of found packets
 
 } PAR3_CTX;
 
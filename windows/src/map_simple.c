@@ -13,25 +13,294 @@
 #include "blake3/blake3.h"
 #include "libpar3.h"
 #include "hash.h"
+#include "map.h"
+#include "cache.h"
+#include "thread.h"
+
+
+// Arguments for multi-threading of file hashing
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	MAP_FILE_HASH *file_hash;
+	MAP_HASH_CTX *block_hash;
+	CACHE_KEY *key_list;	// identity of files for hash cache
+	uint32_t file_first;	// index of the first file in this round
+} MAP_HASH_RUN;
+
+// Copy checksums from hash cache. Return 1 when they are found.
+static int map_file_hash_cached(MAP_HASH_RUN *ctx, PAR3_FILE_CTX *file_p, MAP_FILE_HASH *hash_p, CACHE_KEY *key)
+{
+	uint64_t block_size;
+	CACHE_ENTRY *entry;
+
+	// When the file was changed after listing, it's not stored.
+	if ( (cache_key(file_p->name, key) != 0) || (key->size != file_p->size) ){
+		hash_p->cached = -1;
+		return 0;
+	}
+
+	block_size = ctx->par3_ctx->block_size;
+	entry = cache_find(ctx->par3_ctx, key, 2, block_size);
+	if (entry == NULL)
+		return 0;
+
+	file_p->crc = entry->crc;
+	memcpy(file_p->hash, entry->hash, 16);
+	hash_p->tail_crc = entry->tail_crc;
+	memcpy(&(hash_p->tail), &(entry->tail), sizeof(MAP_HASH_CTX));
+	memcpy(hash_p->tail_data, entry->tail_data, 40);
+	if (block_size > 0)
+		memcpy(ctx->block_hash + hash_p->block, entry + 1, sizeof(MAP_HASH_CTX) * (size_t)(file_p->size / block_size));
+	hash_p->cached = 1;
+
+	return 1;
+}
+
+// Read an input file, and calculate checksums of the file, full size blocks, and chunk tail.
+static void map_file_hash_task(void *arg, int index)
+{
+	MAP_HASH_RUN *ctx = arg;
+	uint8_t *work_buf;
+	uint64_t block_size, tail_size, file_offset, crc;
+	size_t buf_size;
+	PAR3_FILE_CTX *file_p;
+	MAP_FILE_HASH *hash_p;
+	MAP_HASH_CTX *block_p;
+	FILE *fp;
+	blake3_hasher hasher;
+
+	file_p = ctx->par3_ctx->input_file_list + ctx->file_first + index;
+	hash_p = ctx->file_hash + ctx->file_first + index;
+	block_p = ctx->block_hash + hash_p->block;
+	block_size = ctx->par3_ctx->block_size;
+
+	blake3_hasher_init(&hasher);
+	if (file_p->size == 0){	// Empty file
+		blake3_hasher_finalize(&hasher, file_p->hash, 16);
+		return;
+	}
+	if (ctx->key_list != NULL){
+		if (map_file_hash_cached(ctx, file_p, hash_p, ctx->key_list + ctx->file_first + index) != 0)
+			return;
+	}
+
+	// Small file doesn't need a full size buffer.
+	buf_size = (size_t)block_size;
+	if ( (block_size == 0) || (block_size > file_p->size) )
+		buf_size = (size_t)(file_p->size);
+	work_buf = malloc(buf_size);
+	if (work_buf == NULL){
+		perror("Failed to allocate memory for input data");
+		hash_p->ret = RET_MEMORY_ERROR;
+		return;
+	}
+
+	fp = fopen(file_p->name, "rb");
+	if (fp == NULL){
+		perror("Failed to open input file");
+		free(work_buf);
+		hash_p->ret = RET_FILE_IO_ERROR;
+		return;
+	}
+
+	// Read full size blocks
+	crc = file_p->crc;
+	file_offset = 0;
+	while ( (block_size > 0) && (file_offset + block_size <= file_p->size) ){
+		if (fread(work_buf, 1, (size_t)block_size, fp) != (size_t)block_size){
+			perror("Failed to read full size chunk on input file");
+			fclose(fp);
+			free(work_buf);
+			hash_p->ret = RET_FILE_IO_ERROR;
+			return;
+		}
+
+		// calculate CRC-64 of the first 16 KB
+		if (file_offset + block_size < 16384){
+			crc = crc64(work_buf, (size_t)block_size, crc);
+		} else if (file_offset < 16384){
+			crc = crc64(work_buf, (size_t)(16384 - file_offset), crc);
+		}
+		blake3_update(&hasher, work_buf, (size_t)block_size);
+
+		block_p->crc = crc64(work_buf, (size_t)block_size, 0);
+		blake3(work_buf, (size_t)block_size, block_p->hash);
+		block_p++;
+
+		file_offset += block_size;
+	}
+
+	// Read chunk tail
+	tail_size = file_p->size - file_offset;
+	if (tail_size > 0){
+		if (fread(work_buf, 1, (size_t)tail_size, fp) != (size_t)tail_size){
+			perror("Failed to read tail chunk on input file");
+			fclose(fp);
+			free(work_buf);
+			hash_p->ret = RET_FILE_IO_ERROR;
+			return;
+		}
+
+		// calculate CRC-64 of the first 16 KB
+		if (file_offset + tail_size < 16384){
+			crc = crc64(work_buf, (size_t)tail_size, crc);
+		} else if (file_offset < 16384){
+			crc = crc64(work_buf, (size_t)(16384 - file_offset), crc);
+		}
+		blake3_update(&hasher, work_buf, (size_t)tail_size);
+
+		if (tail_size >= 40){
+			hash_p->tail_crc = crc64(work_buf, 40, 0);
+			hash_p->tail.crc = crc64(work_buf, (size_t)tail_size, 0);
+			blake3(work_buf, (size_t)tail_size, hash_p->tail.hash);
+		} else {	// 1 ~ 39 bytes are saved in File Packet.
+			memcpy(hash_p->tail_data, work_buf, (size_t)tail_size);
+			memset(hash_p->tail_data + tail_size, 0, 40 - tail_size);	// zero fill the rest bytes
+		}
+	}
+
+	file_p->crc = crc;
+	blake3_hasher_finalize(&hasher, file_p->hash, 16);
+	free(work_buf);
+	if (fclose(fp) != 0){
+		perror("Failed to close input file");
+		hash_p->ret = RET_FILE_IO_ERROR;
+	}
+}
+
+// Files are hashed on threads, and results are stored in order of files.
+// Then, mapping is same on any number of threads.
+int map_file_hash(PAR3_CTX *par3_ctx, MAP_FILE_HASH **file_hash_list, MAP_HASH_CTX **block_hash_list)
+{
+	int thread_count, progress_old, progress_now, ret;
+	uint32_t num, num_end, input_file_count, cached_count;
+	uint64_t block_size, block_count, round_size, round_max;
+	uint64_t progress_total, progress_step;
+	MAP_FILE_HASH *file_hash;
+	MAP_HASH_RUN ctx;
+	time_t time_old, time_now;
+
+	input_file_count = par3_ctx->input_file_count;
+	block_size = par3_ctx->block_size;
+
+	// Count full size blocks in each file.
+	block_count = 0;
+	if (block_size > 0){
+		for (num = 0; num < input_file_count; num++)
+			block_count += par3_ctx->input_file_list[num].size / block_size;
+	}
+	file_hash = calloc(1, sizeof(MAP_FILE_HASH) * input_file_count + sizeof(MAP_HASH_CTX) * block_count);
+	if (file_hash == NULL){
+		perror("Failed to allocate memory for checksums of input files");
+		return RET_MEMORY_ERROR;
+	}
+	*file_hash_list = file_hash;
+	*block_hash_list = (MAP_HASH_CTX *)(file_hash + input_file_count);
+	block_count = 0;
+	for (num = 0; num < input_file_count; num++){
+		file_hash[num].block = block_count;
+		if (block_size > 0)
+			block_count += par3_ctx->input_file_list[num].size / block_size;
+	}
+
+	ctx.par3_ctx = par3_ctx;
+	ctx.file_hash = file_hash;
+	ctx.block_hash = *block_hash_list;
+	ctx.key_list = NULL;
+	if (par3_ctx->hash_cache != NULL){
+		ctx.key_list = malloc(sizeof(CACHE_KEY) * input_file_count);
+		if (ctx.key_list == NULL){
+			perror("Failed to allocate memory for hash cache");
+			free(file_hash);
+			return RET_MEMORY_ERROR;
+		}
+	}
+	cached_count = 0;
+
+	if (par3_ctx->noise_level >= 0){
+		progress_total = par3_ctx->total_file_size;
+		progress_step = 0;
+		progress_old = 0;
+		time_old = time(NULL);
+	}
+
+	// Each round has some files for every thread, but not too large data.
+	// A large file is hashed alone in a round, so that BLAKE3 can use threads.
+	// Progress is printed between rounds.
+	thread_count = thread_pool_count();
+	round_max = (uint64_t)thread_count << 26;
+	for (num = 0; num < input_file_count; num = num_end){
+		round_size = 0;
+		for (num_end = num; num_end < input_file_count; ){
+			if ( (num_end > num) && (par3_ctx->input_file_list[num_end].size >= round_max) )
+				break;
+			round_size += par3_ctx->input_file_list[num_end].size;
+			num_end++;
+			if ( (num_end - num >= (uint32_t)thread_count * 4) || (round_size >= round_max) )
+				break;
+		}
+		ctx.file_first = num;
+		thread_pool_run(map_file_hash_task, &ctx, (int)(num_end - num));
+
+		for (; num < num_end; num++){
+			ret = file_hash[num].ret;
+			if ( (ret == 0) && (ctx.key_list != NULL) && (par3_ctx->input_file_list[num].size > 0) ){
+				// Records are added in order of files, while threads are idle.
+				if (file_hash[num].cached == 0){
+					ret = cache_add(par3_ctx, ctx.key_list + num, par3_ctx->input_file_list + num,
+							block_size, file_hash + num, ctx.block_hash);
+				} else if (file_hash[num].cached > 0){
+					cache_keep(par3_ctx, ctx.key_list + num);
+					cached_count++;
+				}
+			}
+			if (ret != 0){
+				free(ctx.key_list);
+				free(file_hash);
+				return ret;
+			}
+		}
+
+		// Print progress percent
+		if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) && (progress_total > 0) ){
+			progress_step += round_size;
+			time_now = time(NULL);
+			if (time_now != time_old){
+				time_old = time_now;
+				progress_now = (int)((progress_step * 1000) / progress_total);
+				if (progress_now != progress_old){
+					progress_old = progress_now;
+					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+				}
+			}
+		}
+	}
+
+	if (ctx.key_list != NULL){
+		free(ctx.key_list);
+		if (par3_ctx->noise_level >= 1){
+			printf("Checksums of %u files were read from hash cache\n", cached_count);
+		}
+	}
+
+	return 0;
+}
 
 
 // map input file slices into input blocks without deduplication
 int map_input_block_simple(PAR3_CTX *par3_ctx)
 {
-	uint8_t *work_buf, buf_tail[40];
-	int progress_old, progress_now;
+	int ret;
 	uint32_t num, num_pack;
 	uint32_t input_file_count, chunk_index;
 	uint64_t block_size, tail_size, file_offset, tail_offset;
 	uint64_t block_count, block_index, slice_index, index;
-	uint64_t progress_total, progress_step;
 	PAR3_FILE_CTX *file_p;
 	PAR3_CHUNK_CTX *chunk_p;
 	PAR3_SLICE_CTX *slice_p, *slice_list;
 	PAR3_BLOCK_CTX *block_p, *block_list;
-	FILE *fp;
-	blake3_hasher hasher;
-	time_t time_old, time_now;
+	MAP_FILE_HASH *file_hash, *hash_p;
+	MAP_HASH_CTX *block_hash;
 	clock_t clock_now;
 
 	// Copy variables from context to local.
@@ -68,90 +337,49 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 	block_list = block_p;
 	par3_ctx->block_list = block_p;
 
-	// Allocate memory to store file data temporary.
-	work_buf = malloc(block_size);
-	if (work_buf == NULL){
-		perror("Failed to allocate memory for input data");
-		return RET_MEMORY_ERROR;
-	}
-	par3_ctx->work_buf = work_buf;
-
+	// Read data of input files on threads
 	if (par3_ctx->noise_level >= 0){
 		printf("\nComputing hash:\n");
-		progress_total = par3_ctx->total_file_size;
-		progress_step = 0;
-		progress_old = 0;
-		time_old = time(NULL);
 		clock_now = clock();
 	}
+	ret = map_file_hash(par3_ctx, &file_hash, &block_hash);
+	if (ret != 0)
+		return ret;
 
-	// Read data of input files on memory
+	// Map slices in order of files
 	num_pack = 0;
 	chunk_index = 0;
 	block_index = 0;
 	slice_index = 0;
 	file_p = par3_ctx->input_file_list;
+	hash_p = file_hash;
 	for (num = 0; num < input_file_count; num++){
-		blake3_hasher_init(&hasher);
 		if (file_p->size == 0){	// Skip empty files.
-			blake3_hasher_finalize(&hasher, file_p->hash, 16);
 			file_p++;
+			hash_p++;
 			continue;
 		}
 		if (par3_ctx->noise_level >= 2){
 			printf("file size = %"PRIu64" \"%s\"\n", file_p->size, file_p->name);
 		}
 
-		fp = fopen(file_p->name, "rb");
-		if (fp == NULL){
-			perror("Failed to open input file");
-			return RET_FILE_IO_ERROR;
-		}
-
 		// When no deduplication, chunk's index is same as file's index.
 		file_p->chunk = chunk_index;	// single chunk in each file
 		file_p->chunk_num = 1;
 		chunk_p->size = file_p->size;	// file size = chunk size
 		chunk_p->block = block_index;
 
-		// Read full size blocks
+		// Full size blocks
 		file_offset = 0;
+		index = hash_p->block;
 		while (file_offset + block_size <= file_p->size){
-			// read full block from input file
-			if (fread(work_buf, 1, (size_t)block_size, fp) != (size_t)block_size){
-				perror("Failed to read full size chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += block_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + block_size < 16384){
-				file_p->crc = crc64(work_buf, (size_t)block_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
-			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)block_size);
-
 			// set block info
 			block_p->slice = slice_index;
 			block_p->size = block_size;
-			block_p->crc = crc64(work_buf, (size_t)block_size, 0);
-			blake3(work_buf, (size_t)block_size, block_p->hash);
+			block_p->crc = block_hash[index].crc;
+			memcpy(block_p->hash, block_hash[index].hash, 16);
 			block_p->state = 1 | 64;
+			index++;
 
 			// set slice info
 			slice_p->chunk = chunk_index;
@@ -173,34 +401,13 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 			block_index++;
 		}
 
-		// Calculate size of chunk tail, and read it.
+		// Calculate size of chunk tail.
 		tail_size = file_p->size - file_offset;
 		//printf("tail_size = %"PRIu64", file size = %"PRIu64", offset %"PRIu64"\n", tail_size, file_p->size, file_offset);
 		if (tail_size >= 40){
-			// read chunk tail from input file
-			if (fread(work_buf, 1, (size_t)tail_size, fp) != (size_t)tail_size){
-				perror("Failed to read tail chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += tail_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate checksum of chunk tail
-			chunk_p->tail_crc = crc64(work_buf, 40, 0);
-			blake3(work_buf, (size_t)tail_size, chunk_p->tail_hash);
+			// checksum of chunk tail
+			chunk_p->tail_crc = hash_p->tail_crc;
+			memcpy(chunk_p->tail_hash, hash_p->tail.hash, 16);
 
 			// search existing tails to check available space
 			tail_offset = 0;
@@ -232,7 +439,7 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 				// set block info (block for tails don't store checksum)
 				block_p->slice = slice_index;
 				block_p->size = tail_size;
-				block_p->crc = crc64(work_buf, (size_t)tail_size, 0);
+				block_p->crc = hash_p->tail.crc;
 				block_p->state = 2 | 64;
 				block_p++;
 				block_index++;
@@ -255,16 +462,8 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 
 				// update block info
 				block_list[slice_p->block].size = tail_offset + tail_size;
-				block_list[slice_p->block].crc = crc64(work_buf, (size_t)tail_size, block_list[slice_p->block].crc);
-			}
-
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + tail_size < 16384){
-				file_p->crc = crc64(work_buf, (size_t)tail_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(work_buf, (size_t)(16384 - file_offset), file_p->crc);
+				block_list[slice_p->block].crc = crc64_combine(block_list[slice_p->block].crc, hash_p->tail.crc, tail_size);
 			}
-			blake3_hasher_update(&hasher, work_buf, (size_t)tail_size);
 
 			// set common slice info
 			slice_p->file = num;
@@ -277,66 +476,28 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 
 		} else if (tail_size > 0){
 			// When tail size is 1~39 bytes, it's saved in File Packet.
-			if (fread(buf_tail, 1, (size_t)tail_size, fp) != (size_t)tail_size){
-				perror("Failed to read tail chunk on input file");
-				fclose(fp);
-				return RET_FILE_IO_ERROR;
-			}
-			memset(buf_tail + tail_size, 0, 40 - tail_size);	// zero fill the rest bytes
 			if (par3_ctx->noise_level >= 3){
 				printf("    block no  : slice no  chunk[%2u] file %d, offset %"PRIu64", tail size %"PRIu64"\n",
 						chunk_index, num, file_offset, tail_size);
 			}
 
-			// Print progress percent
-			if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 2) ){
-				progress_step += tail_size;
-				time_now = time(NULL);
-				if (time_now != time_old){
-					time_old = time_now;
-					progress_now = (int)((progress_step * 1000) / progress_total);
-					if (progress_now != progress_old){
-						progress_old = progress_now;
-						printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-					}
-				}
-			}
-
-			// calculate CRC-64 of the first 16 KB
-			if (file_offset + tail_size < 16384){
-				file_p->crc = crc64(buf_tail, (size_t)tail_size, file_p->crc);
-			} else if (file_offset < 16384){
-				file_p->crc = crc64(buf_tail, (size_t)(16384 - file_offset), file_p->crc);
-			}
-			blake3_hasher_update(&hasher, buf_tail, (size_t)tail_size);
-
 			// copy 1 ~ 39 bytes
-			memcpy(&(chunk_p->tail_crc), buf_tail, 8);
-			memcpy(chunk_p->tail_hash, buf_tail + 8, 16);
-			memcpy(&(chunk_p->tail_block), buf_tail + 24, 8);
-			memcpy(&(chunk_p->tail_offset), buf_tail + 32, 8);
-		}
-
-		blake3_hasher_finalize(&hasher, file_p->hash, 16);
-		if (fclose(fp) != 0){
-			perror("Failed to close input file");
-			return RET_FILE_IO_ERROR;
+			memcpy(&(chunk_p->tail_crc), hash_p->tail_data, 8);
+			memcpy(chunk_p->tail_hash, hash_p->tail_data + 8, 16);
+			memcpy(&(chunk_p->tail_block), hash_p->tail_data + 24, 8);
+			memcpy(&(chunk_p->tail_offset), hash_p->tail_data + 32, 8);
 		}
 
 		file_p++;
+		hash_p++;
 		chunk_p++;	// Each input file contains single chunk description.
 		chunk_index++;
 	}
 
 	// Release temporary buffer.
-	free(work_buf);
-	par3_ctx->work_buf = NULL;
+	free(file_hash);
 
 	if (par3_ctx->noise_level >= 0){
-		if (par3_ctx->noise_level <= 2){
-			if (progress_step < progress_total)
-				printf("Didn't finish progress. %"PRIu64" / %"PRIu64"\n", progress_step, progress_total);
-		}
 		clock_now = clock() - clock_now;
 		printf("done in %.1f seconds.\n", (double)clock_now / CLOCKS_PER_SEC);
 		printf("\n");
@@ -392,14 +553,13 @@ int map_input_block_simple(PAR3_CTX *par3_ctx)
 // map chunk tails, when there are no input blocks.
 int map_chunk_tail(PAR3_CTX *par3_ctx)
 {
-	uint8_t buf_tail[40];
+	int ret;
 	uint32_t num;
 	uint32_t input_file_count, chunk_index;
-	uint64_t tail_size;
 	PAR3_FILE_CTX *file_p;
 	PAR3_CHUNK_CTX *chunk_p;
-	FILE *fp;
-	blake3_hasher hasher;
+	MAP_FILE_HASH *file_hash, *hash_p;
+	MAP_HASH_CTX *block_hash;
 
 	// Copy variables from context to local.
 	input_file_count = par3_ctx->input_file_count;
@@ -415,65 +575,42 @@ int map_chunk_tail(PAR3_CTX *par3_ctx)
 	}
 	par3_ctx->chunk_list = chunk_p;
 
-	// Read data of input files on memory
+	// Read data of input files on threads
+	ret = map_file_hash(par3_ctx, &file_hash, &block_hash);
+	if (ret != 0)
+		return ret;
+
 	chunk_index = 0;
 	file_p = par3_ctx->input_file_list;
+	hash_p = file_hash;
 	for (num = 0; num < input_file_count; num++){
-		blake3_hasher_init(&hasher);
 		if (file_p->size == 0){	// Skip empty files.
-			blake3_hasher_finalize(&hasher, file_p->hash, 16);
 			file_p++;
+			hash_p++;
 			continue;
 		}
 		if (par3_ctx->noise_level >= 2){
 			printf("file size = %"PRIu64" \"%s\"\n", file_p->size, file_p->name);
 		}
 
-		fp = fopen(file_p->name, "rb");
-		if (fp == NULL){
-			perror("Failed to open input file");
-			return RET_FILE_IO_ERROR;
-		}
-
 		// When no deduplication, chunk's index is same as file's index.
 		file_p->chunk = chunk_index;	// single chunk in each file
 		file_p->chunk_num = 1;
 		chunk_p->size = file_p->size;	// file size = chunk size
 		chunk_p->block = 0;
 
-		tail_size = file_p->size;
 		// When tail size is 1~39-bytes, it's saved in File Packet.
-		if (fread(buf_tail, 1, (size_t)tail_size, fp) != (size_t)tail_size){
-			perror("Failed to read tail chunk on input file");
-			fclose(fp);
-			return RET_FILE_IO_ERROR;
-		}
-		memset(buf_tail + tail_size, 0, 40 - tail_size);	// zero fill the rest bytes
-
-		// calculate CRC-64 of the first 16 KB
-		if (tail_size < 16384){
-			file_p->crc = crc64(buf_tail, (size_t)tail_size, file_p->crc);
-		} else {
-			file_p->crc = crc64(buf_tail, 16384, file_p->crc);
-		}
-		blake3_hasher_update(&hasher, buf_tail, (size_t)tail_size);
-
-		// copy 1 ~ 39 bytes
-		memcpy(&(chunk_p->tail_crc), buf_tail, 8);
-		memcpy(chunk_p->tail_hash, buf_tail + 8, 16);
-		memcpy(&(chunk_p->tail_block), buf_tail + 24, 8);
-		memcpy(&(chunk_p->tail_offset), buf_tail + 32, 8);
-
-		blake3_hasher_finalize(&hasher, file_p->hash, 16);
-		if (fclose(fp) != 0){
-			perror("Failed to close input file");
-			return RET_FILE_IO_ERROR;
-		}
+		memcpy(&(chunk_p->tail_crc), hash_p->tail_data, 8);
+		memcpy(chunk_p->tail_hash, hash_p->tail_data + 8, 16);
+		memcpy(&(chunk_p->tail_block), hash_p->tail_data + 24, 8);
+		memcpy(&(chunk_p->tail_offset), hash_p->tail_data + 32, 8);
 
 		file_p++;
+		hash_p++;
 		chunk_p++;	// Each input file contains single chunk description.
 		chunk_index++;
 	}
+	free(file_hash);
 
 	// Re-allocate memory for actual number of chunk description
 	if (par3_ctx->noise_level >= 0){
@@ -9,37 +9,52 @@
 #include "galois.h"
 #include "hash.h"
 #include "reedsolomon.h"
+#include "thread.h"
+#include "leopard/leopard.h"
 
 
-// Create all recovery blocks from one input block.
-void rs_create_one_all(PAR3_CTX *par3_ctx, int x_index)
+// Arguments for multi-threading
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	uint8_t *input_p;	// input block or the first input block
+	uint8_t *recv_p;	// the first recovery block
+	size_t region_size;
+	int x_index;		// index of input block
+	int y_first;		// index of the first recovery block
+	int y_step;			// number of recovery blocks per task
+	int y_count;		// number of recovery blocks
+} RS_THREAD_CTX;
+
+// Multiply one input block to recovery blocks of a task.
+static void rs_create_one_task(void *arg, int index)
 {
+	RS_THREAD_CTX *ctx = arg;
 	void *gf_table;
-	uint8_t *work_buf, *buf_p;
-	uint8_t gf_size;
+	uint8_t *buf_p;
 	int first_num, element;
-	int y_index, y_R;
-	int recovery_block_count;
+	int x_index, y_index, y_end, y_R;
 	size_t region_size;
 
-	recovery_block_count = (int)(par3_ctx->recovery_block_count);
-	first_num = (int)(par3_ctx->first_recovery_block);
-	gf_size = par3_ctx->gf_size;
-	gf_table = par3_ctx->galois_table;
-	work_buf = par3_ctx->work_buf;
-	buf_p = par3_ctx->block_data;
+	first_num = (int)(ctx->par3_ctx->first_recovery_block) + ctx->y_first;
+	gf_table = ctx->par3_ctx->galois_table;
+	x_index = ctx->x_index;
+	region_size = ctx->region_size;
 
-	// For every recovery block
-	region_size = (par3_ctx->block_size + 4 + 3) & ~3;
-	for (y_index = 0; y_index < recovery_block_count; y_index++){
+	y_index = ctx->y_step * index;
+	y_end = y_index + ctx->y_step;
+	if (y_end > ctx->y_count)
+		y_end = ctx->y_count;
+	buf_p = ctx->recv_p + region_size * y_index;
+
+	for (; y_index < y_end; y_index++){
 		// Calculate Matrix elements
-		if (par3_ctx->gf_size == 2){	// 16-bit Galois Field
+		if (ctx->par3_ctx->gf_size == 2){	// 16-bit Galois Field
 			y_R = 65535 - (y_index + first_num);
 			element = gf16_reciprocal(gf_table, x_index ^ y_R);	// inv( x_index ^ y_R )
 
 			// If x_index == 0, just put values.
 			// If x_index > 0, add values on previous values.
-			gf16_region_multiply(gf_table, work_buf, element, region_size, buf_p, x_index);
+			gf16_region_multiply(gf_table, ctx->input_p, element, region_size, buf_p, x_index);
 
 		} else {	// 8-bit Galois Field
 			y_R = 255 - (y_index + first_num);
@@ -47,7 +62,7 @@ void rs_create_one_all(PAR3_CTX *par3_ctx, int x_index)
 
 			// If x_index == 0, just put values.
 			// If x_index > 0, add values on previous values.
-			gf8_region_multiply(gf_table, work_buf, element, region_size, buf_p, x_index);
+			gf8_region_multiply(gf_table, ctx->input_p, element, region_size, buf_p, x_index);
 		}
 		//printf("x = %d, R = %d, y_R = %d, element = %d\n", x_index, y_index + first_num, y_R, element);
 
@@ -55,78 +70,216 @@ void rs_create_one_all(PAR3_CTX *par3_ctx, int x_index)
 	}
 }
 
-// Create all recovery blocks from all input blocks.
-void rs_create_all(PAR3_CTX *par3_ctx, size_t region_size, uint64_t progress_total, uint64_t progress_step)
+// Create some recovery blocks from one input block.
+// Recovery blocks from y_first to y_first + y_count - 1 are stored in block_data.
+void rs_create_one_all(PAR3_CTX *par3_ctx, uint8_t *input_p, int x_index, int y_first, int y_count)
 {
-	void *gf_table;
-	uint8_t *block_data, *input_p, *recv_p;
-	uint8_t gf_size;
-	int first_num, element;
-	int x_index, y_index, y_R;
-	int block_count, recovery_block_count;
-	int progress_old, progress_now;
-	time_t time_old, time_now;
+	RS_THREAD_CTX ctx;
+	int task_count, max_step;
+
+	ctx.par3_ctx = par3_ctx;
+	ctx.input_p = input_p;
+	ctx.recv_p = par3_ctx->block_data;
+	ctx.region_size = (par3_ctx->block_size + 4 + 3) & ~3;
+	ctx.x_index = x_index;
+	ctx.y_first = y_first;
+	ctx.y_count = y_count;
+
+	// Each task should be large enough (at least 64 KB) to hide cost of switching,
+	// but every thread needs a task.
+	ctx.y_step = (int)(65536 / ctx.region_size) + 1;
+	max_step = (ctx.y_count + thread_pool_count() - 1) / thread_pool_count();
+	if (ctx.y_step > max_step)
+		ctx.y_step = max_step;
+	if (ctx.y_step < 1)
+		ctx.y_step = 1;
+	task_count = (ctx.y_count + ctx.y_step - 1) / ctx.y_step;
 
-	block_count = (int)(par3_ctx->block_count);
-	recovery_block_count = (int)(par3_ctx->recovery_block_count);
-	first_num = (int)(par3_ctx->first_recovery_block);
-	gf_size = par3_ctx->gf_size;
-	gf_table = par3_ctx->galois_table;
-	block_data = par3_ctx->block_data;
-	recv_p = block_data + region_size * block_count;
+	// For every recovery block
+	thread_pool_run(rs_create_one_task, &ctx, task_count);
+}
 
-	if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
-		progress_old = 0;
-		time_old = time(NULL);
+// Arguments for tiled matrix multiply
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	uint8_t *input_p;	// the first input block
+	uint8_t *recv_p;	// the first recovery block
+	int *lost_id;		// index of lost input blocks at recovery, or NULL at creation
+	int lost_count;
+	int output_count;	// number of output blocks
+	size_t region_size;
+	size_t stripe_size;	// bytes of each stripe
+	int stripe_count;	// number of stripes in a block
+	int tile_step;		// number of output blocks per tile
+	int task_first;		// index of the first task in this round
+} RS_TILE_CTX;
+
+// Multiply a stripe of one input block to a tile of output blocks.
+static void rs_tile_multiply(RS_TILE_CTX *ctx, uint8_t *input_p, int x_index,
+				int y_first, int y_end, size_t offset, size_t stripe_size, int add)
+{
+	void *gf_table;
+	uint8_t *output_p;
+	int y_index, y_R, factor, block_count;
+
+	gf_table = ctx->par3_ctx->galois_table;
+	block_count = (int)(ctx->par3_ctx->block_count);
+
+	for (y_index = y_first; y_index < y_end; y_index++){
+		if (ctx->lost_id == NULL){	// Creation
+			output_p = ctx->recv_p + ctx->region_size * y_index;
+			if (ctx->par3_ctx->gf_size == 2){
+				y_R = 65535 - (y_index + (int)(ctx->par3_ctx->first_recovery_block));
+				factor = gf16_reciprocal(gf_table, x_index ^ y_R);	// inv( x_index ^ y_R )
+			} else {
+				y_R = 255 - (y_index + (int)(ctx->par3_ctx->first_recovery_block));
+				factor = gf8_reciprocal(gf_table, x_index ^ y_R);	// inv( x_index ^ y_R )
+			}
+		} else {	// Recovery
+			output_p = ctx->input_p + ctx->region_size * ctx->lost_id[y_index];
+			if (ctx->par3_ctx->gf_size == 2){
+				factor = ((uint16_t *)(ctx->par3_ctx->matrix))[ block_count * y_index + x_index ];
+			} else {
+				factor = ((uint8_t *)(ctx->par3_ctx->matrix))[ block_count * y_index + x_index ];
+			}
+		}
+
+		if (ctx->par3_ctx->gf_size == 2){
+			gf16_region_multiply(gf_table, input_p + offset, factor, stripe_size, output_p + offset, add);
+		} else {
+			gf8_region_multiply(gf_table, input_p + offset, factor, stripe_size, output_p + offset, add);
+		}
 	}
+}
 
-	// For every recovery block
-	for (y_index = 0; y_index < recovery_block_count; y_index++){
-		input_p = block_data;
+// Multiply all input blocks to a tile of output blocks in a stripe.
+// A stripe of each input block is read from memory only once per tile,
+// while stripes of output blocks in the tile stay in cache.
+static void rs_tile_task(void *arg, int index)
+{
+	RS_TILE_CTX *ctx = arg;
+	uint8_t *input_p;
+	int x_index, y_first, y_end, lost_index, block_count;
+	size_t offset, stripe_size;
+
+	block_count = (int)(ctx->par3_ctx->block_count);
+
+	// Task index = tile * stripe_count + stripe
+	index += ctx->task_first;
+	y_first = ctx->tile_step * (index / ctx->stripe_count);
+	y_end = y_first + ctx->tile_step;
+	if (y_end > ctx->output_count)
+		y_end = ctx->output_count;
+	offset = ctx->stripe_size * (index % ctx->stripe_count);
+	stripe_size = ctx->region_size - offset;
+	if (stripe_size > ctx->stripe_size)
+		stripe_size = ctx->stripe_size;
+
+	if (ctx->lost_id == NULL){	// Creation
+		// If x_index == 0, just put values.
+		// If x_index > 0, add values on previous values.
+		input_p = ctx->input_p;
+		for (x_index = 0; x_index < block_count; x_index++){
+			rs_tile_multiply(ctx, input_p, x_index, y_first, y_end, offset, stripe_size, x_index);
+			input_p += ctx->region_size;
+		}
 
-		// For every input block
+	} else {	// Recovery
+		// For every available input block
+		input_p = ctx->input_p;
+		lost_index = 0;
 		for (x_index = 0; x_index < block_count; x_index++){
+			if ( (lost_index < ctx->lost_count) && (x_index == ctx->lost_id[lost_index]) ){
+				lost_index++;
+			} else {
+				rs_tile_multiply(ctx, input_p, x_index, y_first, y_end, offset, stripe_size, 1);
+			}
+			input_p += ctx->region_size;
+		}
 
-			// Calculate Matrix elements
-			if (par3_ctx->gf_size == 2){	// 16-bit Galois Field
-				y_R = 65535 - (y_index + first_num);
-				element = gf16_reciprocal(gf_table, x_index ^ y_R);	// inv( x_index ^ y_R )
+		// For every using recovery block
+		input_p = ctx->recv_p;
+		for (lost_index = 0; lost_index < ctx->lost_count; lost_index++){
+			rs_tile_multiply(ctx, input_p, ctx->lost_id[lost_index], y_first, y_end, offset, stripe_size, 1);
+			input_p += ctx->region_size;
+		}
+	}
+}
 
-				// If x_index == 0, just put values.
-				// If x_index > 0, add values on previous values.
-				gf16_region_multiply(gf_table, input_p, element, region_size, recv_p, x_index);
+// Multiply all input blocks to all output blocks by tiles on threads.
+static void rs_tile_all(RS_TILE_CTX *ctx, uint64_t progress_total, uint64_t progress_step)
+{
+	PAR3_CTX *par3_ctx = ctx->par3_ctx;
+	int task_count, task_end, thread_count, tile_count, max_step;
+	int progress_old, progress_now;
+	uint64_t progress_size;
+	time_t time_old, time_now;
 
-			} else {	// 8-bit Galois Field
-				y_R = 255 - (y_index + first_num);
-				element = gf8_reciprocal(gf_table, x_index ^ y_R);	// inv( x_index ^ y_R )
+	// Stripe is at most 64 KB, and multiple of 64 bytes for SIMD except the last one.
+	ctx->stripe_count = (int)((ctx->region_size + 65535) / 65536);
+	ctx->stripe_size = (ctx->region_size + ctx->stripe_count - 1) / ctx->stripe_count;
+	ctx->stripe_size = (ctx->stripe_size + 63) & ~(size_t)63;
+	ctx->stripe_count = (int)((ctx->region_size + ctx->stripe_size - 1) / ctx->stripe_size);
+
+	// Stripes of output blocks in a tile (about 1 MB) should fit in L2 cache,
+	// but every thread needs a task.
+	ctx->tile_step = (int)((1 << 20) / ctx->stripe_size);
+	thread_count = thread_pool_count();
+	tile_count = (thread_count + ctx->stripe_count - 1) / ctx->stripe_count;
+	max_step = (ctx->output_count + tile_count - 1) / tile_count;
+	if (ctx->tile_step > max_step)
+		ctx->tile_step = max_step;
+	if (ctx->tile_step < 1)
+		ctx->tile_step = 1;
+	task_count = ((ctx->output_count + ctx->tile_step - 1) / ctx->tile_step) * ctx->stripe_count;
+	if (par3_ctx->noise_level >= 3){
+		printf("Tile = %d blocks * %zu bytes, %d tasks\n", ctx->tile_step, ctx->stripe_size, task_count);
+	}
 
-				// If x_index == 0, just put values.
-				// If x_index > 0, add values on previous values.
-				gf8_region_multiply(gf_table, input_p, element, region_size, recv_p, x_index);
-			}
-			//printf("x = %d, R = %d, y_R = %d, element = %d\n", x_index, y_index + first_num, y_R, element);
+	progress_size = (uint64_t)(par3_ctx->block_count) * ctx->output_count;
+	if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
+		progress_old = 0;
+		time_old = time(NULL);
+	}
 
-			input_p += region_size;
-		}
+	// Each thread calculates one tile at once.
+	for (ctx->task_first = 0; ctx->task_first < task_count; ctx->task_first = task_end){
+		task_end = ctx->task_first + thread_count;
+		if (task_end > task_count)
+			task_end = task_count;
+		thread_pool_run(rs_tile_task, ctx, task_end - ctx->task_first);
 
 		// Print progress percent
 		if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
-			progress_step += block_count;
 			time_now = time(NULL);
 			if (time_now != time_old){
 				time_old = time_now;
-				progress_now = (int)((progress_step * 1000) / progress_total);
+				progress_now = (int)(((progress_step + progress_size * task_end / task_count) * 1000) / progress_total);
 				if (progress_now != progress_old){
 					progress_old = progress_now;
 					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
 				}
 			}
 		}
-
-		recv_p += region_size;
 	}
 }
 
+// Create all recovery blocks from all input blocks.
+void rs_create_all(PAR3_CTX *par3_ctx, size_t region_size, uint64_t progress_total, uint64_t progress_step)
+{
+	RS_TILE_CTX ctx;
+
+	ctx.par3_ctx = par3_ctx;
+	ctx.input_p = par3_ctx->block_data;
+	ctx.recv_p = par3_ctx->block_data + region_size * par3_ctx->block_count;
+	ctx.lost_id = NULL;
+	ctx.lost_count = 0;
+	ctx.output_count = (int)(par3_ctx->recovery_block_count);
+	ctx.region_size = region_size;
+
+	rs_tile_all(&ctx, progress_total, progress_step);
+}
+
 
 // Construct matrix for Cauchy Reed-Solomon, and solve linear equation.
 int rs_compute_matrix(PAR3_CTX *par3_ctx, uint64_t lost_count)
@@ -194,6 +347,304 @@ int rs_compute_matrix(PAR3_CTX *par3_ctx, uint64_t lost_count)
 	return 0;
 }
 
+
+// Matrix larger than this size is eliminated by stripes, which fit in cache.
+#define RS_GAUSS_CACHE_SIZE	(8 << 20)
+
+// Arguments for Gaussian elimination
+typedef struct {
+	PAR3_CTX *par3_ctx;
+	uint8_t *matrix;		// lost_count * block_count
+	uint8_t *pivot_matrix;	// lost_count * lost_count, columns of pivots
+	uint8_t *factor;		// lost_count * lost_count, factors of each step
+	int lost_count;
+	size_t row_size;		// bytes of a row in matrix
+	size_t pivot_size;		// bytes of a row in pivot_matrix
+
+	uint8_t *target;		// rows to eliminate at pivot step
+	size_t target_size;		// bytes of a row in target
+	int y_index;			// current pivot row
+	int x_index;			// current pivot column
+	int task_step;			// number of rows per task
+
+	size_t stripe_size;		// bytes of each stripe
+	int stripe_count;		// number of stripes in a row
+	int task_first;			// index of the first stripe in this round
+} RS_GAUSS_CTX;
+
+static int rs_get_element(uint8_t *buf, int gf_size, size_t index)
+{
+	if (gf_size == 2)
+		return ((uint16_t *)buf)[index];
+	return buf[index];
+}
+
+static void rs_set_element(uint8_t *buf, int gf_size, size_t index, int value)
+{
+	if (gf_size == 2){
+		((uint16_t *)buf)[index] = (uint16_t)value;
+	} else {
+		buf[index] = (uint8_t)value;
+	}
+}
+
+static void rs_row_multiply(PAR3_CTX *par3_ctx, uint8_t *src, int factor, size_t size, uint8_t *dst, int add)
+{
+	if (par3_ctx->gf_size == 2){
+		gf16_region_multiply(par3_ctx->galois_table, src, factor, size, dst, add);
+	} else {
+		gf8_region_multiply(par3_ctx->galois_table, src, factor, size, dst, add);
+	}
+}
+
+// Erase values of current pivot on other rows.
+static void rs_gauss_pivot_task(void *arg, int index)
+{
+	RS_GAUSS_CTX *ctx = arg;
+	PAR3_CTX *par3_ctx = ctx->par3_ctx;
+	uint8_t *row_p;
+	int gf_size, y, y2, y2_end, factor, factor2;
+	size_t row_count;
+
+	gf_size = par3_ctx->gf_size;
+	row_count = ctx->target_size / gf_size;
+	y = ctx->y_index;
+	row_p = ctx->target + ctx->target_size * y;
+	factor = rs_get_element(row_p, gf_size, ctx->x_index);
+
+	y2 = ctx->task_step * index;
+	y2_end = y2 + ctx->task_step;
+	if (y2_end > ctx->lost_count)
+		y2_end = ctx->lost_count;
+	for (; y2 < y2_end; y2++){
+		if (y2 == y)
+			continue;
+
+		factor2 = rs_get_element(ctx->target, gf_size, row_count * y2 + ctx->x_index);
+		rs_row_multiply(par3_ctx, row_p, factor2, ctx->target_size, ctx->target + ctx->target_size * y2, 1);
+
+		// Keep factor of this step to apply on other columns later.
+		if (ctx->factor != NULL)
+			rs_set_element(ctx->factor, gf_size, (size_t)(ctx->lost_count) * y + y2, factor2);
+
+		// After eliminate the pivot value, store "factor * factor2" value on the pivot.
+		if (gf_size == 2){
+			factor2 = gf16_multiply(par3_ctx->galois_table, factor, factor2);
+		} else {
+			factor2 = gf8_multiply(par3_ctx->galois_table, factor, factor2);
+		}
+		rs_set_element(ctx->target, gf_size, row_count * y2 + ctx->x_index, factor2);
+	}
+}
+
+// Eliminate all pivots of target rows. Rows of each step are shared by threads.
+static int rs_gauss_pivot_all(RS_GAUSS_CTX *ctx, int *pivot_id,
+				uint64_t progress_total, uint64_t progress_part)
+{
+	PAR3_CTX *par3_ctx = ctx->par3_ctx;
+	int gf_size, lost_count, thread_count, max_step;
+	int y, factor;
+	int progress_old, progress_now;
+	time_t time_old, time_now;
+
+	gf_size = par3_ctx->gf_size;
+	lost_count = ctx->lost_count;
+
+	// Each task should be large enough (at least 64 KB), but every thread needs a task.
+	thread_count = thread_pool_count();
+	ctx->task_step = (int)(65536 / ctx->target_size) + 1;
+	max_step = (lost_count + thread_count - 1) / thread_count;
+	if (ctx->task_step > max_step)
+		ctx->task_step = max_step;
+
+	if (par3_ctx->noise_level >= 0){
+		progress_old = 0;
+		time_old = time(NULL);
+	}
+
+	for (y = 0; y < lost_count; y++){
+		// Let pivot value to be 1.
+		ctx->y_index = y;
+		ctx->x_index = (pivot_id != NULL) ? pivot_id[y] : y;
+		factor = rs_get_element(ctx->target + ctx->target_size * y, gf_size, ctx->x_index);
+		if (factor == 0){
+			printf("Failed to invert matrix\n");
+			return RET_LOGIC_ERROR;
+		}
+		if (gf_size == 2){
+			factor = gf16_reciprocal(par3_ctx->galois_table, factor);
+		} else {
+			factor = gf8_reciprocal(par3_ctx->galois_table, factor);
+		}
+		rs_row_multiply(par3_ctx, ctx->target + ctx->target_size * y, factor, ctx->target_size, NULL, 0);
+		if (ctx->factor != NULL)
+			rs_set_element(ctx->factor, gf_size, (size_t)lost_count * y + y, factor);
+
+		// Erase values of same pivot on other rows.
+		// The pivot value becomes 1, so "factor" is read from the row.
+		rs_set_element(ctx->target + ctx->target_size * y, gf_size, ctx->x_index, factor);
+		thread_pool_run(rs_gauss_pivot_task, ctx, (lost_count + ctx->task_step - 1) / ctx->task_step);
+
+		// Print progress percent
+		if (par3_ctx->noise_level >= 0){
+			time_now = time(NULL);
+			if (time_now != time_old){
+				time_old = time_now;
+				progress_now = (int)((progress_part * (y + 1) * 1000) / (progress_total * lost_count));
+				if (progress_now != progress_old){
+					progress_old = progress_now;
+					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+// Apply all steps of elimination on a stripe of matrix.
+// Stripes of all rows stay in cache during the steps.
+static void rs_gauss_stripe_task(void *arg, int index)
+{
+	RS_GAUSS_CTX *ctx = arg;
+	PAR3_CTX *par3_ctx = ctx->par3_ctx;
+	uint8_t *matrix;
+	int gf_size, lost_count, y, y2, factor;
+	size_t offset, stripe_size;
+
+	gf_size = par3_ctx->gf_size;
+	lost_count = ctx->lost_count;
+	offset = ctx->stripe_size * (ctx->task_first + index);
+	stripe_size = ctx->row_size - offset;
+	if (stripe_size > ctx->stripe_size)
+		stripe_size = ctx->stripe_size;
+	matrix = ctx->matrix + offset;
+
+	for (y = 0; y < lost_count; y++){
+		factor = rs_get_element(ctx->factor, gf_size, (size_t)lost_count * y + y);
+		rs_row_multiply(par3_ctx, matrix + ctx->row_size * y, factor, stripe_size, NULL, 0);
+
+		for (y2 = 0; y2 < lost_count; y2++){
+			if (y2 == y)
+				continue;
+			factor = rs_get_element(ctx->factor, gf_size, (size_t)lost_count * y + y2);
+			if (factor != 0)
+				rs_row_multiply(par3_ctx, matrix + ctx->row_size * y, factor, stripe_size, matrix + ctx->row_size * y2, 1);
+		}
+	}
+}
+
+// Gaussian elimination of matrix, which is shared by 8-bit and 16-bit Galois Field.
+// Small matrix is eliminated directly, while rows of each step are shared by threads.
+// For large matrix, it eliminates only columns of pivots at first, and keeps factors of each step.
+// Then, it applies the factors on stripes of all columns by threads.
+int rs_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count)
+{
+	RS_GAUSS_CTX ctx;
+	uint8_t *buf;
+	int *lost_id;
+	int ret, gf_size, block_count, thread_count;
+	int x, y, value;
+	int progress_old, progress_now;
+	uint64_t progress_total;
+	time_t time_old, time_now;
+
+	gf_size = par3_ctx->gf_size;
+	block_count = (int)(par3_ctx->block_count);
+	lost_id = par3_ctx->recv_id_list + lost_count;
+
+	memset(&ctx, 0, sizeof(RS_GAUSS_CTX));
+	ctx.par3_ctx = par3_ctx;
+	ctx.matrix = par3_ctx->matrix;
+	ctx.lost_count = lost_count;
+	ctx.row_size = (size_t)gf_size * block_count;
+	ctx.pivot_size = (size_t)gf_size * lost_count;
+
+	// Complexity is "lost_count * lost_count * block_count" for direct elimination.
+	// Stripes need more "lost_count * lost_count * lost_count" for pivot columns.
+	if (ctx.row_size * lost_count <= RS_GAUSS_CACHE_SIZE){
+		ctx.target = ctx.matrix;
+		ctx.target_size = ctx.row_size;
+		return rs_gauss_pivot_all(&ctx, lost_id, 1, 1);
+	}
+
+	buf = malloc(ctx.pivot_size * lost_count * 2);
+	if (buf == NULL){
+		printf("Failed to allocate memory for matrix\n");
+		return RET_MEMORY_ERROR;
+	}
+	ctx.pivot_matrix = buf;
+	ctx.factor = buf + ctx.pivot_size * lost_count;
+
+	// Copy columns of pivots
+	for (y = 0; y < lost_count; y++){
+		for (x = 0; x < lost_count; x++){
+			value = rs_get_element(ctx.matrix, gf_size, (size_t)block_count * y + lost_id[x]);
+			rs_set_element(ctx.pivot_matrix, gf_size, (size_t)lost_count * y + x, value);
+		}
+	}
+
+	// Progress is counted in unit of "lost_count * lost_count".
+	progress_total = (uint64_t)lost_count + block_count;
+	ctx.target = ctx.pivot_matrix;
+	ctx.target_size = ctx.pivot_size;
+	ret = rs_gauss_pivot_all(&ctx, NULL, progress_total, lost_count);
+	if (ret != 0){
+		free(buf);
+		return ret;
+	}
+
+	// Stripes of all rows should fit in cache, but every thread needs a stripe.
+	thread_count = thread_pool_count();
+	ctx.stripe_size = (RS_GAUSS_CACHE_SIZE / lost_count) & ~(size_t)63;
+	if (ctx.stripe_size < 256)
+		ctx.stripe_size = 256;
+	if (ctx.stripe_size * thread_count > ctx.row_size){
+		ctx.stripe_size = (ctx.row_size + thread_count - 1) / thread_count;
+		ctx.stripe_size = (ctx.stripe_size + 63) & ~(size_t)63;
+	}
+	ctx.stripe_count = (int)((ctx.row_size + ctx.stripe_size - 1) / ctx.stripe_size);
+	if (par3_ctx->noise_level >= 3){
+		printf("Stripe = %zu bytes * %d\n", ctx.stripe_size, ctx.stripe_count);
+	}
+
+	if (par3_ctx->noise_level >= 0){
+		progress_old = 0;
+		time_old = time(NULL);
+	}
+	for (ctx.task_first = 0; ctx.task_first < ctx.stripe_count; ctx.task_first += thread_count){
+		x = ctx.stripe_count - ctx.task_first;
+		if (x > thread_count)
+			x = thread_count;
+		thread_pool_run(rs_gauss_stripe_task, &ctx, x);
+
+		// Print progress percent
+		if (par3_ctx->noise_level >= 0){
+			time_now = time(NULL);
+			if (time_now != time_old){
+				time_old = time_now;
+				progress_now = (int)(((uint64_t)lost_count * 1000
+						+ (uint64_t)block_count * (ctx.task_first + x) * 1000 / ctx.stripe_count) / progress_total);
+				if (progress_now != progress_old){
+					progress_old = progress_now;
+					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
+				}
+			}
+		}
+	}
+
+	// Put values of pivot columns, which were broken at applying factors.
+	for (y = 0; y < lost_count; y++){
+		for (x = 0; x < lost_count; x++){
+			value = rs_get_element(ctx.pivot_matrix, gf_size, (size_t)lost_count * y + x);
+			rs_set_element(ctx.matrix, gf_size, (size_t)block_count * y + lost_id[x], value);
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
 // Recover all lost input blocks from one block.
 void rs_recover_one_all(PAR3_CTX *par3_ctx, int x_index, int lost_count)
 {
@@ -230,81 +681,172 @@ void rs_recover_one_all(PAR3_CTX *par3_ctx, int x_index, int lost_count)
 // Recover all lost input blocks from all blocks.
 void rs_recover_all(PAR3_CTX *par3_ctx, size_t region_size, int lost_count, uint64_t progress_total, uint64_t progress_step)
 {
-	void *gf_table, *matrix;
-	uint8_t *block_data, *buf_p, *input_p, *recv_p;
-	uint8_t gf_size;
-	int *lost_id;
-	int x_index, y_index, lost_index, factor;
-	int block_count;
-	int progress_old, progress_now;
-	time_t time_old, time_now;
+	RS_TILE_CTX ctx;
 
-	block_count = (int)(par3_ctx->block_count);
-	gf_size = par3_ctx->gf_size;
-	gf_table = par3_ctx->galois_table;
-	matrix = par3_ctx->matrix;
-	lost_id = par3_ctx->recv_id_list + lost_count;
-	block_data = par3_ctx->block_data;
-	recv_p = block_data + region_size * block_count;
+	ctx.par3_ctx = par3_ctx;
+	ctx.input_p = par3_ctx->block_data;
+	ctx.recv_p = par3_ctx->block_data + region_size * par3_ctx->block_count;
+	ctx.lost_id = par3_ctx->recv_id_list + lost_count;
+	ctx.lost_count = lost_count;
+	ctx.output_count = lost_count;
+	ctx.region_size = region_size;
 
-	if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
-		progress_old = 0;
-		time_old = time(NULL);
-	}
+	rs_tile_all(&ctx, progress_total, progress_step);
+}
 
-	// For every lost block
-	for (y_index = 0; y_index < lost_count; y_index++){
-		buf_p = block_data + region_size * lost_id[y_index];
-		input_p = block_data;
 
-		// For every available input block
-		lost_index = 0;
-		for (x_index = 0; x_index < block_count; x_index++){
-			if (x_index == lost_id[lost_index]){
-				lost_index++;
-				input_p += region_size;
-				continue;
-			}
+// Arguments for multi-threading of Leopard-RS
+typedef struct {
+	size_t region_size;
+	size_t stripe_size;
+	int stripe_count;
+	int task_count;
+	uint32_t original_count;
+	uint32_t recovery_count;	// 0 at encoding
+	uint32_t work_count;
+	uint32_t max_recovery;
+	uint8_t **original_data;
+	uint8_t **recovery_data;
+	uint8_t **work_data;
+	uint8_t **stripe_data;	// pointer arrays for each task
+	int *result;			// result of each task
+} LEO_THREAD_CTX;
+
+// Encode or decode column stripes of all blocks.
+// Each task calls Leopard-RS for stripes of index, index + task_count, ...
+static void rs_leo_task(void *arg, int index)
+{
+	LEO_THREAD_CTX *ctx = arg;
+	uint8_t **original_p, **recovery_p, **work_p;
+	size_t offset, stripe_size;
+	uint32_t i;
+	int ret, stripe;
+
+	original_p = ctx->stripe_data + (size_t)index * (ctx->original_count + ctx->recovery_count + ctx->work_count);
+	recovery_p = original_p + ctx->original_count;
+	work_p = recovery_p + ctx->recovery_count;
+
+	ret = 0;
+	for (stripe = index; stripe < ctx->stripe_count; stripe += ctx->task_count){
+		offset = ctx->stripe_size * stripe;
+		stripe_size = ctx->region_size - offset;
+		if (stripe_size > ctx->stripe_size)
+			stripe_size = ctx->stripe_size;
+
+		// Lost blocks are NULL.
+		for (i = 0; i < ctx->original_count; i++)
+			original_p[i] = (ctx->original_data[i] == NULL) ? NULL : ctx->original_data[i] + offset;
+		for (i = 0; i < ctx->recovery_count; i++)
+			recovery_p[i] = (ctx->recovery_data[i] == NULL) ? NULL : ctx->recovery_data[i] + offset;
+		for (i = 0; i < ctx->work_count; i++)
+			work_p[i] = ctx->work_data[i] + offset;
+
+		if (ctx->recovery_count == 0){
+			ret = leo_encode(stripe_size, ctx->original_count, ctx->max_recovery, ctx->work_count,
+							(const void * const *)original_p, (void **)work_p);
+		} else {
+			ret = leo_decode(stripe_size, ctx->original_count, ctx->recovery_count, ctx->work_count,
+							(const void * const *)original_p, (const void * const *)recovery_p, (void **)work_p);
+		}
+		if (ret != 0)
+			break;
+	}
+	ctx->result[index] = ret;
+}
 
-			if (gf_size == 2){
-				factor = ((uint16_t *)matrix)[ block_count * y_index + x_index ];
-				gf16_region_multiply(gf_table, input_p, factor, region_size, buf_p, 1);
-			} else {
-				factor = ((uint8_t *)matrix)[ block_count * y_index + x_index ];
-				gf8_region_multiply(gf_table, input_p, factor, region_size, buf_p, 1);
-			}
+// Split blocks into stripes, and call Leopard-RS for them on threads.
+static int rs_leo_run(PAR3_CTX *par3_ctx, LEO_THREAD_CTX *ctx)
+{
+	size_t stripe_size;
+	int i, ret, thread_count;
+
+	// Working set of a stripe (work_count * stripe_size) should fit in cache.
+	// Too small stripe is slow, because Leopard-RS has fixed cost per call.
+	stripe_size = ((size_t)4 << 20) / ctx->work_count;
+	if (stripe_size < 4096)
+		stripe_size = 4096;
+	thread_count = thread_pool_count();
+	if (ctx->region_size / stripe_size < (size_t)thread_count){	// every thread needs a stripe
+		stripe_size = (ctx->region_size + thread_count - 1) / thread_count;
+		if (stripe_size < 4096)
+			stripe_size = 4096;
+	}
+	stripe_size = (stripe_size + 63) & ~(size_t)63;	// Leopard-RS requires multiple of 64 bytes.
+	if (stripe_size > ctx->region_size)
+		stripe_size = ctx->region_size;
+	ctx->stripe_size = stripe_size;
+	ctx->stripe_count = (int)((ctx->region_size + stripe_size - 1) / stripe_size);
+	ctx->task_count = ctx->stripe_count;
+	if (ctx->task_count > thread_count)
+		ctx->task_count = thread_count;
+
+	ctx->stripe_data = malloc(sizeof(uint8_t *) * (ctx->original_count + ctx->recovery_count + ctx->work_count) * ctx->task_count);
+	ctx->result = malloc(sizeof(int) * ctx->task_count);
+	if ( (ctx->stripe_data == NULL) || (ctx->result == NULL) ){
+		// Process whole blocks at once without extra memory.
+		free(ctx->stripe_data);
+		free(ctx->result);
+		if (ctx->recovery_count == 0){
+			return leo_encode(ctx->region_size, ctx->original_count, ctx->max_recovery, ctx->work_count,
+							(const void * const *)(ctx->original_data), (void **)(ctx->work_data));
+		} else {
+			return leo_decode(ctx->region_size, ctx->original_count, ctx->recovery_count, ctx->work_count,
+							(const void * const *)(ctx->original_data), (const void * const *)(ctx->recovery_data), (void **)(ctx->work_data));
+		}
+	}
+	if (par3_ctx->noise_level >= 3){
+		printf("Leopard-RS stripe = %zu bytes, %d stripes on %d threads\n", ctx->stripe_size, ctx->stripe_count, ctx->task_count);
+	}
 
-			input_p += region_size;
+	thread_pool_run(rs_leo_task, ctx, ctx->task_count);
+
+	ret = 0;
+	for (i = 0; i < ctx->task_count; i++){
+		if (ctx->result[i] != 0){
+			ret = ctx->result[i];
+			break;
 		}
+	}
+	free(ctx->stripe_data);
+	free(ctx->result);
 
-		// For every using recovery block
-		for (lost_index = 0; lost_index < lost_count; lost_index++){
-			x_index = lost_id[lost_index];
+	return ret;
+}
 
-			if (gf_size == 2){
-				factor = ((uint16_t *)matrix)[ block_count * y_index + x_index ];
-				gf16_region_multiply(gf_table, input_p, factor, region_size, buf_p, 1);
-			} else {
-				factor = ((uint8_t *)matrix)[ block_count * y_index + x_index ];
-				gf8_region_multiply(gf_table, input_p, factor, region_size, buf_p, 1);
-			}
+// Create recovery blocks by Leopard-RS.
+int rs_leo_encode(PAR3_CTX *par3_ctx, size_t region_size,
+				uint32_t original_count, uint32_t recovery_count, uint32_t work_count,
+				uint8_t **original_data, uint8_t **work_data)
+{
+	LEO_THREAD_CTX ctx;
 
-			input_p += region_size;
-		}
+	memset(&ctx, 0, sizeof(LEO_THREAD_CTX));
+	ctx.region_size = region_size;
+	ctx.original_count = original_count;
+	ctx.max_recovery = recovery_count;
+	ctx.work_count = work_count;
+	ctx.original_data = original_data;
+	ctx.work_data = work_data;
 
-		// Print progress percent
-		if ( (par3_ctx->noise_level >= 0) && (par3_ctx->noise_level <= 1) ){
-			progress_step += block_count;
-			time_now = time(NULL);
-			if (time_now != time_old){
-				time_old = time_now;
-				progress_now = (int)((progress_step * 1000) / progress_total);
-				if (progress_now != progress_old){
-					progress_old = progress_now;
-					printf("%d.%d%%\r", progress_now / 10, progress_now % 10);	// 0.0% ~ 100.0%
-				}
-			}
-		}
-	}
+	return rs_leo_run(par3_ctx, &ctx);
 }
 
+// Recover lost input blocks by Leopard-RS.
+int rs_leo_decode(PAR3_CTX *par3_ctx, size_t region_size,
+				uint32_t original_count, uint32_t recovery_count, uint32_t work_count,
+				uint8_t **original_data, uint8_t **recovery_data, uint8_t **work_data)
+{
+	LEO_THREAD_CTX ctx;
+
+	memset(&ctx, 0, sizeof(LEO_THREAD_CTX));
+	ctx.region_size = region_size;
+	ctx.original_count = original_count;
+	ctx.recovery_count = recovery_count;
+	ctx.max_recovery = recovery_count;
+	ctx.work_count = work_count;
+	ctx.original_data = original_data;
+	ctx.recovery_data = recovery_data;
+	ctx.work_data = work_data;
+
+	return rs_leo_run(par3_ctx, &ctx);
+}
@@ -1,6 +1,6 @@
 
-// Create all recovery blocks from one input block.
-void rs_create_one_all(PAR3_CTX *par3_ctx, int x_index);
+// Create some recovery blocks from one input block.
+void rs_create_one_all(PAR3_CTX *par3_ctx, uint8_t *input_p, int x_index, int y_first, int y_count);
 
 // Create all recovery blocks from all input blocks.
 void rs_create_all(PAR3_CTX *par3_ctx, size_t region_size,
@@ -10,6 +10,9 @@ void rs_create_all(PAR3_CTX *par3_ctx, size_t region_size,
 // Construct matrix for Reed-Solomon, and solve linear equation.
 int rs_compute_matrix(PAR3_CTX *par3_ctx, uint64_t lost_count);
 
+// Gaussian elimination of matrix on threads, which is shared by 8-bit and 16-bit.
+int rs_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count);
+
 
 // for 8-bit Cauchy Reed-Solomon
 int rs8_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count);
@@ -26,3 +29,12 @@ void rs_recover_one_all(PAR3_CTX *par3_ctx, int x_index, int lost_count);
 void rs_recover_all(PAR3_CTX *par3_ctx, size_t region_size, int lost_count,
 				uint64_t progress_total, uint64_t progress_step);
 
+
+// for FFT based Reed-Solomon (Leopard-RS)
+// Blocks are split into stripes, which are processed on threads.
+int rs_leo_encode(PAR3_CTX *par3_ctx, size_t region_size,
+				uint32_t original_count, uint32_t recovery_count, uint32_t work_count,
+				uint8_t **original_data, uint8_t **work_data);
+int rs_leo_decode(PAR3_CTX *par3_ctx, size_t region_size,
+				uint32_t original_count, uint32_t recovery_count, uint32_t work_count,
+				uint8_t **original_data, uint8_t **recovery_data, uint8_t **work_data);
@@ -6,16 +6,16 @@
 
 #include "libpar3.h"
 #include "galois.h"
+#include "reedsolomon.h"
 
 
 // Gaussian elimination of matrix for Cauchy Reed-Solomon
 int rs8_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count)
 {
 	uint8_t *gf_table, *matrix;
-	int x, y, y_R, y2;
+	int x, y, y_R, ret;
 	int *lost_id, *recv_id;
 	int block_count;
-	int pivot, factor, factor2;
 
 	if (lost_count == 0)
 		return 0;
@@ -58,32 +58,9 @@ int rs8_gaussian_elimination(PAR3_CTX *par3_ctx, int lost_count)
 	}
 
 	// Gaussian elimination
-	for (y = 0; y < lost_count; y++){
-		// Let pivot value to be 1.
-		pivot = lost_id[y];
-		factor = matrix[block_count * y + pivot];
-		if (factor == 0){
-			printf("Failed to invert matrix\n");
-			return RET_LOGIC_ERROR;
-		}
-		factor = gf8_reciprocal(gf_table, factor);
-		gf8_region_multiply(gf_table, matrix + block_count * y, factor, block_count, NULL, 0);
-
-		// Erase values of same pivot on other rows.
-		for (y2 = 0; y2 < lost_count; y2++){
-			if (y2 == y)
-				continue;
-
-			factor2 = matrix[block_count * y2 + pivot];
-			gf8_region_multiply(gf_table, matrix + block_count * y, factor2, block_count, matrix + block_count * y2, 1);
-
-			// After eliminate the pivot value, store "factor * factor2" value on the pivot.
-			matrix[block_count * y2 + pivot] = gf8_multiply(gf_table, factor, factor2);
-		}
-
-		// After eliminate the pivot columun, store "factor" value on the pivot.
-		matrix[block_count * y + pivot] = factor;
-	}
+	ret = rs_gaussian_elimination(par3_ctx, lost_count);
+	if (ret != 0)
+		return ret;
 
 	if (par3_ctx->noise_level >= 3){
 		printf("\n recovery matrix (%d * %d):\n", block_count, lost_count);
@@ -0,0 +1,403 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+
+typedef CRITICAL_SECTION MUTEX_T;
+typedef CONDITION_VARIABLE COND_T;
+typedef HANDLE THREAD_T;
+typedef DWORD THREAD_ID;
+#define thread_self()		GetCurrentThreadId()
+#define thread_equal(a, b)	((a) == (b))
+#define mutex_init(m)		InitializeCriticalSection(m)
+#define mutex_destroy(m)	DeleteCriticalSection(m)
+#define mutex_lock(m)		EnterCriticalSection(m)
+#define mutex_unlock(m)		LeaveCriticalSection(m)
+#define cond_init(c)		InitializeConditionVariable(c)
+#define cond_destroy(c)
+#define cond_wait(c, m)		SleepConditionVariableCS(c, m, INFINITE)
+#define cond_broadcast(c)	WakeAllConditionVariable(c)
+
+#else
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t MUTEX_T;
+typedef pthread_cond_t COND_T;
+typedef pthread_t THREAD_T;
+typedef pthread_t THREAD_ID;
+#define thread_self()		pthread_self()
+#define thread_equal(a, b)	pthread_equal(a, b)
+#define mutex_init(m)		pthread_mutex_init(m, NULL)
+#define mutex_destroy(m)	pthread_mutex_destroy(m)
+#define mutex_lock(m)		pthread_mutex_lock(m)
+#define mutex_unlock(m)		pthread_mutex_unlock(m)
+#define cond_init(c)		pthread_cond_init(c, NULL)
+#define cond_destroy(c)		pthread_cond_destroy(c)
+#define cond_wait(c, m)		pthread_cond_wait(c, m)
+#define cond_broadcast(c)	pthread_cond_broadcast(c)
+
+#endif
+
+#include "thread.h"
+
+
+// Number of logical processors
+int thread_cpu_count(void)
+{
+	int count;
+
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	count = (int)(info.dwNumberOfProcessors);
+#else
+	count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (count < 1)
+		count = 1;
+	if (count > MAX_THREAD_COUNT)
+		count = MAX_THREAD_COUNT;
+
+	return count;
+}
+
+
+// State of thread pool.
+// The calling thread works as one of threads, so worker_count = thread_count - 1.
+static struct {
+	int worker_count;
+	int stop;
+	MUTEX_T mutex;
+	COND_T cond_job;	// signaled when new job starts
+	COND_T cond_done;	// signaled when all tasks are done
+	THREAD_T thread[MAX_THREAD_COUNT];
+	THREAD_ID owner;	// the thread, which started the pool
+	int busy;	// set while the owner runs a job
+
+	void (*func)(void *arg, int index);
+	void *arg;
+	uint32_t job_id;
+	int task_count;
+	int task_next;	// index of next task
+	int task_done;	// number of finished tasks
+} pool;
+
+// Do tasks of current job until all tasks are taken.
+static void pool_work(void)
+{
+	void (*func)(void *arg, int index);
+	void *arg;
+	int index;
+
+	mutex_lock(&(pool.mutex));
+	while (pool.task_next < pool.task_count){
+		index = pool.task_next;
+		pool.task_next++;
+		func = pool.func;
+		arg = pool.arg;
+		mutex_unlock(&(pool.mutex));
+
+		func(arg, index);
+
+		mutex_lock(&(pool.mutex));
+		pool.task_done++;
+		if (pool.task_done == pool.task_count)
+			cond_broadcast(&(pool.cond_done));
+	}
+	mutex_unlock(&(pool.mutex));
+}
+
+#ifdef _WIN32
+static unsigned int __stdcall pool_worker(void *unused)
+#else
+static void * pool_worker(void *unused)
+#endif
+{
+	uint32_t job_id;
+
+	mutex_lock(&(pool.mutex));
+	job_id = pool.job_id;
+	for (;;){
+		while ( (pool.stop == 0) && (pool.job_id == job_id) )
+			cond_wait(&(pool.cond_job), &(pool.mutex));
+		if (pool.stop != 0)
+			break;
+		job_id = pool.job_id;
+		mutex_unlock(&(pool.mutex));
+
+		pool_work();
+
+		mutex_lock(&(pool.mutex));
+	}
+	mutex_unlock(&(pool.mutex));
+
+	return 0;
+}
+
+// Start worker threads. Return number of available threads.
+int thread_pool_start(int thread_count)
+{
+	if (pool.worker_count > 0)
+		thread_pool_stop();
+	if (thread_count > MAX_THREAD_COUNT)
+		thread_count = MAX_THREAD_COUNT;
+	if (thread_count <= 1)
+		return 1;
+
+	mutex_init(&(pool.mutex));
+	cond_init(&(pool.cond_job));
+	cond_init(&(pool.cond_done));
+	pool.stop = 0;
+	pool.task_count = 0;
+	pool.task_next = 0;
+	pool.task_done = 0;
+	pool.owner = thread_self();
+	pool.busy = 0;
+
+	while (pool.worker_count < thread_count - 1){
+#ifdef _WIN32
+		pool.thread[pool.worker_count] = (HANDLE)_beginthreadex(NULL, 0, pool_worker, NULL, 0, NULL);
+		if (pool.thread[pool.worker_count] == 0)
+			break;
+#else
+		if (pthread_create(&(pool.thread[pool.worker_count]), NULL, pool_worker, NULL) != 0)
+			break;
+#endif
+		pool.worker_count++;
+	}
+	if (pool.worker_count == 0){
+		cond_destroy(&(pool.cond_done));
+		cond_destroy(&(pool.cond_job));
+		mutex_destroy(&(pool.mutex));
+	}
+
+	return pool.worker_count + 1;
+}
+
+// Stop and release worker threads.
+void thread_pool_stop(void)
+{
+	int i;
+
+	if (pool.worker_count == 0)
+		return;
+
+	mutex_lock(&(pool.mutex));
+	pool.stop = 1;
+	cond_broadcast(&(pool.cond_job));
+	mutex_unlock(&(pool.mutex));
+
+	for (i = 0; i < pool.worker_count; i++){
+#ifdef _WIN32
+		WaitForSingleObject(pool.thread[i], INFINITE);
+		CloseHandle(pool.thread[i]);
+#else
+		pthread_join(pool.thread[i], NULL);
+#endif
+	}
+	pool.worker_count = 0;
+
+	cond_destroy(&(pool.cond_done));
+	cond_destroy(&(pool.cond_job));
+	mutex_destroy(&(pool.mutex));
+}
+
+// Return number of threads including the calling thread.
+int thread_pool_count(void)
+{
+	return pool.worker_count + 1;
+}
+
+// Share tasks between worker threads and the calling thread.
+void thread_pool_run(void (*func)(void *arg, int index), void *arg, int task_count)
+{
+	int index;
+
+	// Without worker threads, it calls the function directly.
+	// When it's called from inside a task or another thread, it works same.
+	if ( (pool.worker_count == 0) || (task_count <= 1) ||
+			(thread_equal(thread_self(), pool.owner) == 0) || (pool.busy != 0) ){
+		for (index = 0; index < task_count; index++)
+			func(arg, index);
+		return;
+	}
+
+	pool.busy = 1;
+	mutex_lock(&(pool.mutex));
+	pool.func = func;
+	pool.arg = arg;
+	pool.task_count = task_count;
+	pool.task_next = 0;
+	pool.task_done = 0;
+	pool.job_id++;
+	cond_broadcast(&(pool.cond_job));
+	mutex_unlock(&(pool.mutex));
+
+	pool_work();
+
+	mutex_lock(&(pool.mutex));
+	while (pool.task_done < pool.task_count)
+		cond_wait(&(pool.cond_done), &(pool.mutex));
+	mutex_unlock(&(pool.mutex));
+	pool.busy = 0;
+}
+
+
+// State of ring buffer.
+// The background thread is a producer, and the calling thread is a consumer.
+struct THREAD_RING_CTX {
+	int (*func)(void *arg, int index, int slot);
+	void *arg;
+	int task_count;
+	int slot_count;
+	int task_done;	// number of finished tasks
+	int task_free;	// number of released slots
+	int result;		// non-zero value when a task failed
+	int stop;
+	int has_thread;	// Without thread, tasks are done at waiting.
+	MUTEX_T mutex;
+	COND_T cond_done;	// signaled when a task is done
+	COND_T cond_free;	// signaled when a slot is released
+	THREAD_T thread;
+};
+
+#ifdef _WIN32
+static unsigned int __stdcall ring_worker(void *arg)
+#else
+static void * ring_worker(void *arg)
+#endif
+{
+	THREAD_RING *ring = arg;
+	int index, ret;
+
+	for (index = 0; index < ring->task_count; index++){
+		// Wait until the slot becomes free.
+		mutex_lock(&(ring->mutex));
+		while ( (ring->stop == 0) && (index - ring->task_free >= ring->slot_count) )
+			cond_wait(&(ring->cond_free), &(ring->mutex));
+		if (ring->stop != 0){
+			mutex_unlock(&(ring->mutex));
+			break;
+		}
+		mutex_unlock(&(ring->mutex));
+
+		ret = ring->func(ring->arg, index, index % ring->slot_count);
+
+		mutex_lock(&(ring->mutex));
+		ring->result = ret;
+		ring->task_done = index + 1;
+		cond_broadcast(&(ring->cond_done));
+		mutex_unlock(&(ring->mutex));
+		if (ret != 0)
+			break;
+	}
+
+	return 0;
+}
+
+// Start a background thread. Return NULL, when memory isn't enough.
+THREAD_RING * thread_ring_start(int (*func)(void *arg, int index, int slot), void *arg, int task_count, int slot_count)
+{
+	THREAD_RING *ring;
+
+	ring = calloc(1, sizeof(THREAD_RING));
+	if (ring == NULL)
+		return NULL;
+	ring->func = func;
+	ring->arg = arg;
+	ring->task_count = task_count;
+	ring->slot_count = slot_count;
+
+	mutex_init(&(ring->mutex));
+	cond_init(&(ring->cond_done));
+	cond_init(&(ring->cond_free));
+	ring->has_thread = 1;
+#ifdef _WIN32
+	ring->thread = (HANDLE)_beginthreadex(NULL, 0, ring_worker, ring, 0, NULL);
+	if (ring->thread == 0)
+		ring->has_thread = 0;
+#else
+	if (pthread_create(&(ring->thread), NULL, ring_worker, ring) != 0)
+		ring->has_thread = 0;
+#endif
+
+	return ring;
+}
+
+int thread_ring_wait(THREAD_RING *ring, int index)
+{
+	int ret;
+
+	// When thread isn't available, the calling thread does the task.
+	if (ring->has_thread == 0){
+		if (index >= ring->task_done){
+			ring->result = ring->func(ring->arg, index, index % ring->slot_count);
+			ring->task_done = index + 1;
+		}
+		return ring->result;
+	}
+
+	mutex_lock(&(ring->mutex));
+	while ( (ring->task_done <= index) && (ring->result == 0) )
+		cond_wait(&(ring->cond_done), &(ring->mutex));
+	ret = 0;
+	if (index >= ring->task_done - 1)
+		ret = ring->result;	// The last done task might fail.
+	mutex_unlock(&(ring->mutex));
+
+	return ret;
+}
+
+void thread_ring_release(THREAD_RING *ring, int index)
+{
+	mutex_lock(&(ring->mutex));
+	ring->task_free = index + 1;
+	cond_broadcast(&(ring->cond_free));
+	mutex_unlock(&(ring->mutex));
+}
+
+void thread_ring_stop(THREAD_RING *ring)
+{
+	if (ring->has_thread != 0){
+		mutex_lock(&(ring->mutex));
+		ring->stop = 1;
+		cond_broadcast(&(ring->cond_free));
+		mutex_unlock(&(ring->mutex));
+
+#ifdef _WIN32
+		WaitForSingleObject(ring->thread, INFINITE);
+		CloseHandle(ring->thread);
+#else
+		pthread_join(ring->thread, NULL);
+#endif
+	}
+
+	cond_destroy(&(ring->cond_free));
+	cond_destroy(&(ring->cond_done));
+	mutex_destroy(&(ring->mutex));
+	free(ring);
+}
+
+
+// Elapsed time in seconds
+double thread_time(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, freq;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+	return (double)(count.QuadPart) / (double)(freq.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)(ts.tv_sec) + (double)(ts.tv_nsec) / 1000000000.0;
+#endif
+}
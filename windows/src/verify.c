@@ -28,6 +28,8 @@
 #include "common.h"
 #include "hash.h"
 #include "file.h"
+#include "map.h"
+#include "cache.h"
 #include "verify.h"
 
 
@@ -150,6 +152,8 @@ int verify_input_file(PAR3_CTX *par3_ctx, uint32_t *missing_file_count, uint32_t
 	uint32_t num;
 	uint64_t current_size, file_offset, file_damage;
 	PAR3_FILE_CTX *file_p;
+	CACHE_KEY key;
+	CACHE_ENTRY *entry;
 
 	if (par3_ctx->input_file_count == 0)
 		return 0;
@@ -209,11 +213,13 @@ int verify_input_file(PAR3_CTX *par3_ctx, uint32_t *missing_file_count, uint32_t
 		printf("Number of full size block = %"PRIu64", chunk tail = %"PRIu64"\n", par3_ctx->crc_count, par3_ctx->tail_count);
 /*
 		// for debug
-		for (uint64_t i = 0; i < par3_ctx->crc_count; i++){
-			printf("crc_list[%2"PRIu64"] = 0x%016"PRIx64" , block = %"PRIu64"\n", i, par3_ctx->crc_list[i].crc, par3_ctx->crc_list[i].index);
+		for (uint64_t i = 0; (par3_ctx->crc_count > 0) && (i <= par3_ctx->crc_mask); i++){
+			if (par3_ctx->crc_list[i].index != CMP_LIST_EMPTY)
+				printf("crc_list[%2"PRIu64"] = 0x%016"PRIx64" , block = %"PRIu64"\n", i, par3_ctx->crc_list[i].crc, par3_ctx->crc_list[i].index);
 		}
-		for (uint64_t i = 0; i < par3_ctx->tail_count; i++){
-			printf("tail_list[%2"PRIu64"] = 0x%016"PRIx64" , slice = %"PRIu64"\n", i, par3_ctx->tail_list[i].crc, par3_ctx->tail_list[i].index);
+		for (uint64_t i = 0; (par3_ctx->tail_count > 0) && (i <= par3_ctx->tail_mask); i++){
+			if (par3_ctx->tail_list[i].index != CMP_LIST_EMPTY)
+				printf("tail_list[%2"PRIu64"] = 0x%016"PRIx64" , slice = %"PRIu64"\n", i, par3_ctx->tail_list[i].crc, par3_ctx->tail_list[i].index);
 		}
 */
 	}
@@ -239,10 +245,32 @@ int verify_input_file(PAR3_CTX *par3_ctx, uint32_t *missing_file_count, uint32_t
 				printf("Opening: \"%s\"\n", file_p->name);
 			}
 			file_offset = 0;
-			ret = check_complete_file(par3_ctx, file_p->name, num, current_size, &file_offset);
-			//printf("ret = %d, size = %"PRIu64", offset = %"PRIu64"\n", ret, current_size, file_offset);
-			if (ret > 0)
-				return ret;	// error
+			entry = NULL;
+			if (par3_ctx->hash_cache != NULL){
+				// When the file was changed after checking size, it's not stored.
+				if ( (cache_key(file_p->name, &key) != 0) || (key.size != current_size) ){
+					key.size = UINT64_MAX;
+				} else {
+					entry = cache_find(par3_ctx, &key, 1, 0);
+				}
+			}
+			if ( (entry != NULL) && (check_cached_file(par3_ctx, num, current_size, entry->hash) == 0) ){
+				cache_keep(par3_ctx, &key);
+				ret = 0;
+			} else {
+				ret = check_complete_file(par3_ctx, file_p->name, num, current_size, &file_offset);
+				//printf("ret = %d, size = %"PRIu64", offset = %"PRIu64"\n", ret, current_size, file_offset);
+				if (ret > 0)
+					return ret;	// error
+
+				// Only when the file is complete, its hash is stored.
+				if ( (ret == 0) && (par3_ctx->hash_cache != NULL) && (key.size != UINT64_MAX)
+						&& ((file_p->state & 0x80000000) == 0) && (mem_or16(file_p->hash) != 0) ){
+					ret = cache_add(par3_ctx, &key, file_p, 0, NULL, NULL);
+					if (ret != 0)
+						return ret;
+				}
+			}
 			if (ret == 0){
 				if (file_p->state & 0x7FFF0000){
 					*bad_file_count += 1;